@@ -27,7 +27,7 @@ bad_probe_id::bad_probe_id(cell_member_type probe_id):
 {}
 
 gj_unsupported_domain_decomposition::gj_unsupported_domain_decomposition(cell_gid_type gid_0, cell_gid_type gid_1):
-    arbor_exception(pprintf("No support for gap junctions across domain decomposition groups for gid {} and {}", gid_0, gid_1)),
+    arbor_exception(pprintf("Unsupported gap junction between gid {} and {} across cell groups: the peer site is not exported by any cell group", gid_0, gid_1)),
     gid_0(gid_0),
     gid_1(gid_1)
 {}
@@ -44,6 +44,16 @@ bad_event_time::bad_event_time(time_type event_time, time_type sim_time):
     sim_time(sim_time)
 {}
 
+trace_file_error::trace_file_error(const std::string& path, const std::string& what):
+    arbor_exception(pprintf("trace file {}: {}", path, what)),
+    path(path)
+{}
+
+spike_file_error::spike_file_error(const std::string& path, const std::string& what):
+    arbor_exception(pprintf("spike file {}: {}", path, what)),
+    path(path)
+{}
+
 no_such_mechanism::no_such_mechanism(const std::string& mech_name):
     arbor_exception(pprintf("no mechanism {} in catalogue", mech_name)),
     mech_name(mech_name)
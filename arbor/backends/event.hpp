@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
+
 #include <arbor/common_types.hpp>
 #include <arbor/fvm_types.hpp>
+#include <arbor/util/lexcmp_def.hpp>
 
 // Structures for the representation of event delivery targets and
 // staged events.
@@ -31,6 +34,9 @@ struct deliverable_event {
     {}
 };
 
+ARB_DEFINE_LEXICOGRAPHIC_ORDERING(arb::target_handle,(a.mech_id,a.mech_index,a.intdom_index),(b.mech_id,b.mech_index,b.intdom_index))
+ARB_DEFINE_LEXICOGRAPHIC_ORDERING(arb::deliverable_event,(a.time,a.handle,a.weight),(b.time,b.handle,b.weight))
+
 // Stream index accessor function for multi_event_stream:
 inline cell_size_type event_index(const deliverable_event& ev) {
     return ev.handle.intdom_index;
@@ -53,9 +59,19 @@ inline deliverable_event_data event_data(const deliverable_event& ev) {
 
 using probe_handle = const fvm_value_type*;
 
+// Combination of a probed value with the value already at the sample offset,
+// used to reduce several samples to one in the back end. Only assign sets
+// the sample time.
+
+enum class sample_op: std::uint8_t {
+    assign, add, min, max
+};
+
 struct raw_probe_info {
     probe_handle handle;      // where the to-be-probed value sits
     sample_size_type offset;  // offset into array to store raw probed value
+    sample_op op = sample_op::assign;
+    sample_size_type width = 1; // number of contiguous values to store from handle
 };
 
 struct sample_event {
@@ -5,6 +5,7 @@
 
 #include <arbor/common_types.hpp>
 #include <arbor/fvm_types.hpp>
+#include <arbor/mechanism.hpp>
 
 #include "memory/memory.hpp"
 #include "util/rangeutil.hpp"
@@ -72,6 +73,70 @@ struct backend {
             thresholds,
             context);
     }
+
+    // Work within a cell group is already parallel on the GPU.
+    static void set_cell_blocks(matrix_state&, threshold_watcher&, unsigned, const execution_context&) {}
+
+    // Matrices are always interleaved on the GPU.
+    static void set_interleaved(matrix_state&, bool) {}
+
+    // The GPU back end has its own branch parallel solver, matrix_state_fine,
+    // selected at configure time.
+    static void set_branch_parallel(matrix_state&, bool) {}
+
+    // Gap junction currents are always added explicitly on the GPU.
+    static bool set_implicit_gap_junctions(matrix_state&, const std::vector<fvm_gap_junction>&, value_type, unsigned) {
+        return false;
+    }
+
+    // The GPU back end always uses implicit Euler steps.
+    static bool set_crank_nicolson(matrix_state&, bool) {
+        return false;
+    }
+
+    // Adaptive time steps are not supported on the GPU.
+    static bool set_adaptive_dt(shared_state&, const std::vector<std::vector<value_type>>&) {
+        return false;
+    }
+
+    // Cell groups are not split into tiles on the GPU.
+    struct step_tiles {
+        bool empty() const { return true; }
+    };
+
+    static step_tiles make_step_tiles(const std::vector<mechanism_ptr>&, const matrix_state&, std::size_t) {
+        return {};
+    }
+
+    static void integrate_step_tiles(const step_tiles&, shared_state&, matrix_state&) {}
+
+    // Mechanisms are updated by one kernel per mechanism on the GPU.
+    struct mechanism_blocks {
+        bool empty() const { return true; }
+    };
+
+    static mechanism_blocks make_mechanism_blocks(const std::vector<mechanism_ptr>&, const matrix_state&) {
+        return {};
+    }
+
+    static void nrn_current(const mechanism_blocks&) {}
+    static void nrn_state(const mechanism_blocks&) {}
+
+    // Mechanism states are not compared on the GPU, so cells never quiesce.
+    static bool mechanism_state(const std::vector<mechanism_ptr>&, std::vector<fvm_value_type>&) {
+        return false;
+    }
+
+    // Cell groups are not moved between ranks on the GPU.
+    static bool serialize_state(const shared_state&, const std::vector<mechanism_ptr>&, const std::vector<mechanism_ptr>&,
+                                const threshold_watcher&, std::vector<char>&)
+    {
+        return false;
+    }
+
+    static void deserialize_state(shared_state&, std::vector<mechanism_ptr>&, std::vector<mechanism_ptr>&,
+                                  threshold_watcher&, const char*&)
+    {}
 };
 
 } // namespace gpu
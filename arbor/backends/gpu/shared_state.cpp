@@ -34,6 +34,10 @@ void set_dt_impl(
 void add_gj_current_impl(
     fvm_size_type n_gj, const fvm_gap_junction* gj, const fvm_value_type* v, fvm_value_type* i);
 
+void add_gj_halo_current_impl(
+    fvm_size_type n_gj, const fvm_gap_junction* gj, const fvm_value_type* v, const fvm_value_type* v_peer,
+    fvm_value_type* i);
+
 void take_samples_impl(
     const multi_event_stream_state<raw_probe_info>& s,
     const fvm_value_type* time, fvm_value_type* sample_time, fvm_value_type* sample_value);
@@ -146,13 +150,13 @@ void shared_state::zero_currents() {
     memory::fill(current_density, 0);
     memory::fill(conductivity, 0);
     for (auto& i: ion_data) {
-        i.second.zero_current();
+        if (i.second.write_current) i.second.zero_current();
     }
 }
 
 void shared_state::ions_init_concentration() {
     for (auto& i: ion_data) {
-        i.second.init_concentration();
+        if (i.second.write_concentration) i.second.init_concentration();
     }
 }
 
@@ -168,6 +172,20 @@ void shared_state::add_gj_current() {
     add_gj_current_impl(n_gj, gap_junctions.data(), voltage.data(), current_density.data());
 }
 
+void shared_state::set_gj_halo(const std::vector<fvm_gap_junction>& halo, fvm_size_type n_peer) {
+    gj_halo = gjarray(make_const_view(halo));
+    gj_halo_voltage = array(n_peer);
+}
+
+void shared_state::set_gj_halo_voltage(const std::vector<fvm_value_type>& peer_voltage) {
+    memory::copy(make_const_view(peer_voltage), gj_halo_voltage);
+}
+
+void shared_state::add_gj_halo_current() {
+    add_gj_halo_current_impl(gj_halo.size(), gj_halo.data(), voltage.data(), gj_halo_voltage.data(),
+        current_density.data());
+}
+
 std::pair<fvm_value_type, fvm_value_type> shared_state::time_bounds() const {
     return minmax_value_impl(n_intdom, time.data());
 }
@@ -33,6 +33,19 @@ __global__ void add_gj_current_impl(unsigned n, const T* gj_info, const I* volta
     }
 }
 
+template <typename T, typename I>
+__global__ void add_gj_halo_current_impl(unsigned n, const T* gj_info, const I* voltage, const I* peer_voltage,
+                                         I* current_density) {
+    unsigned i = threadIdx.x+blockIdx.x*blockDim.x;
+    if (i<n) {
+        auto gj = gj_info[i];
+        auto cv = gj.loc.first;
+        auto curr = gj.weight * (voltage[cv] - peer_voltage[gj.loc.second]);
+
+        cuda_atomic_add(current_density + cv, curr);
+    }
+}
+
 // Vector/scalar addition: x[i] += v ∀i
 template <typename T>
 __global__ void add_scalar(unsigned n, T* x, fvm_value_type v) {
@@ -69,8 +82,32 @@ __global__ void take_samples_impl(
         auto begin = s.ev_data+s.begin_offset[i];
         auto end = s.ev_data+s.end_offset[i];
         for (auto p = begin; p!=end; ++p) {
-            sample_time[p->offset] = time[i];
-            sample_value[p->offset] = *p->handle;
+            if (p->width>1) {
+                sample_time[p->offset] = time[i];
+                for (sample_size_type j = 0; j<p->width; ++j) {
+                    sample_value[p->offset+j] = p->handle[j];
+                }
+                continue;
+            }
+
+            auto v = *p->handle;
+            auto& value = sample_value[p->offset];
+
+            switch (p->op) {
+            case sample_op::assign:
+                sample_time[p->offset] = time[i];
+                value = v;
+                break;
+            case sample_op::add:
+                value += v;
+                break;
+            case sample_op::min:
+                value = v<value? v: value;
+                break;
+            case sample_op::max:
+                value = v>value? v: value;
+                break;
+            }
         }
     }
 }
@@ -122,6 +159,17 @@ void add_gj_current_impl(
     kernel::add_gj_current_impl<<<nblock, block_dim>>>(n_gj, gj_info, voltage, current_density);
 }
 
+void add_gj_halo_current_impl(
+    fvm_size_type n_gj, const fvm_gap_junction* gj_info, const fvm_value_type* voltage, const fvm_value_type* peer_voltage,
+    fvm_value_type* current_density)
+{
+    if (!n_gj) return;
+
+    constexpr int block_dim = 128;
+    int nblock = block_count(n_gj, block_dim);
+    kernel::add_gj_halo_current_impl<<<nblock, block_dim>>>(n_gj, gj_info, voltage, peer_voltage, current_density);
+}
+
 void take_samples_impl(
     const multi_event_stream_state<raw_probe_info>& s,
     const fvm_value_type* time, fvm_value_type* sample_time, fvm_value_type* sample_value)
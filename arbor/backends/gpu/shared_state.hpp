@@ -37,6 +37,11 @@ struct ion_state {
 
     array charge;       // charge of ionic species (global, length 1)
 
+    // Whether mechanisms write the current and the concentrations. If not,
+    // they keep their reset values and are not updated in each step.
+    bool write_current = true;
+    bool write_concentration = true;
+
     ion_state() = default;
 
     ion_state(
@@ -66,6 +71,8 @@ struct shared_state {
 
     iarray cv_to_intdom;     // Maps CV index to intdom index.
     gjarray gap_junctions;   // Stores gap_junction info.
+    gjarray gj_halo;         // Gap junctions to cells of other groups: CV and index of peer voltage.
+    array gj_halo_voltage;   // Voltage of the peers of gj_halo [mV].
     array time;              // Maps intdom index to integration start time [ms].
     array time_to;           // Maps intdom index to integration stop time [ms].
     array dt_intdom;         // Maps intdom index to (stop time) - (start time) [ms].
@@ -109,12 +116,30 @@ struct shared_state {
     // Set time_to to earliest of time+dt_step and tmax.
     void update_time_to(fvm_value_type dt_step, fvm_value_type tmax);
 
+    // Adaptive time steps are not supported on the GPU (see set_adaptive_dt
+    // in the back end), and these are never called.
+    void update_time_to_adaptive(fvm_value_type dt_min, fvm_value_type tmax) {
+        update_time_to(dt_min, tmax);
+    }
+
+    template <typename View>
+    void update_dt_adaptive(const View&, fvm_value_type, fvm_value_type, fvm_value_type) {}
+
     // Set the per-intdom and per-compartment dt from time_to - time.
     void set_dt();
 
     // Update gap_junction state
     void add_gj_current();
 
+    // Set the gap junctions to cells of other groups, whose peer voltages
+    // are the n_peer values supplied by set_gj_halo_voltage.
+    void set_gj_halo(const std::vector<fvm_gap_junction>& halo, fvm_size_type n_peer);
+    void set_gj_halo_voltage(const std::vector<fvm_value_type>& peer_voltage);
+
+    // Add the current of the gap junctions to cells of other groups, with
+    // the peer voltages held fixed.
+    void add_gj_halo_current();
+
     // Return minimum and maximum time value [ms] across cells.
     std::pair<fvm_value_type, fvm_value_type> time_bounds() const;
 
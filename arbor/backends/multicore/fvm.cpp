@@ -0,0 +1,62 @@
+#include <vector>
+
+#include <arbor/arbexcept.hpp>
+#include <arbor/mechanism.hpp>
+
+#include "backends/multicore/fvm.hpp"
+#include "backends/multicore/mechanism.hpp"
+
+namespace arb {
+namespace multicore {
+
+bool backend::mechanism_state(const std::vector<mechanism_ptr>& mechanisms, std::vector<fvm_value_type>& values) {
+    values.clear();
+    for (auto& m: mechanisms) {
+        auto p = dynamic_cast<mechanism*>(m.get());
+        if (!p) return false;
+        p->append_state(values);
+    }
+    return true;
+}
+
+bool backend::serialize_state(
+    const shared_state& state,
+    const std::vector<mechanism_ptr>& mechanisms,
+    const std::vector<mechanism_ptr>& revpot_mechanisms,
+    const threshold_watcher& watcher,
+    std::vector<char>& buf)
+{
+    state.serialize(buf);
+    for (auto list: {&mechanisms, &revpot_mechanisms}) {
+        for (auto& m: *list) {
+            auto p = dynamic_cast<const mechanism*>(m.get());
+            if (!p) return false;
+            p->serialize(buf);
+        }
+    }
+    watcher.serialize(buf);
+    return true;
+}
+
+void backend::deserialize_state(
+    shared_state& state,
+    std::vector<mechanism_ptr>& mechanisms,
+    std::vector<mechanism_ptr>& revpot_mechanisms,
+    threshold_watcher& watcher,
+    const char*& p)
+{
+    state.deserialize(p);
+    for (auto list: {&mechanisms, &revpot_mechanisms}) {
+        for (auto& m: *list) {
+            auto q = dynamic_cast<mechanism*>(m.get());
+            if (!q) {
+                throw arbor_internal_error("multicore/fvm: mechanism of another back end");
+            }
+            q->deserialize(p);
+        }
+    }
+    watcher.deserialize(p);
+}
+
+} // namespace multicore
+} // namespace arb
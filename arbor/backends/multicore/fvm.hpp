@@ -5,9 +5,11 @@
 
 #include "backends/event.hpp"
 #include "backends/multicore/matrix_state.hpp"
+#include "backends/multicore/mechanism_blocks.hpp"
 #include "backends/multicore/multi_event_stream.hpp"
 #include "backends/multicore/multicore_common.hpp"
 #include "backends/multicore/shared_state.hpp"
+#include "backends/multicore/step_tiles.hpp"
 #include "backends/multicore/threshold_watcher.hpp"
 #include "execution_context.hpp"
 #include "util/padded_alloc.hpp"
@@ -43,6 +45,8 @@ struct backend {
     using sample_event_stream = arb::multicore::sample_event_stream;
 
     using shared_state = arb::multicore::shared_state;
+    using step_tiles = arb::multicore::step_tiles;
+    using mechanism_blocks = arb::multicore::mechanism_blocks;
 
     static threshold_watcher voltage_watcher(
         const shared_state& state,
@@ -59,6 +63,110 @@ struct backend {
             thresholds,
             context);
     }
+
+    // Solve the matrices branch by branch, with the branches of a level in
+    // parallel; must precede set_interleaved and set_cell_blocks.
+    static void set_branch_parallel(matrix_state& matrix, bool branch_parallel) {
+        matrix.set_branch_parallel(branch_parallel);
+    }
+
+    // Use interleaved matrix storage and SIMD assembly and solution across
+    // cells; must precede set_cell_blocks.
+    static void set_interleaved(matrix_state& matrix, bool interleaved) {
+        matrix.set_interleaved(interleaved);
+    }
+
+    // Solve for gap junction currents in the matrix; returns true if
+    // supported. Overrides set_branch_parallel and set_interleaved, and
+    // must precede set_cell_blocks.
+    static bool set_implicit_gap_junctions(
+        matrix_state& matrix,
+        const std::vector<fvm_gap_junction>& gj,
+        value_type tolerance,
+        unsigned max_iter)
+    {
+        matrix.set_gap_junctions(gj, tolerance, max_iter);
+        return true;
+    }
+
+    // Advance the voltage with the Crank-Nicolson scheme; returns true if
+    // supported.
+    static bool set_crank_nicolson(matrix_state& matrix, bool crank_nicolson) {
+        matrix.set_crank_nicolson(crank_nicolson);
+        return true;
+    }
+
+    // Adapt the time step of each integration domain, ending steps at the
+    // given breakpoints of each domain; returns true if supported.
+    static bool set_adaptive_dt(shared_state& state, const std::vector<std::vector<value_type>>& intdom_breakpoints) {
+        state.set_breakpoints(intdom_breakpoints);
+        return true;
+    }
+
+    // Split matrix assembly and solution and threshold testing into at most
+    // n_blocks cell-aligned blocks that run in parallel within a cell group.
+    static void set_cell_blocks(
+        matrix_state& matrix,
+        threshold_watcher& watcher,
+        unsigned n_blocks,
+        const execution_context& context)
+    {
+        matrix.set_cell_blocks(n_blocks, context.thread_pool);
+        watcher.set_blocks(n_blocks, context.thread_pool);
+    }
+
+    // Split the cell group into tiles of about tile_bytes of state that are
+    // advanced one after another within each step; see step_tiles.
+    static step_tiles make_step_tiles(
+        const std::vector<mechanism_ptr>& mechanisms,
+        const matrix_state& matrix,
+        std::size_t tile_bytes)
+    {
+        return step_tiles(mechanisms, matrix, tile_bytes);
+    }
+
+    static void integrate_step_tiles(const step_tiles& tiles, shared_state& state, matrix_state& matrix) {
+        tiles.integrate(state, matrix);
+    }
+
+    // Update the mechanism currents and states of the cell blocks of the
+    // matrix in parallel; must follow set_cell_blocks. See mechanism_blocks.
+    static mechanism_blocks make_mechanism_blocks(
+        const std::vector<mechanism_ptr>& mechanisms,
+        const matrix_state& matrix)
+    {
+        return mechanism_blocks(mechanisms, matrix);
+    }
+
+    static void nrn_current(const mechanism_blocks& blocks) {
+        blocks.nrn_current();
+    }
+
+    static void nrn_state(const mechanism_blocks& blocks) {
+        blocks.nrn_state();
+    }
+
+    // Replace values by the state variables of the mechanisms, which are
+    // compared across epochs to detect quiescent cells; returns false if
+    // not supported.
+    static bool mechanism_state(const std::vector<mechanism_ptr>& mechanisms, std::vector<fvm_value_type>& values);
+
+    // Append the dynamic state of a cell group to buf, or restore it from
+    // the state appended by a cell group of the same layout, so that the
+    // group can be moved to another rank; returns false if not supported.
+    static bool serialize_state(
+        const shared_state& state,
+        const std::vector<mechanism_ptr>& mechanisms,
+        const std::vector<mechanism_ptr>& revpot_mechanisms,
+        const threshold_watcher& watcher,
+        std::vector<char>& buf);
+
+    static void deserialize_state(
+        shared_state& state,
+        std::vector<mechanism_ptr>& mechanisms,
+        std::vector<mechanism_ptr>& revpot_mechanisms,
+        threshold_watcher& watcher,
+        const char*& p);
 };
 
 } // namespace multicore
@@ -1,8 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <arbor/fvm_types.hpp>
+
 #include <util/partition.hpp>
 #include <util/span.hpp>
 
+#include "threading/threading.hpp"
+
+#include "matrix_state_fine.hpp"
+#include "matrix_state_interleaved.hpp"
 #include "multicore_common.hpp"
 
 namespace arb {
@@ -68,9 +79,125 @@ public:
     const_view solution() const {
         // In this back end the solution is a simple view of the rhs, which
         // contains the solution after the matrix_solve is performed.
-        return rhs;
+        return cn_? cn_solution_:
+               fine_? fine_state_.solution():
+               interleaved_? interleaved_state_.solution(): rhs;
+    }
+
+    // Advance the voltage with the Crank-Nicolson scheme instead of implicit
+    // Euler: the matrix is assembled and solved for an implicit Euler step of
+    // half the time step, which gives the voltage at the middle of the step,
+    // and the solution is extrapolated from it to the end of the step.
+    void set_crank_nicolson(bool crank_nicolson) {
+        cn_ = crank_nicolson;
+        cn_dt_.clear();
+        cn_voltage_ = array(cn_? size(): 0);
+        cn_solution_ = array(cn_? size(): 0);
+    }
+
+    bool crank_nicolson() const {
+        return cn_;
+    }
+
+    // Solve the matrices branch by branch, with the branches of each level
+    // of the cell trees solved in parallel. Takes precedence over
+    // interleaving; call before set_cell_blocks.
+    void set_branch_parallel(bool branch_parallel) {
+        fine_ = branch_parallel;
+        fine_state_ = branch_parallel?
+            matrix_state_fine<value_type, index_type>(
+                std::vector<index_type>(parent_index.begin(), parent_index.end()),
+                std::vector<index_type>(cell_cv_divs.begin(), cell_cv_divs.end()),
+                std::vector<value_type>(cv_capacitance.begin(), cv_capacitance.end()),
+                std::vector<value_type>(face_conductance.begin(), face_conductance.end()),
+                std::vector<value_type>(cv_area.begin(), cv_area.end()),
+                std::vector<index_type>(cell_to_intdom.begin(), cell_to_intdom.end())):
+            matrix_state_fine<value_type, index_type>();
+    }
+
+    // Assemble and solve the matrices of blocks of cells interleaved, with
+    // SIMD operations across the cells of a block. Call before
+    // set_cell_blocks.
+    void set_interleaved(bool interleaved) {
+        interleaved_ = interleaved && !fine_;
+        interleaved_state_ = interleaved_?
+            matrix_state_interleaved<value_type, index_type>(
+                std::vector<index_type>(parent_index.begin(), parent_index.end()),
+                std::vector<index_type>(cell_cv_divs.begin(), cell_cv_divs.end()),
+                std::vector<value_type>(cv_capacitance.begin(), cv_capacitance.end()),
+                std::vector<value_type>(face_conductance.begin(), face_conductance.end()),
+                std::vector<value_type>(cv_area.begin(), cv_area.end()),
+                std::vector<index_type>(cell_to_intdom.begin(), cell_to_intdom.end())):
+            matrix_state_interleaved<value_type, index_type>();
+    }
+
+    // Couple the CVs of the gap junctions implicitly: the conductance of
+    // each junction [μS], given by its weight as a current density [kS/m²]
+    // at its local CV, is added to the diagonal of the local CV and coupled
+    // to the peer CV as an off-tree entry. The matrices of the cells with
+    // gap junctions are then solved together, by preconditioned conjugate
+    // gradient iteration with the Hines solve as preconditioner, until the
+    // voltage changes by less than tolerance [mV] or for at most max_iter
+    // iterations. Junctions must be listed in both directions.
+    //
+    // Implicit gap junctions use the flat storage: interleaving and branch
+    // parallel solution are turned off.
+    void set_gap_junctions(const std::vector<fvm_gap_junction>& gj, value_type tolerance, unsigned max_iter) {
+        fine_ = false;
+        fine_state_ = matrix_state_fine<value_type, index_type>();
+        interleaved_ = false;
+        interleaved_state_ = matrix_state_interleaved<value_type, index_type>();
+
+        gj_loc_.clear();
+        gj_cond_.clear();
+        gj_cells_.clear();
+        for (auto& g: gj) {
+            gj_loc_.push_back(g.loc);
+            gj_cond_.push_back(g.weight*1e-3*cv_area[g.loc.first]); // [μS]
+            auto cell = std::upper_bound(cell_cv_divs.begin(), cell_cv_divs.end(), g.loc.first)-cell_cv_divs.begin()-1;
+            gj_cells_.push_back(cell);
+        }
+        std::sort(gj_cells_.begin(), gj_cells_.end());
+        gj_cells_.erase(std::unique(gj_cells_.begin(), gj_cells_.end()), gj_cells_.end());
+
+        gj_tolerance_ = tolerance;
+        gj_max_iter_ = max_iter;
+
+        auto n = gj_loc_.empty()? 0: size();
+        gj_d_ = array(n, 0);
+        gj_x_ = array(n, 0);
+        gj_r_ = array(n, 0);
+        gj_p_ = array(n, 0);
+        gj_q_ = array(n, 0);
     }
 
+    // Split the cells into at most n_blocks contiguous blocks with roughly
+    // equal numbers of CVs. The blocks are assembled and solved in parallel
+    // on the thread pool.
+    void set_cell_blocks(unsigned n_blocks, task_system_handle threads) {
+        auto cell_cv_part = util::partition_view(cell_cv_divs);
+        const index_type ncells = cell_cv_part.size();
+        const auto ncv = size();
+
+        block_cell_divs_.assign(1, 0);
+        if (n_blocks>1 && ncells>1) {
+            for (auto m: util::make_span(1, ncells)) {
+                auto k = block_cell_divs_.size();
+                if ((std::size_t)cell_cv_part[m].first*n_blocks>=k*ncv) {
+                    block_cell_divs_.push_back(m);
+                }
+            }
+        }
+        block_cell_divs_.push_back(ncells);
+        threads_ = threads;
+
+        if (fine_) {
+            fine_state_.set_cell_blocks(n_blocks, std::move(threads));
+        }
+        else if (interleaved_) {
+            interleaved_state_.set_cell_blocks(n_blocks, std::move(threads));
+        }
+    }
 
     // Assemble the matrix
     // Afterwards the diagonal and RHS will have been set given dt, voltage and current.
@@ -78,12 +205,225 @@ public:
     //   voltage         [mV]      (per control volume)
     //   current density [A.m^-2]  (per control volume)
     //   conductivity    [kS.m^-2] (per control volume)
-    void assemble(const_view dt_intdom, const_view voltage, const_view current, const_view conductivity) {
+    void assemble(const_view dt_intdom_step, const_view voltage, const_view current, const_view conductivity) {
+        if (cn_) {
+            cn_dt_.resize(dt_intdom_step.size());
+            for (auto i: util::count_along(cn_dt_)) {
+                cn_dt_[i] = 0.5*dt_intdom_step[i];
+            }
+            std::copy(voltage.begin(), voltage.end(), cn_voltage_.begin());
+        }
+        const_view dt_intdom = cn_? cn_dt_: dt_intdom_step;
+
+        if (fine_) {
+            fine_state_.assemble(dt_intdom, voltage, current, conductivity);
+            return;
+        }
+        if (interleaved_) {
+            interleaved_state_.assemble(dt_intdom, voltage, current, conductivity);
+            return;
+        }
+        for_each_block([&](index_type first, index_type last) {
+            assemble(first, last, dt_intdom, voltage, current, conductivity);
+        });
+
+        if (!gj_loc_.empty()) {
+            // Cells with zero dt are left uncoupled.
+            for (auto k: util::count_along(gj_loc_)) {
+                auto i = gj_loc_[k].first;
+                if (d[i]!=0) d[i] += gj_cond_[k];
+            }
+            for_each_gj_cv([&](index_type i) { gj_d_[i] = d[i]; });
+        }
+    }
+
+    // True if the matrices are stored flat and solved cell by cell, so that
+    // the matrices of a range of cells can be assembled and solved alone.
+    bool is_flat() const {
+        return !fine_ && !interleaved_ && gj_loc_.empty();
+    }
+
+    // Partition of the cells into the blocks set by set_cell_blocks.
+    const std::vector<index_type>& block_cell_divs() const {
+        return block_cell_divs_;
+    }
+
+    const task_system_handle& threads() const {
+        return threads_;
+    }
+
+    void solve() {
+        if (fine_) {
+            fine_state_.solve();
+        }
+        else if (interleaved_) {
+            interleaved_state_.solve();
+        }
+        else {
+            for_each_block([&](index_type first, index_type last) { solve(first, last); });
+
+            if (!gj_loc_.empty()) {
+                solve_gap_junctions();
+            }
+        }
+
+        if (cn_) {
+            // Cells with zero dt have the unchanged voltage as solution.
+            const auto& x = fine_? fine_state_.solution(): interleaved_? interleaved_state_.solution(): rhs;
+            for (auto i: util::make_span(size())) {
+                cn_solution_[i] = 2*x[i]-cn_voltage_[i];
+            }
+        }
+    }
+
+private:
+    // Partition of cells into blocks, empty if the matrix is not split.
+    std::vector<index_type> block_cell_divs_;
+    task_system_handle threads_;
+
+    // Interleaved storage, used in place of the above if interleaved_.
+    bool interleaved_ = false;
+    matrix_state_interleaved<value_type, index_type> interleaved_state_;
+
+    // Branch by branch solution, used in place of the above if fine_.
+    bool fine_ = false;
+    matrix_state_fine<value_type, index_type> fine_state_;
+
+    // Crank-Nicolson: half step per integration domain, voltage at the
+    // start of the step, and extrapolated solution.
+    bool cn_ = false;
+    array cn_dt_;
+    array cn_voltage_;
+    array cn_solution_;
+
+    // Implicit gap junctions: local and peer CV and conductance of each
+    // junction, and the sorted cells with junctions.
+    std::vector<std::pair<index_type, index_type>> gj_loc_;
+    std::vector<value_type> gj_cond_;
+    std::vector<index_type> gj_cells_;
+    value_type gj_tolerance_ = 0;
+    unsigned gj_max_iter_ = 0;
+
+    // Assembled diagonal, and the solution, residual,
+    // search direction and its product with the matrix of the conjugate
+    // gradient iteration, at the CVs of cells with junctions.
+    array gj_d_, gj_x_, gj_r_, gj_p_, gj_q_;
+
+    // Call f(i) for each CV i of the cells with gap junctions. The residual,
+    // search direction and its product are kept zero on cells with zero dt,
+    // so that their voltage is kept fixed.
+    template <typename F>
+    void for_each_gj_cv(F&& f) {
+        for (auto c: gj_cells_) {
+            for (auto i: util::make_span(cell_cv_divs[c], cell_cv_divs[c+1])) f(i);
+        }
+    }
+
+    // Solve the matrices of the cells with gap junctions with assembled
+    // diagonal gj_d_ and right hand side rhs in place.
+    void solve_gj_cells() {
+        for (auto c: gj_cells_) {
+            auto first = cell_cv_divs[c];
+            if (gj_d_[first]==0) continue;
+            for (auto i: util::make_span(first, cell_cv_divs[c+1])) d[i] = gj_d_[i];
+            solve(c, c+1);
+        }
+    }
+
+    // Conjugate gradient iteration for the matrix with the gap junction
+    // coupling, starting from the solution of the uncoupled matrices,
+    // preconditioned with the uncoupled matrices.
+    void solve_gap_junctions() {
+        auto dot = [&](const array& a, const array& b) {
+            value_type s = 0;
+            for_each_gj_cv([&](index_type i) { s += a[i]*b[i]; });
+            return s;
+        };
+
+        // With x the solution of the uncoupled matrices, the residual is the
+        // off-tree coupling times x.
+        for_each_gj_cv([&](index_type i) {
+            gj_x_[i] = rhs[i];
+            gj_r_[i] = 0;
+        });
+        for (auto k: util::count_along(gj_loc_)) {
+            auto i = gj_loc_[k].first;
+            if (gj_d_[i]!=0) gj_r_[i] += gj_cond_[k]*gj_x_[gj_loc_[k].second];
+        }
+
+        for_each_gj_cv([&](index_type i) { rhs[i] = gj_r_[i]; });
+        solve_gj_cells();
+        for_each_gj_cv([&](index_type i) { gj_p_[i] = rhs[i]; });
+        value_type rz = dot(gj_r_, gj_p_);
+
+        for (unsigned iter = 0; iter<gj_max_iter_ && rz>0; ++iter) {
+            // q = A p, for the matrix A with the coupling.
+            for (auto c: gj_cells_) {
+                auto first = cell_cv_divs[c];
+                auto last = cell_cv_divs[c+1];
+                if (gj_d_[first]==0) {
+                    // Keep the residual of cells with zero dt at zero: a
+                    // product left over from an earlier step would leak
+                    // into it, and from there into the search direction.
+                    for (auto i: util::make_span(first, last)) gj_q_[i] = 0;
+                    continue;
+                }
+
+                for (auto i: util::make_span(first, last)) gj_q_[i] = gj_d_[i]*gj_p_[i];
+                for (auto i: util::make_span(first+1, last)) {
+                    gj_q_[i] += u[i]*gj_p_[parent_index[i]];
+                    gj_q_[parent_index[i]] += u[i]*gj_p_[i];
+                }
+            }
+            for (auto k: util::count_along(gj_loc_)) {
+                auto i = gj_loc_[k].first;
+                if (gj_d_[i]!=0) gj_q_[i] -= gj_cond_[k]*gj_p_[gj_loc_[k].second];
+            }
+
+            value_type pq = dot(gj_p_, gj_q_);
+            if (!(pq>0)) break;
+
+            value_type alpha = rz/pq;
+            value_type max_change = 0;
+            for_each_gj_cv([&](index_type i) {
+                gj_x_[i] += alpha*gj_p_[i];
+                gj_r_[i] -= alpha*gj_q_[i];
+                max_change = std::max(max_change, std::abs(alpha*gj_p_[i]));
+            });
+            if (max_change<gj_tolerance_) break;
+
+            for_each_gj_cv([&](index_type i) { rhs[i] = gj_r_[i]; });
+            solve_gj_cells();
+            value_type rz_next = dot(gj_r_, rhs);
+            value_type beta = rz_next/rz;
+            rz = rz_next;
+            for_each_gj_cv([&](index_type i) { gj_p_[i] = rhs[i] + beta*gj_p_[i]; });
+        }
+
+        for_each_gj_cv([&](index_type i) { rhs[i] = gj_x_[i]; });
+    }
+
+    template <typename F>
+    void for_each_block(F&& f) {
+        const index_type n_blocks = block_cell_divs_.size()? block_cell_divs_.size()-1: 0;
+        if (n_blocks>1) {
+            threading::parallel_for::apply(0, n_blocks, threads_.get(),
+                [&](int i) { f(block_cell_divs_[i], block_cell_divs_[i+1]); });
+        }
+        else {
+            f(0, (index_type)cell_cv_divs.size()-1);
+        }
+    }
+
+public:
+    // Assemble the submatrices of cells in [first_cell, last_cell). With
+    // flat storage, this and solve over a range of cells are used on their
+    // own by the cache-blocked step schedule.
+    void assemble(index_type first_cell, index_type last_cell, const_view dt_intdom, const_view voltage, const_view current, const_view conductivity) {
         auto cell_cv_part = util::partition_view(cell_cv_divs);
-        const index_type ncells = cell_cv_part.size();
 
         // loop over submatrices
-        for (auto m: util::make_span(0, ncells)) {
+        for (auto m: util::make_span(first_cell, last_cell)) {
             auto dt = dt_intdom[cell_to_intdom[m]];
 
             if (dt>0) {
@@ -107,9 +447,13 @@ public:
         }
     }
 
-    void solve() {
+    // Solve the submatrices of cells in [first_cell, last_cell).
+    void solve(index_type first_cell, index_type last_cell) {
+        auto cell_cv_part = util::partition_view(cell_cv_divs);
+
         // loop over submatrices
-        for (auto cv_span: util::partition_view(cell_cv_divs)) {
+        for (auto m: util::make_span(first_cell, last_cell)) {
+            auto cv_span = cell_cv_part[m];
             auto first = cv_span.first;
             auto last = cv_span.second; // one past the end
 
@@ -131,8 +475,6 @@ public:
         }
     }
 
-private:
-
     std::size_t size() const {
         return parent_index.size();
     }
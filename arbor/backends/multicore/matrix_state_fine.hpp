@@ -0,0 +1,462 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include <arbor/assert.hpp>
+#include <arbor/simd/simd.hpp>
+
+#include "threading/threading.hpp"
+#include "util/span.hpp"
+
+#include "multicore_common.hpp"
+
+namespace arb {
+namespace multicore {
+
+// Hines matrices of cells solved branch by branch, so that the branches of
+// large cells are solved in parallel across SIMD lanes and threads.
+//
+// The CVs of each cell are split into unbranched branches: a CV starts a
+// new branch if it is the root of its cell, if it does not directly follow
+// its parent, or if its parent has more than one child. Thus each CV of a
+// branch is the parent of the next, and the child branches of a branch are
+// all attached to its last CV.
+//
+// Branches are grouped into levels by their depth in the tree; the roots of
+// all cells are on level 0. Within a level the branches are sorted by
+// decreasing length and stored interleaved in blocks of block_width
+// branches, as the cells of matrix_state_interleaved. A block has as many
+// rows as its longest branch, and shorter branches are padded at the start,
+// so that the last CVs of all branches of a block share the last row.
+// Padding rows are identity rows.
+//
+// The backward sweep runs from the deepest level to the roots: each branch
+// subtracts the contributions of its children from its last CV, eliminates
+// its CVs, and stores its own contribution to its parent CV for the next
+// level. Storing the contributions per branch means that sibling branches
+// never write to the same CV. The forward sweep then runs from the roots to
+// the deepest level. The blocks of a level are independent in both sweeps,
+// and are split into tasks on the thread pool if the level is large enough.
+//
+// The coupling of the first CV of a branch to its parent is kept per branch,
+// not in the interleaved rows. The solution is returned in the CV order of
+// matrix_state.
+
+template <typename T, typename I>
+struct matrix_state_fine {
+public:
+    using value_type = T;
+    using index_type = I;
+
+    using array = padded_vector<value_type>;
+    using const_view = const array&;
+
+    using iarray = padded_vector<index_type>;
+
+    // Without native SIMD support, blocks are of single branches.
+    static constexpr unsigned block_width = simd::simd_abi::native_width<value_type>::value;
+
+    using simd_value = simd::simd<value_type, block_width>;
+    using simd_index = simd::simd<index_type, block_width>;
+
+    // Levels are only split into tasks of at least this many rows.
+    static constexpr index_type min_task_rows = 512;
+
+    // Blocks of level l are [level_divs[l], level_divs[l+1]).
+    std::vector<index_type> level_divs;
+
+    // Start of each block in the interleaved arrays, and number of rows of
+    // each block.
+    std::vector<index_type> block_start;
+    std::vector<index_type> block_rows;
+
+    // Branch in each lane of each block, or -1 for empty lanes. Branches are
+    // numbered in block and lane order.
+    std::vector<index_type> lane_branch;
+
+    // Interleaved index of the first row of each branch, and of the parent
+    // of its first CV, or -1 for the root branch of a cell.
+    std::vector<index_type> branch_first_row;
+    std::vector<index_type> branch_parent_row;
+
+    // Integration domain of each branch.
+    std::vector<index_type> branch_intdom;
+
+    // Face conductance between the first CV of each branch and its parent.
+    std::vector<value_type> branch_cond;    // [μS]
+
+    // Children of branch b are branch_children[branch_child_divs[b]] to
+    // branch_children[branch_child_divs[b+1]-1].
+    std::vector<index_type> branch_child_divs;
+    std::vector<index_type> branch_children;
+
+    // Flat CV of each interleaved row, or -1 for padding rows.
+    iarray cv_index;
+
+    // Integration domain of each interleaved row; zero for padding rows.
+    iarray row_intdom;
+
+    array d;     // [μS]
+    array u;     // [μS]
+    array rhs;   // [nA]
+
+    // Interleaved copies of the CV data. Padding rows have zero capacitance
+    // and area, and unit invariant diagonal. The invariant coupling of the
+    // first CV of a branch is zero.
+    array cv_capacitance;      // [pF]
+    array cv_area;             // [μm^2]
+    array invariant_d;         // [μS]
+    array invariant_u;         // [μS]
+
+    matrix_state_fine() = default;
+
+    matrix_state_fine(const std::vector<index_type>& p,
+                 const std::vector<index_type>& cell_cv_divs,
+                 const std::vector<value_type>& cap,
+                 const std::vector<value_type>& cond,
+                 const std::vector<value_type>& area,
+                 const std::vector<index_type>& cell_to_intdom):
+        solution_(p.size())
+    {
+        arb_assert(cap.size() == p.size());
+        arb_assert(cond.size() == p.size());
+        arb_assert(cell_cv_divs.back() == (index_type)p.size());
+
+        const index_type ncv = p.size();
+        const index_type ncells = cell_cv_divs.size()-1;
+
+        std::vector<index_type> cv_to_intdom(ncv);
+        for (auto c: util::make_span(ncells)) {
+            for (auto i: util::make_span(cell_cv_divs[c], cell_cv_divs[c+1])) {
+                cv_to_intdom[i] = cell_to_intdom[c];
+            }
+        }
+
+        // Split the CVs into branches, in CV order.
+        std::vector<index_type> num_children(ncv, 0);
+        for (auto i: util::make_span(ncv)) {
+            if (p[i]!=i) ++num_children[p[i]];
+        }
+
+        std::vector<index_type> first, parent_branch, depth;
+        std::vector<index_type> cv_branch(ncv);
+        for (auto i: util::make_span(ncv)) {
+            bool root = p[i]==i;
+            if (root || p[i]!=i-1 || num_children[p[i]]>1) {
+                parent_branch.push_back(root? -1: cv_branch[p[i]]);
+                depth.push_back(root? 0: depth[cv_branch[p[i]]]+1);
+                first.push_back(i);
+            }
+            cv_branch[i] = first.size()-1;
+        }
+        const index_type nbranch = first.size();
+        first.push_back(ncv);
+        auto length = [&](index_type b) { return first[b+1]-first[b]; };
+
+        // Order branches by level, and by decreasing length within a level.
+        std::vector<index_type> order(nbranch), position(nbranch);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+            [&](index_type a, index_type b) {
+                return depth[a]<depth[b] || (depth[a]==depth[b] && length(a)>length(b));
+            });
+        for (auto k: util::make_span(nbranch)) {
+            position[order[k]] = k;
+        }
+
+        // Blocks of each level.
+        index_type nrows = 0;
+        level_divs.assign(1, 0);
+        for (index_type k = 0; k<nbranch;) {
+            auto l = depth[order[k]];
+            while (k<nbranch && depth[order[k]]==l) {
+                block_start.push_back(nrows);
+                block_rows.push_back(length(order[k]));
+                nrows += block_rows.back()*block_width;
+                for (unsigned lane = 0; lane<block_width; ++lane) {
+                    lane_branch.push_back(k<nbranch && depth[order[k]]==l? k++: -1);
+                }
+            }
+            level_divs.push_back(block_start.size());
+        }
+
+        cv_index = iarray(nrows, -1);
+        row_intdom = iarray(nrows, 0);
+        d = array(nrows, 0);
+        u = array(nrows, 0);
+        rhs = array(nrows, 0);
+        cv_capacitance = array(nrows, 0);
+        cv_area = array(nrows, 0);
+        invariant_d = array(nrows, 1);
+        invariant_u = array(nrows, 0);
+
+        std::vector<index_type> cv_row(ncv);
+        branch_first_row.resize(nbranch);
+        for (auto blk: util::make_span(block_start.size())) {
+            for (auto lane: util::make_span(block_width)) {
+                auto k = lane_branch[blk*block_width+lane];
+                if (k<0) continue;
+
+                auto b = order[k];
+                auto r = block_start[blk]+(block_rows[blk]-length(b))*block_width+lane;
+                branch_first_row[k] = r;
+                for (auto i: util::make_span(first[b], first[b+1])) {
+                    cv_index[r] = i;
+                    cv_row[i] = r;
+                    row_intdom[r] = cv_to_intdom[i];
+                    cv_capacitance[r] = cap[i];
+                    cv_area[r] = area[i];
+                    invariant_d[r] = 0;
+                    r += block_width;
+                }
+            }
+        }
+
+        for (auto i: util::make_span(1, ncv)) {
+            auto gij = cond[i];
+            invariant_d[cv_row[i]] += gij;
+            invariant_d[cv_row[p[i]]] += gij;
+            if (i!=first[cv_branch[i]]) {
+                invariant_u[cv_row[i]] = -gij;
+            }
+        }
+
+        branch_child_divs.assign(1, 0);
+        for (auto k: util::make_span(nbranch)) {
+            auto b = order[k];
+            auto i = first[b];
+            bool root = parent_branch[b]<0;
+            branch_parent_row.push_back(root? -1: cv_row[p[i]]);
+            branch_intdom.push_back(cv_to_intdom[i]);
+            branch_cond.push_back(root? 0: cond[i]);
+            branch_child_divs.push_back(0);
+        }
+        for (auto k: util::make_span(nbranch)) {
+            auto pb = parent_branch[order[k]];
+            if (pb>=0) ++branch_child_divs[position[pb]+1];
+        }
+        std::partial_sum(branch_child_divs.begin(), branch_child_divs.end(), branch_child_divs.begin());
+
+        branch_children.resize(branch_child_divs.back());
+        std::vector<index_type> child_pos(branch_child_divs.begin(), branch_child_divs.end()-1);
+        for (auto k: util::make_span(nbranch)) {
+            auto pb = parent_branch[order[k]];
+            if (pb>=0) branch_children[child_pos[position[pb]]++] = k;
+        }
+
+        branch_u_ = array(nbranch, 0);
+        contrib_d_ = array(nbranch, 0);
+        contrib_rhs_ = array(nbranch, 0);
+        set_cell_blocks(1, nullptr);
+    }
+
+    const_view solution() const {
+        return solution_;
+    }
+
+    // Split each level, and the blocks of all levels for assembly, into at
+    // most n_blocks tasks with roughly equal numbers of rows, which run in
+    // parallel on the thread pool.
+    void set_cell_blocks(unsigned n_blocks, task_system_handle threads) {
+        const index_type nlevels = level_divs.size()-1;
+
+        task_divs_.clear();
+        level_task_divs_.assign(1, 0);
+        for (auto l: util::make_span(nlevels)) {
+            split_blocks(level_divs[l], level_divs[l+1], n_blocks);
+            level_task_divs_.push_back(task_divs_.size());
+        }
+        split_blocks(0, block_start.size(), n_blocks);
+        threads_ = std::move(threads);
+    }
+
+    // Assemble the matrix, as for matrix_state. Lanes with zero dt are
+    // assembled as identity rows with the voltage as right hand side.
+    void assemble(const_view dt_intdom, const_view voltage, const_view current, const_view conductivity) {
+        for_each_task(level_task_divs_.back(), task_divs_.size(), [&](index_type first, index_type last) {
+            for (auto blk: util::make_span(first, last)) {
+                assemble_block(blk, dt_intdom, voltage, current, conductivity);
+            }
+        });
+    }
+
+    void solve() {
+        const index_type nlevels = level_divs.size()-1;
+
+        for (auto l = nlevels-1; l>=0; --l) {
+            for_each_task(level_task_divs_[l], level_task_divs_[l+1], [&](index_type first, index_type last) {
+                for (auto blk: util::make_span(first, last)) backward(blk);
+            });
+        }
+        for (auto l: util::make_span(nlevels)) {
+            for_each_task(level_task_divs_[l], level_task_divs_[l+1], [&](index_type first, index_type last) {
+                for (auto blk: util::make_span(first, last)) forward(blk);
+            });
+        }
+    }
+
+private:
+    array solution_;
+
+    // Assembled coupling of each branch to its parent, and contributions of
+    // each branch to the diagonal and right hand side of its parent CV.
+    array branch_u_;
+    array contrib_d_;
+    array contrib_rhs_;
+
+    // Ranges of blocks run in parallel: the tasks of level l are delimited
+    // by task_divs_[level_task_divs_[l]] to task_divs_[level_task_divs_[l+1]-1],
+    // and the assembly tasks by the remaining entries.
+    std::vector<index_type> task_divs_;
+    std::vector<index_type> level_task_divs_;
+
+    task_system_handle threads_;
+
+    // Split blocks [first, last) into tasks, appended to task_divs_.
+    void split_blocks(index_type first, index_type last, unsigned n_blocks) {
+        index_type rows = 0;
+        for (auto blk: util::make_span(first, last)) {
+            rows += block_rows[blk]*block_width;
+        }
+        index_type n_tasks = std::min<index_type>(std::max(n_blocks, 1u), std::max<index_type>(1, rows/min_task_rows));
+
+        auto start = task_divs_.size();
+        task_divs_.push_back(first);
+        index_type r = 0;
+        for (auto blk: util::make_span(first, last)) {
+            index_type k = task_divs_.size()-start;
+            if (blk>first && (std::size_t)r*n_tasks>=(std::size_t)k*rows) {
+                task_divs_.push_back(blk);
+            }
+            r += block_rows[blk]*block_width;
+        }
+        task_divs_.push_back(last);
+    }
+
+    // Call f(task_divs_[k], task_divs_[k+1]) for k in [first, last-1), in
+    // parallel if there is more than one task.
+    template <typename F>
+    void for_each_task(index_type first, index_type last, F&& f) {
+        const index_type n_tasks = last-first-1;
+        if (n_tasks>1) {
+            threading::parallel_for::apply(first, last-1, threads_.get(),
+                [&](int k) { f(task_divs_[k], task_divs_[k+1]); });
+        }
+        else if (n_tasks==1) {
+            f(task_divs_[first], task_divs_[first+1]);
+        }
+    }
+
+    void assemble_block(index_type blk, const_view dt_intdom, const_view voltage, const_view current, const_view conductivity) {
+        using simd::indirect;
+
+        for (auto j: util::make_span(block_rows[blk])) {
+            auto r = block_start[blk]+j*block_width;
+
+            simd_index intdom(row_intdom.data()+r);
+            simd_value dt(indirect(dt_intdom.data(), intdom));
+            auto active = dt>simd_value(value_type(0));
+
+            simd_value oodt_factor = value_type(0);
+            simd::where(active, oodt_factor) = simd_value(1e-3)/dt; // [1/µs]
+
+            // Padding rows read the first CV.
+            simd_index cv(cv_index.data()+r);
+            simd::where(cv<simd_index(index_type(0)), cv) = simd_index(index_type(0));
+
+            simd_value v(indirect(voltage.data(), cv));
+            simd_value i(indirect(current.data(), cv));
+            simd_value g(indirect(conductivity.data(), cv));
+
+            simd_value area_factor = simd_value(1e-3)*simd_value(cv_area.data()+r); // [1e-9·m²]
+            simd_value gi = oodt_factor*simd_value(cv_capacitance.data()+r) + area_factor*g; // [μS]
+
+            simd_value dr = gi + simd_value(invariant_d.data()+r);
+            simd_value ur(invariant_u.data()+r);
+            // convert current to units nA
+            simd_value rhsr = gi*v - area_factor*i;
+
+            simd::where(!active, dr) = value_type(1);
+            simd::where(!active, ur) = value_type(0);
+            simd::where(!active, rhsr) = v;
+
+            dr.copy_to(d.data()+r);
+            ur.copy_to(u.data()+r);
+            rhsr.copy_to(rhs.data()+r);
+        }
+
+        for (auto k: util::make_span(blk*block_width, (blk+1)*block_width)) {
+            auto b = lane_branch[k];
+            if (b<0) continue;
+            branch_u_[b] = dt_intdom[branch_intdom[b]]>0? -branch_cond[b]: 0;
+        }
+    }
+
+    void backward(index_type blk) {
+        const auto start = block_start[blk];
+        const auto rows = block_rows[blk];
+        const auto last = start+(rows-1)*block_width;
+
+        for (auto lane: util::make_span(block_width)) {
+            auto b = lane_branch[blk*block_width+lane];
+            if (b<0) continue;
+            for (auto k: util::make_span(branch_child_divs[b], branch_child_divs[b+1])) {
+                auto c = branch_children[k];
+                d[last+lane] -= contrib_d_[c];
+                rhs[last+lane] -= contrib_rhs_[c];
+            }
+        }
+
+        for (auto j = rows-1; j>0; --j) {
+            auto r = start+j*block_width;
+            auto q = r-block_width;
+
+            simd_value ur(u.data()+r);
+            simd_value factor = ur/simd_value(d.data()+r);
+            simd_value dq = simd_value(d.data()+q) - factor*ur;
+            simd_value rhsq = simd_value(rhs.data()+q) - factor*simd_value(rhs.data()+r);
+            dq.copy_to(d.data()+q);
+            rhsq.copy_to(rhs.data()+q);
+        }
+
+        for (auto lane: util::make_span(block_width)) {
+            auto b = lane_branch[blk*block_width+lane];
+            if (b<0) continue;
+            auto r = branch_first_row[b];
+            auto factor = branch_u_[b] / d[r];
+            contrib_d_[b] = factor * branch_u_[b];
+            contrib_rhs_[b] = factor * rhs[r];
+        }
+    }
+
+    // Also copies the solution of the block to solution_.
+    void forward(index_type blk) {
+        const auto start = block_start[blk];
+        const auto rows = block_rows[blk];
+
+        for (auto lane: util::make_span(block_width)) {
+            auto b = lane_branch[blk*block_width+lane];
+            if (b<0 || branch_parent_row[b]<0) continue;
+            rhs[branch_first_row[b]] -= branch_u_[b] * rhs[branch_parent_row[b]];
+        }
+
+        simd_value rhsq = simd_value(rhs.data()+start)/simd_value(d.data()+start);
+        rhsq.copy_to(rhs.data()+start);
+        for (auto j = 1; j<rows; ++j) {
+            auto r = start+j*block_width;
+
+            simd_value rhsr = (simd_value(rhs.data()+r) - simd_value(u.data()+r)*rhsq)/simd_value(d.data()+r);
+            rhsr.copy_to(rhs.data()+r);
+            rhsq = rhsr;
+        }
+
+        for (auto r: util::make_span(start, start+rows*block_width)) {
+            if (cv_index[r]>=0) solution_[cv_index[r]] = rhs[r];
+        }
+    }
+};
+
+} // namespace multicore
+} // namespace arb
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include <arbor/assert.hpp>
+#include <arbor/simd/simd.hpp>
+
+#include "threading/threading.hpp"
+#include "util/partition.hpp"
+#include "util/span.hpp"
+
+#include "multicore_common.hpp"
+
+namespace arb {
+namespace multicore {
+
+// Hines matrices of cells stored interleaved in blocks of block_width cells,
+// so that assembly and the backward and forward sweeps are performed with
+// SIMD operations across the cells of a block.
+//
+// Cells are sorted by decreasing size before being grouped into blocks, so
+// that cells of a block have similar sizes. The matrices of a block are
+// padded to the size of its largest cell: row j of the cell in lane l of a
+// block is stored at block_start+j*block_width+l. Padding rows are identity
+// rows that are not coupled to the rest of the matrix.
+//
+// The solution is returned in the flat CV order of matrix_state.
+
+template <typename T, typename I>
+struct matrix_state_interleaved {
+public:
+    using value_type = T;
+    using index_type = I;
+
+    using array = padded_vector<value_type>;
+    using const_view = const array&;
+
+    using iarray = padded_vector<index_type>;
+
+    // Without native SIMD support, blocks are of single cells.
+    static constexpr unsigned block_width = simd::simd_abi::native_width<value_type>::value;
+
+    using simd_value = simd::simd<value_type, block_width>;
+    using simd_index = simd::simd<index_type, block_width>;
+
+    // Start of each block in the interleaved arrays, and number of rows
+    // (the size of the largest cell) of each block.
+    std::vector<index_type> block_start;
+    std::vector<index_type> block_rows;
+
+    // Interleaved index of the parent of each row. The padding rows and the
+    // first row of each lane refer to the first row of the lane.
+    iarray parent;
+
+    // Constraint on the parent indices of each interleaved row: contiguous
+    // if the parents of all lanes are in the same row, else independent.
+    std::vector<simd::index_constraint> parent_constraint;
+
+    // Flat CV of each interleaved row; zero for padding rows.
+    iarray cv_index;
+
+    // Interleaved row of each flat CV.
+    iarray cv_row;
+
+    // Integration domain of each lane; zero for empty lanes.
+    iarray lane_intdom;
+
+    array d;     // [μS]
+    array u;     // [μS]
+    array rhs;   // [nA]
+
+    // Interleaved copies of the CV data. Padding rows have zero capacitance
+    // and area, and unit invariant diagonal.
+    array cv_capacitance;      // [pF]
+    array cv_area;             // [μm^2]
+    array invariant_d;         // [μS]
+    array invariant_u;         // [μS]
+
+    matrix_state_interleaved() = default;
+
+    matrix_state_interleaved(const std::vector<index_type>& p,
+                 const std::vector<index_type>& cell_cv_divs,
+                 const std::vector<value_type>& cap,
+                 const std::vector<value_type>& cond,
+                 const std::vector<value_type>& area,
+                 const std::vector<index_type>& cell_to_intdom):
+        solution_(p.size())
+    {
+        arb_assert(cap.size() == p.size());
+        arb_assert(cond.size() == p.size());
+        arb_assert(cell_cv_divs.back() == (index_type)p.size());
+
+        const index_type ncells = cell_cv_divs.size()-1;
+        auto cell_size = [&](index_type c) { return cell_cv_divs[c+1]-cell_cv_divs[c]; };
+
+        std::vector<index_type> order(ncells);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+            [&](index_type a, index_type b) { return cell_size(a)>cell_size(b); });
+
+        const index_type nblocks = (ncells+block_width-1)/block_width;
+        index_type n = 0;
+        for (auto b: util::make_span(nblocks)) {
+            block_start.push_back(n);
+            block_rows.push_back(cell_size(order[b*block_width]));
+            n += block_rows.back()*block_width;
+        }
+
+        parent = iarray(n);
+        cv_index = iarray(n, 0);
+        cv_row = iarray(p.size());
+        lane_intdom = iarray(nblocks*block_width, 0);
+        d = array(n, 0);
+        u = array(n, 0);
+        rhs = array(n, 0);
+        cv_capacitance = array(n, 0);
+        cv_area = array(n, 0);
+        invariant_d = array(n, 1);
+        invariant_u = array(n, 0);
+
+        for (auto b: util::make_span(nblocks)) {
+            for (auto l: util::make_span(block_width)) {
+                auto lane_first = block_start[b]+l;
+                for (auto j: util::make_span(block_rows[b])) {
+                    parent[lane_first+j*block_width] = lane_first;
+                }
+
+                index_type k = b*block_width+l;
+                if (k>=ncells) continue;
+
+                auto c = order[k];
+                lane_intdom[k] = cell_to_intdom[c];
+
+                auto first = cell_cv_divs[c];
+                auto row = [&](index_type i) { return lane_first+(i-first)*block_width; };
+                for (auto i: util::make_span(first, cell_cv_divs[c+1])) {
+                    auto r = row(i);
+                    cv_index[r] = i;
+                    cv_row[i] = r;
+                    cv_capacitance[r] = cap[i];
+                    cv_area[r] = area[i];
+                    invariant_d[r] = 0;
+                }
+                for (auto i: util::make_span(first+1, cell_cv_divs[c+1])) {
+                    auto gij = cond[i];
+                    auto r = row(i);
+                    parent[r] = row(p[i]);
+                    invariant_u[r] = -gij;
+                    invariant_d[r] += gij;
+                    invariant_d[parent[r]] += gij;
+                }
+            }
+        }
+
+        for (index_type r = 0; r<n; r += block_width) {
+            bool contiguous = true;
+            for (auto l: util::make_span(block_width)) {
+                contiguous &= parent[r+l]==parent[r]+(index_type)l;
+            }
+            parent_constraint.push_back(contiguous? simd::index_constraint::contiguous: simd::index_constraint::independent);
+        }
+    }
+
+    const_view solution() const {
+        return solution_;
+    }
+
+    // Split the blocks into at most n_blocks contiguous ranges with roughly
+    // equal numbers of rows, which are assembled and solved in parallel on
+    // the thread pool.
+    void set_cell_blocks(unsigned n_blocks, task_system_handle threads) {
+        const index_type nblocks = block_start.size();
+        const auto n = d.size();
+
+        range_divs_.assign(1, 0);
+        if (n_blocks>1 && nblocks>1) {
+            for (auto b: util::make_span(1, nblocks)) {
+                auto k = range_divs_.size();
+                if ((std::size_t)block_start[b]*n_blocks>=k*n) {
+                    range_divs_.push_back(b);
+                }
+            }
+        }
+        range_divs_.push_back(nblocks);
+        threads_ = std::move(threads);
+    }
+
+    // Assemble the matrix, as for matrix_state. Lanes with zero dt are
+    // assembled as identity rows with the voltage as right hand side.
+    void assemble(const_view dt_intdom, const_view voltage, const_view current, const_view conductivity) {
+        for_each_range([&](index_type first, index_type last) {
+            for (auto b: util::make_span(first, last)) {
+                assemble_block(b, dt_intdom, voltage, current, conductivity);
+            }
+        });
+    }
+
+    void solve() {
+        for_each_range([&](index_type first, index_type last) {
+            for (auto b: util::make_span(first, last)) {
+                solve_block(b);
+            }
+        });
+
+        for (auto i: util::make_span(solution_.size())) {
+            solution_[i] = rhs[cv_row[i]];
+        }
+    }
+
+private:
+    array solution_;
+
+    // Partition of blocks into ranges, empty if the matrix is not split.
+    std::vector<index_type> range_divs_;
+    task_system_handle threads_;
+
+    template <typename F>
+    void for_each_range(F&& f) {
+        const index_type n_ranges = range_divs_.size()? range_divs_.size()-1: 0;
+        if (n_ranges>1) {
+            threading::parallel_for::apply(0, n_ranges, threads_.get(),
+                [&](int i) { f(range_divs_[i], range_divs_[i+1]); });
+        }
+        else {
+            f(0, (index_type)block_start.size());
+        }
+    }
+
+    void assemble_block(index_type b, const_view dt_intdom, const_view voltage, const_view current, const_view conductivity) {
+        using simd::indirect;
+
+        simd_index intdom(lane_intdom.data()+b*block_width);
+        simd_value dt(indirect(dt_intdom.data(), intdom));
+        auto active = dt>simd_value(value_type(0));
+
+        simd_value oodt_factor = value_type(0);
+        simd::where(active, oodt_factor) = simd_value(1e-3)/dt; // [1/µs]
+
+        for (auto j: util::make_span(block_rows[b])) {
+            auto r = block_start[b]+j*block_width;
+
+            simd_index cv(cv_index.data()+r);
+            simd_value v(indirect(voltage.data(), cv));
+            simd_value i(indirect(current.data(), cv));
+            simd_value g(indirect(conductivity.data(), cv));
+
+            simd_value area_factor = simd_value(1e-3)*simd_value(cv_area.data()+r); // [1e-9·m²]
+            simd_value gi = oodt_factor*simd_value(cv_capacitance.data()+r) + area_factor*g; // [μS]
+
+            simd_value dr = gi + simd_value(invariant_d.data()+r);
+            simd_value ur(invariant_u.data()+r);
+            // convert current to units nA
+            simd_value rhsr = gi*v - area_factor*i;
+
+            simd::where(!active, dr) = value_type(1);
+            simd::where(!active, ur) = value_type(0);
+            simd::where(!active, rhsr) = v;
+
+            dr.copy_to(d.data()+r);
+            ur.copy_to(u.data()+r);
+            rhsr.copy_to(rhs.data()+r);
+        }
+    }
+
+    void solve_block(index_type b) {
+        using simd::indirect;
+
+        const auto first = block_start[b];
+        const auto rows = block_rows[b];
+
+        // backward sweep
+        for (auto j = rows-1; j>0; --j) {
+            auto r = first+j*block_width;
+
+            simd_index pr(parent.data()+r);
+            auto constraint = parent_constraint[r/block_width];
+            simd_value ur(u.data()+r);
+            simd_value factor = ur/simd_value(d.data()+r);
+
+            indirect(d.data(), pr, constraint) -= factor*ur;
+            indirect(rhs.data(), pr, constraint) -= factor*simd_value(rhs.data()+r);
+        }
+        simd_value rhs0 = simd_value(rhs.data()+first)/simd_value(d.data()+first);
+        rhs0.copy_to(rhs.data()+first);
+
+        // forward sweep
+        for (auto j = 1; j<rows; ++j) {
+            auto r = first+j*block_width;
+
+            simd_index pr(parent.data()+r);
+            simd_value rhsp(indirect(rhs.data(), pr, parent_constraint[r/block_width]));
+            simd_value rhsr = (simd_value(rhs.data()+r) - simd_value(u.data()+r)*rhsp)/simd_value(d.data()+r);
+            rhsr.copy_to(rhs.data()+r);
+        }
+    }
+};
+
+} // namespace multicore
+} // namespace arb
@@ -11,6 +11,7 @@
 #include <arbor/mechanism.hpp>
 #include <arbor/util/optional.hpp>
 
+#include "util/bytes.hpp"
 #include "util/index_into.hpp"
 #include "util/maputil.hpp"
 #include "util/padded_alloc.hpp"
@@ -130,10 +131,10 @@ void mechanism::instantiate(unsigned id, backend::shared_state& shared, const me
     std::size_t n_field = fields.size();
 
     // (First sub-array of data_ is used for width_, below.)
-    data_ = array((1+n_field)*width_padded_, NAN, pad);
+    data_ = state_array((1+n_field)*width_padded_, NAN, pad);
     for (std::size_t i = 0; i<n_field; ++i) {
         // Take reference to corresponding derived (generated) mechanism value pointer member.
-        fvm_value_type*& field_ptr = *(fields[i].second);
+        state_type*& field_ptr = *(fields[i].second);
         field_ptr = data_.data()+(i+1)*width_padded_;
 
         if (auto opt_value = value_by_key(field_default_table(), fields[i].first)) {
@@ -187,8 +188,8 @@ void mechanism::set_parameter(const std::string& key, const std::vector<fvm_valu
 
         if (width_>0) {
             // Retrieve corresponding derived (generated) mechanism value pointer member.
-            value_type* field_ptr = *opt_ptr.value();
-            util::range<value_type*> field(field_ptr, field_ptr+width_padded_);
+            state_type* field_ptr = *opt_ptr.value();
+            util::range<state_type*> field(field_ptr, field_ptr+width_padded_);
 
             copy_extend(values, field, values.back());
         }
@@ -198,6 +199,38 @@ void mechanism::set_parameter(const std::string& key, const std::vector<fvm_valu
     }
 }
 
+std::vector<mechanism::size_type> mechanism::instance_divs(const std::vector<index_type>& cv_divs) const {
+    auto first = node_index_.begin();
+    auto last = first+width_;
+    if (!std::is_sorted(first, last)) return {};
+
+    std::vector<size_type> divs;
+    for (auto cv: cv_divs) {
+        divs.push_back(std::lower_bound(first, last, cv)-first);
+    }
+    return divs;
+}
+
+void mechanism::serialize(std::vector<char>& buf) const {
+    util::write_bytes(buf, data_);
+}
+
+void mechanism::deserialize(const char*& p) {
+    // Field views point into data_, which is not reallocated as long as
+    // the size is unchanged.
+    auto n = data_.size();
+    util::read_bytes(p, data_);
+    if (data_.size()!=n) {
+        throw arbor_internal_error("multicore/mechanism: state of different size");
+    }
+}
+
+void mechanism::append_state(std::vector<value_type>& values) {
+    for (auto& state: state_table()) {
+        values.insert(values.end(), *state.second, *state.second+width_);
+    }
+}
+
 void mechanism::initialize() {
     nrn_init();
 
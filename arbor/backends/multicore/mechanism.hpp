@@ -24,6 +24,7 @@ namespace multicore {
 class mechanism: public arb::concrete_mechanism<arb::multicore::backend> {
 public:
     using value_type = fvm_value_type;
+    using state_type = fvm_state_type;
     using index_type = fvm_index_type;
     using size_type = fvm_size_type;
 
@@ -32,13 +33,14 @@ protected:
     using deliverable_event_stream = backend::deliverable_event_stream;
 
     using array  = arb::multicore::array;
+    using state_array = arb::multicore::state_array;
     using iarray = arb::multicore::iarray;
 
     struct ion_state_view {
         value_type* current_density;
         value_type* reversal_potential;
-        value_type* internal_concentration;
-        value_type* external_concentration;
+        state_type* internal_concentration;
+        state_type* external_concentration;
         value_type* ionic_charge;
     };
 
@@ -50,7 +52,7 @@ public:
     std::size_t memory() const override {
         std::size_t s = object_sizeof();
 
-        s += sizeof(value_type) * data_.size();
+        s += sizeof(state_type) * data_.size();
         s += sizeof(size_type) * width_padded_ * (n_ion_ + 1); // node and ion indices.
         return s;
     }
@@ -65,6 +67,28 @@ public:
 
     void set_parameter(const std::string& key, const std::vector<fvm_value_type>& values) override;
 
+    // Integration of the instances in [begin, end) only, used by the
+    // cache-blocked step schedule (see step_tiles). Provided by mechanisms
+    // for which has_range_kernels() is true: generated mechanisms and the
+    // builtin stimulus. With explicit vectorization, the whole SIMD vectors
+    // in the range are updated with SIMD operations and the instances before
+    // and after one by one, so that no instance outside the range is touched.
+    virtual bool has_range_kernels() const { return false; }
+    virtual void nrn_state_range(size_type begin, size_type end) {}
+    virtual void nrn_current_range(size_type begin, size_type end) {}
+
+    // Partition of the instances by the partition cv_divs of the CVs, or an
+    // empty vector if the instances are not sorted by CV.
+    std::vector<size_type> instance_divs(const std::vector<index_type>& cv_divs) const;
+
+    // Append the state and parameter values of the instances to buf, or
+    // restore them from the values appended by a mechanism of the same layout.
+    void serialize(std::vector<char>& buf) const;
+    void deserialize(const char*& p);
+
+    // Append the values of the state variables of the instances to values.
+    void append_state(std::vector<value_type>& values);
+
 protected:
     size_type width_ = 0;        // Instance width (number of CVs/sites)
     size_type width_padded_ = 0; // Width rounded up to multiple of pad/alignment.
@@ -89,11 +113,11 @@ protected:
     iarray multiplicity_;
     bool mult_in_place_;
     constraint_partition index_constraints_;
-    const value_type* weight_;    // Points within data_ after instantiation.
+    const state_type* weight_;    // Points within data_ after instantiation.
 
     // Bulk storage for state and parameter variables.
 
-    array data_;
+    state_array data_;
 
     // Generated mechanism field, global and ion table lookup types.
     // First component is name, second is pointer to corresponing member in 
@@ -103,10 +127,10 @@ protected:
     using global_table_entry = std::pair<const char*, value_type*>;
     using mechanism_global_table = std::vector<global_table_entry>;
 
-    using state_table_entry = std::pair<const char*, value_type**>;
+    using state_table_entry = std::pair<const char*, state_type**>;
     using mechanism_state_table = std::vector<state_table_entry>;
 
-    using field_table_entry = std::pair<const char*, value_type**>;
+    using field_table_entry = std::pair<const char*, state_type**>;
     using mechanism_field_table = std::vector<field_table_entry>;
 
     using field_default_entry = std::pair<const char*, value_type>;
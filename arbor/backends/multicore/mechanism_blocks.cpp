@@ -0,0 +1,61 @@
+#include <cstddef>
+#include <vector>
+
+#include <arbor/fvm_types.hpp>
+#include <arbor/mechanism.hpp>
+
+#include "threading/threading.hpp"
+#include "util/rangeutil.hpp"
+#include "util/span.hpp"
+
+#include "backends/multicore/mechanism.hpp"
+#include "backends/multicore/mechanism_blocks.hpp"
+
+namespace arb {
+namespace multicore {
+
+mechanism_blocks::mechanism_blocks(const std::vector<mechanism_ptr>& mechanisms, const matrix_state& matrix) {
+    const auto& cell_divs = matrix.block_cell_divs();
+    if (cell_divs.size()<3) return;
+
+    for (auto& m: mechanisms) {
+        auto p = dynamic_cast<mechanism*>(m.get());
+        if (!p || !p->has_range_kernels()) return;
+        mechanisms_.push_back(p);
+    }
+
+    for (auto c: cell_divs) {
+        cv_divs_.push_back(matrix.cell_cv_divs[c]);
+    }
+
+    for (auto m: mechanisms_) {
+        instance_divs_.push_back(m->instance_divs(cv_divs_));
+        if (instance_divs_.back().empty()) {
+            *this = mechanism_blocks();
+            return;
+        }
+    }
+
+    threads_ = matrix.threads();
+}
+
+void mechanism_blocks::nrn_current() const {
+    threading::parallel_for::apply(0, size(), threads_.get(),
+        [&](std::size_t b) {
+            for (auto k: util::count_along(mechanisms_)) {
+                mechanisms_[k]->nrn_current_range(instance_divs_[k][b], instance_divs_[k][b+1]);
+            }
+        });
+}
+
+void mechanism_blocks::nrn_state() const {
+    threading::parallel_for::apply(0, size(), threads_.get(),
+        [&](std::size_t b) {
+            for (auto k: util::count_along(mechanisms_)) {
+                mechanisms_[k]->nrn_state_range(instance_divs_[k][b], instance_divs_[k][b+1]);
+            }
+        });
+}
+
+} // namespace multicore
+} // namespace arb
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <arbor/fvm_types.hpp>
+#include <arbor/mechanism.hpp>
+
+#include "backends/multicore/matrix_state.hpp"
+#include "threading/threading.hpp"
+
+namespace arb {
+namespace multicore {
+
+class mechanism;
+
+// Mechanism current and state updates split by the cell blocks of the
+// matrix (see matrix_state::set_cell_blocks). The instances of each
+// mechanism on the cells of a block are updated by one task, with the
+// blocks in parallel on the thread pool; blocks share no CVs, and the
+// mechanisms are updated in order within each block, so that the results
+// are the same as for a serial update.
+//
+// Blocks are only used if the matrix is split into more than one block and
+// all mechanisms have range kernels with instances sorted by CV; otherwise
+// the schedule is empty.
+
+class mechanism_blocks {
+public:
+    using matrix_state = arb::multicore::matrix_state<fvm_value_type, fvm_index_type>;
+
+    mechanism_blocks() = default;
+    mechanism_blocks(const std::vector<mechanism_ptr>& mechanisms, const matrix_state& matrix);
+
+    bool empty() const { return size()<2; }
+    std::size_t size() const { return cv_divs_.empty()? 0: cv_divs_.size()-1; }
+
+    void nrn_current() const;
+    void nrn_state() const;
+
+private:
+    std::vector<fvm_index_type> cv_divs_;
+    task_system_handle threads_;
+
+    std::vector<mechanism*> mechanisms_;
+    std::vector<std::vector<fvm_size_type>> instance_divs_; // Per mechanism, by block.
+};
+
+} // namespace multicore
+} // namespace arb
@@ -3,7 +3,7 @@
 // Storage classes and other common types across
 // multicore back end implementations.
 //
-// Defines array, iarray, and specialized multi-event stream classes.
+// Defines array, state_array, iarray, and specialized multi-event stream classes.
 
 #include <utility>
 #include <vector>
@@ -22,6 +22,7 @@ template <typename V>
 using padded_vector = std::vector<V, util::padded_allocator<V>>;
 
 using array  = padded_vector<fvm_value_type>;
+using state_array = padded_vector<fvm_state_type>;
 using iarray = padded_vector<fvm_index_type>;
 using gjarray = padded_vector<fvm_gap_junction>;
 
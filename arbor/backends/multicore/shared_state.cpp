@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <iterator>
 #include <iostream>
 #include <string>
 #include <unordered_map>
@@ -16,8 +17,11 @@
 
 #include "backends/event.hpp"
 #include "io/sepval.hpp"
+#include "util/bytes.hpp"
+#include "util/maputil.hpp"
 #include "util/padded_alloc.hpp"
 #include "util/rangeutil.hpp"
+#include "util/span.hpp"
 
 #include "multi_event_stream.hpp"
 #include "multicore_common.hpp"
@@ -86,6 +90,60 @@ void ion_state::reset() {
     std::copy(init_eX_.begin(), init_eX_.end(), eX_.begin());
 }
 
+// gap_junction_state methods:
+
+gap_junction_state::gap_junction_state(const std::vector<fvm_gap_junction>& gj, unsigned align):
+    cv(pad(align)), peer(pad(align)), weight(pad(align))
+{
+    if (gj.empty()) return;
+
+    std::vector<fvm_gap_junction> sorted(gj);
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [](const fvm_gap_junction& a, const fvm_gap_junction& b) { return a.loc.first<b.loc.first; });
+
+    // Padding junctions repeat the indices of the last junction, keeping the
+    // local CVs sorted, with zero weight.
+    auto n = math::round_up(sorted.size(), simd_width);
+    cv.resize(n, sorted.back().loc.first);
+    peer.resize(n, sorted.back().loc.second);
+    weight.resize(n, 0);
+    for (auto i: util::count_along(sorted)) {
+        cv[i] = sorted[i].loc.first;
+        peer[i] = sorted[i].loc.second;
+        weight[i] = sorted[i].weight;
+    }
+
+    index_constraints = make_constraint_partition(cv, n, simd_width);
+}
+
+// Blocks with repeated local CVs (constant and none constraints) are reduced
+// into the current density per CV, relying on the CVs being sorted.
+void gap_junction_state::add_current(const array& voltage, const array& peer_voltage, array& current_density) const {
+    auto add_block = [&](fvm_size_type i, simd::index_constraint constraint) {
+        simd_index_type local(cv.data()+i);
+        simd_index_type remote(peer.data()+i);
+
+        simd_value_type v(simd::indirect(voltage.data(), local, constraint));
+        simd_value_type v_peer(simd::indirect(peer_voltage.data(), remote));
+        simd_value_type w(weight.data()+i);
+
+        simd::indirect(current_density.data(), local, constraint) += w*(v-v_peer);
+    };
+
+    for (auto i: index_constraints.contiguous) {
+        add_block(i, simd::index_constraint::contiguous);
+    }
+    for (auto i: index_constraints.independent) {
+        add_block(i, simd::index_constraint::independent);
+    }
+    for (auto i: index_constraints.constant) {
+        add_block(i, simd::index_constraint::constant);
+    }
+    for (auto i: index_constraints.none) {
+        add_block(i, simd::index_constraint::none);
+    }
+}
+
 // shared_state methods:
 
 shared_state::shared_state(
@@ -103,11 +161,14 @@ shared_state::shared_state(
     n_cv(cv_to_intdom_vec.size()),
     n_gj(gj_vec.size()),
     cv_to_intdom(math::round_up(n_cv, alignment), pad(alignment)),
-    gap_junctions(math::round_up(n_gj, alignment), pad(alignment)),
+    gap_junctions(gj_vec, alignment),
     time(n_intdom, pad(alignment)),
     time_to(n_intdom, pad(alignment)),
     dt_intdom(n_intdom, pad(alignment)),
     dt_cv(n_cv, pad(alignment)),
+    dt_next(n_intdom, pad(alignment)),
+    voltage_rate(n_cv, pad(alignment)),
+    dt_error(n_intdom, pad(alignment)),
     voltage(n_cv, pad(alignment)),
     current_density(n_cv, pad(alignment)),
     conductivity(n_cv, pad(alignment)),
@@ -121,10 +182,6 @@ shared_state::shared_state(
         std::copy(cv_to_intdom_vec.begin(), cv_to_intdom_vec.end(), cv_to_intdom.begin());
         std::fill(cv_to_intdom.begin() + n_cv, cv_to_intdom.end(), cv_to_intdom_vec.back());
     }
-    if (n_gj>0) {
-        std::copy(gj_vec.begin(), gj_vec.end(), gap_junctions.begin());
-        std::fill(gap_junctions.begin()+n_gj, gap_junctions.end(), gj_vec.back());
-    }
 
     for (unsigned i = 0; i<n_cv; ++i) {
         temperature_degC[i] = temperature_K[i] - 273.15;
@@ -150,23 +207,62 @@ void shared_state::reset() {
     util::fill(conductivity, 0);
     util::fill(time, 0);
     util::fill(time_to, 0);
+    util::fill(dt_next, 0);
+    util::fill(voltage_rate, 0);
 
     for (auto& i: ion_data) {
         i.second.reset();
     }
 }
 
+void shared_state::serialize(std::vector<char>& buf) const {
+    for (auto a: {&time, &time_to, &dt_intdom, &dt_cv, &dt_next, &voltage_rate,
+                  &voltage, &current_density, &conductivity, &gj_halo_voltage})
+    {
+        util::write_bytes(buf, *a);
+    }
+
+    // Ions in name order, which does not depend on the hash table.
+    std::vector<std::string> names = util::assign_from(util::keys(ion_data));
+    util::sort(names);
+    for (auto& n: names) {
+        auto& ion = ion_data.at(n);
+        util::write_bytes(buf, ion.iX_);
+        util::write_bytes(buf, ion.eX_);
+        util::write_bytes(buf, ion.Xi_);
+        util::write_bytes(buf, ion.Xo_);
+    }
+}
+
+void shared_state::deserialize(const char*& p) {
+    for (auto a: {&time, &time_to, &dt_intdom, &dt_cv, &dt_next, &voltage_rate,
+                  &voltage, &current_density, &conductivity, &gj_halo_voltage})
+    {
+        util::read_bytes(p, *a);
+    }
+
+    std::vector<std::string> names = util::assign_from(util::keys(ion_data));
+    util::sort(names);
+    for (auto& n: names) {
+        auto& ion = ion_data.at(n);
+        util::read_bytes(p, ion.iX_);
+        util::read_bytes(p, ion.eX_);
+        util::read_bytes(p, ion.Xi_);
+        util::read_bytes(p, ion.Xo_);
+    }
+}
+
 void shared_state::zero_currents() {
     util::fill(current_density, 0);
     util::fill(conductivity, 0);
     for (auto& i: ion_data) {
-        i.second.zero_current();
+        if (i.second.write_current) i.second.zero_current();
     }
 }
 
 void shared_state::ions_init_concentration() {
     for (auto& i: ion_data) {
-        i.second.init_concentration();
+        if (i.second.write_concentration) i.second.init_concentration();
     }
 }
 
@@ -178,6 +274,70 @@ void shared_state::update_time_to(fvm_value_type dt_step, fvm_value_type tmax) {
     }
 }
 
+void shared_state::update_time_to_adaptive(fvm_value_type dt_min, fvm_value_type tmax) {
+    auto events = deliverable_events.marked_events();
+
+    for (fvm_size_type i = 0; i<n_intdom; ++i) {
+        auto t = time[i];
+        auto dt = std::max(dt_next[i], dt_min);
+        if (events.begin_marked(i)!=events.end_marked(i)) {
+            dt = dt_min;
+        }
+
+        if (!breakpoints.empty()) {
+            auto first = breakpoints.begin()+breakpoint_divs[i];
+            auto last = breakpoints.begin()+breakpoint_divs[i+1];
+            auto next = std::upper_bound(first, last, t);
+            if (next!=first && *std::prev(next)==t) {
+                dt = dt_min;
+            }
+            if (next!=last) {
+                dt = std::min(dt, *next-t);
+            }
+        }
+
+        time_to[i] = std::min(t+dt, tmax);
+    }
+}
+
+void shared_state::set_breakpoints(const std::vector<std::vector<fvm_value_type>>& intdom_breakpoints) {
+    breakpoints.clear();
+    breakpoint_divs.assign(1, 0);
+    for (auto& bp: intdom_breakpoints) {
+        breakpoints.insert(breakpoints.end(), bp.begin(), bp.end());
+        std::sort(breakpoints.end()-bp.size(), breakpoints.end());
+        breakpoint_divs.push_back(breakpoints.size());
+    }
+}
+
+void shared_state::update_dt_adaptive(const array& v_new, fvm_value_type tolerance, fvm_value_type dt_min, fvm_value_type dt_max) {
+    // The truncation error of a backward Euler step is dt²/2·|V''|, with
+    // V'' estimated from the change in dV/dt between successive steps. Take
+    // the maximum over the CVs of each integration domain.
+    util::fill(dt_error, 0);
+    for (fvm_size_type i = 0; i<n_cv; ++i) {
+        auto dt = dt_cv[i];
+        if (dt>0) {
+            auto rate = (v_new[i]-voltage[i])/dt;
+            auto& e = dt_error[cv_to_intdom[i]];
+            e = std::max(e, 0.5*dt*std::abs(rate-voltage_rate[i]));
+            voltage_rate[i] = rate;
+        }
+    }
+
+    // Scale the step by the usual error controller factor, limiting the
+    // growth per step. Steps shortened to meet an event or sample time do
+    // not reduce the next step unless the error is out of tolerance.
+    for (fvm_size_type j = 0; j<n_intdom; ++j) {
+        auto dt = dt_intdom[j];
+        if (dt>0) {
+            auto factor = dt_error[j]>0? std::min(0.9*std::sqrt(tolerance/dt_error[j]), 2.): 2.;
+            auto next = factor<1? dt*factor: std::max(dt*factor, dt_next[j]);
+            dt_next[j] = std::min(std::max(next, dt_min), dt_max);
+        }
+    }
+}
+
 void shared_state::set_dt() {
     for (fvm_size_type j = 0; j<n_intdom; j+=simd_width) {
         simd_value_type t(time.data()+j);
@@ -196,13 +356,20 @@ void shared_state::set_dt() {
 }
 
 void shared_state::add_gj_current() {
-    for (unsigned i = 0; i < n_gj; i++) {
-        auto gj = gap_junctions[i];
-        auto curr = gj.weight *
-                    (voltage[gj.loc.second] - voltage[gj.loc.first]); // nA
+    gap_junctions.add_current(voltage, voltage, current_density);
+}
 
-        current_density[gj.loc.first] -= curr;
-    }
+void shared_state::set_gj_halo(const std::vector<fvm_gap_junction>& halo, fvm_size_type n_peer) {
+    gj_halo = gap_junction_state(halo, alignment);
+    gj_halo_voltage = array(n_peer, 0., pad(alignment));
+}
+
+void shared_state::set_gj_halo_voltage(const std::vector<fvm_value_type>& peer_voltage) {
+    std::copy(peer_voltage.begin(), peer_voltage.end(), gj_halo_voltage.begin());
+}
+
+void shared_state::add_gj_halo_current() {
+    gj_halo.add_current(voltage, gj_halo_voltage, current_density);
 }
 
 std::pair<fvm_value_type, fvm_value_type> shared_state::time_bounds() const {
@@ -224,8 +391,31 @@ void shared_state::take_samples(
 
         // (Note: probably not worth explicitly vectorizing this.)
         for (auto p = begin; p<end; ++p) {
-            sample_time[p->offset] = time[i];
-            sample_value[p->offset] = *p->handle;
+            if (p->width>1) {
+                // Snapshot of a contiguous range, e.g. the CVs of a cell.
+                sample_time[p->offset] = time[i];
+                std::copy(p->handle, p->handle+p->width, &sample_value[p->offset]);
+                continue;
+            }
+
+            auto v = *p->handle;
+            auto& value = sample_value[p->offset];
+
+            switch (p->op) {
+            case sample_op::assign:
+                sample_time[p->offset] = time[i];
+                value = v;
+                break;
+            case sample_op::add:
+                value += v;
+                break;
+            case sample_op::min:
+                value = std::min(value, v);
+                break;
+            case sample_op::max:
+                value = std::max(value, v);
+                break;
+            }
         }
     }
 }
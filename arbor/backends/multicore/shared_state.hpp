@@ -21,6 +21,7 @@
 #include "threshold_watcher.hpp"
 
 #include "multicore_common.hpp"
+#include "partition_by_constraint.hpp"
 
 namespace arb {
 namespace multicore {
@@ -43,8 +44,8 @@ struct ion_state {
     iarray node_index_;     // Instance to CV map.
     array iX_;              // (A/m²) current density
     array eX_;              // (mV) reversal potential
-    array Xi_;              // (mM) internal concentration
-    array Xo_;              // (mM) external concentration
+    state_array Xi_;        // (mM) internal concentration
+    state_array Xo_;        // (mM) external concentration
 
     array init_Xi_;         // (mM) area-weighted initial internal concentration
     array init_Xo_;         // (mM) area-weighted initial external concentration
@@ -52,6 +53,11 @@ struct ion_state {
 
     array charge;           // charge of ionic species (global value, length 1)
 
+    // Whether mechanisms write the current and the concentrations. If not,
+    // they keep their reset values and are not updated in each step.
+    bool write_current = true;
+    bool write_concentration = true;
+
     ion_state() = default;
 
     ion_state(
@@ -74,6 +80,30 @@ struct ion_state {
     void reset();
 };
 
+/*
+ * Gap junctions stored as a structure of arrays, sorted by local CV and
+ * padded to a multiple of the SIMD width with zero weight junctions, so that
+ * the current contributions are computed with SIMD gathers and reduced into
+ * the current density of the local CVs without conflicts. The local CV
+ * indices of each SIMD block are classified by index constraint.
+ */
+
+struct gap_junction_state {
+    iarray cv;                // Local CV.
+    iarray peer;              // Index of the peer voltage.
+    array weight;             // Conductance per area of the local CV [kS/m²].
+    constraint_partition index_constraints;
+
+    gap_junction_state() = default;
+    gap_junction_state(const std::vector<fvm_gap_junction>& gj, unsigned align);
+
+    // Add the current density of the junctions, with peer voltages looked
+    // up in peer_voltage, to current_density.
+    void add_current(const array& voltage, const array& peer_voltage, array& current_density) const;
+
+    std::size_t size() const { return cv.size(); }
+};
+
 struct shared_state {
     unsigned alignment = 1;   // Alignment and padding multiple.
     util::padded_allocator<> alloc;  // Allocator with corresponging alignment/padding.
@@ -83,11 +113,21 @@ struct shared_state {
     fvm_size_type n_gj = 0;   // Total number of GJs.
 
     iarray cv_to_intdom;      // Maps CV index to integration domain index.
-    gjarray  gap_junctions;   // Stores gap_junction info.
+    gap_junction_state gap_junctions; // Gap junctions between CVs of the group.
+    gap_junction_state gj_halo;       // Gap junctions to cells of other groups: CV and index of peer voltage.
+    array    gj_halo_voltage; // Voltage of the peers of gj_halo [mV].
     array time;               // Maps intdom index to integration start time [ms].
     array time_to;            // Maps intdom index to integration stop time [ms].
     array dt_intdom;          // Maps  index to (stop time) - (start time) [ms].
     array dt_cv;              // Maps CV index to dt [ms].
+    array dt_next;            // Maps intdom index to next adaptive step size, or zero [ms].
+    array voltage_rate;       // Maps CV index to dV/dt over the last step [mV/ms].
+    array dt_error;           // Scratch: maps intdom index to truncation error of the last step [mV].
+
+    // Sorted times of discontinuities in the stimuli of each integration
+    // domain, partitioned by breakpoint_divs, at which adaptive steps end.
+    std::vector<fvm_value_type> breakpoints;
+    std::vector<fvm_size_type> breakpoint_divs;
     array voltage;            // Maps CV index to membrane voltage [mV].
     array current_density;    // Maps CV index to membrane current density contributions [A/m²].
     array conductivity;       // Maps CV index to membrane conductivity [kS/m²].
@@ -129,12 +169,34 @@ struct shared_state {
     // Set time_to to earliest of time+dt_step and tmax.
     void update_time_to(fvm_value_type dt_step, fvm_value_type tmax);
 
+    // Set time_to to earliest of time+max(dt_next, dt_min), the next
+    // breakpoint and tmax. Integration domains with marked events, or at a
+    // breakpoint, restart with a step of dt_min.
+    void update_time_to_adaptive(fvm_value_type dt_min, fvm_value_type tmax);
+
+    // Set the breakpoints of each integration domain.
+    void set_breakpoints(const std::vector<std::vector<fvm_value_type>>& intdom_breakpoints);
+
+    // Set dt_next for each integration domain from an estimate of the local
+    // truncation error of the step to the voltage v_new, keeping it within
+    // the tolerance [mV] and within [dt_min, dt_max].
+    void update_dt_adaptive(const array& v_new, fvm_value_type tolerance, fvm_value_type dt_min, fvm_value_type dt_max);
+
     // Set the per-integration domain and per-compartment dt from time_to - time.
     void set_dt();
 
     // Update gap_junction state
     void add_gj_current();
 
+    // Set the gap junctions to cells of other groups, whose peer voltages
+    // are the n_peer values supplied by set_gj_halo_voltage.
+    void set_gj_halo(const std::vector<fvm_gap_junction>& halo, fvm_size_type n_peer);
+    void set_gj_halo_voltage(const std::vector<fvm_value_type>& peer_voltage);
+
+    // Add the current of the gap junctions to cells of other groups, with
+    // the peer voltages held fixed.
+    void add_gj_halo_current();
+
     // Return minimum and maximum time value [ms] across cells.
     std::pair<fvm_value_type, fvm_value_type> time_bounds() const;
 
@@ -149,6 +211,11 @@ struct shared_state {
         array& sample_value);
 
     void reset();
+
+    // Append the time, voltage, current and ion state to buf, or restore
+    // it from the state appended by a shared state of the same layout.
+    void serialize(std::vector<char>& buf) const;
+    void deserialize(const char*& p);
 };
 
 // For debugging only:
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <arbor/fvm_types.hpp>
+#include <arbor/mechanism.hpp>
+
+#include "profile/profiler_macro.hpp"
+#include "util/rangeutil.hpp"
+#include "util/span.hpp"
+
+#include "backends/multicore/mechanism.hpp"
+#include "backends/multicore/step_tiles.hpp"
+
+namespace arb {
+namespace multicore {
+
+// Estimated bytes of matrix and shared state per CV touched in a step.
+constexpr std::size_t cv_bytes = 16*sizeof(fvm_value_type);
+
+step_tiles::step_tiles(const std::vector<mechanism_ptr>& mechanisms, const matrix_state& matrix, std::size_t tile_bytes) {
+    if (!tile_bytes || !matrix.is_flat() || matrix.crank_nicolson()) return;
+
+    std::size_t bytes = matrix.size()*cv_bytes;
+    for (auto& m: mechanisms) {
+        auto p = dynamic_cast<mechanism*>(m.get());
+        if (!p || !p->has_range_kernels()) return;
+
+        mechanisms_.push_back(p);
+        bytes += p->memory();
+    }
+
+    // Split the cells into tiles with roughly equal numbers of CVs.
+    const fvm_index_type ncells = matrix.cell_cv_divs.size()-1;
+    const std::size_t ncv = matrix.size();
+    const std::size_t ntiles = (bytes+tile_bytes-1)/tile_bytes;
+
+    cell_divs_.assign(1, 0);
+    for (auto c: util::make_span(1, ncells)) {
+        if ((std::size_t)matrix.cell_cv_divs[c]*ntiles>=cell_divs_.size()*ncv) {
+            cell_divs_.push_back(c);
+        }
+    }
+    cell_divs_.push_back(ncells);
+
+    for (auto c: cell_divs_) {
+        cv_divs_.push_back(matrix.cell_cv_divs[c]);
+    }
+
+    for (auto m: mechanisms_) {
+        instance_divs_.push_back(m->instance_divs(cv_divs_));
+        if (instance_divs_.back().empty()) {
+            *this = step_tiles();
+            return;
+        }
+    }
+}
+
+void step_tiles::integrate(shared_state& state, matrix_state& matrix) const {
+    const auto& solution = matrix.solution();
+
+    for (auto t: util::make_span(size())) {
+        for (auto k: util::count_along(mechanisms_)) {
+            mechanisms_[k]->nrn_current_range(instance_divs_[k][t], instance_divs_[k][t+1]);
+        }
+
+        PE(advance_integrate_matrix_build);
+        matrix.assemble(cell_divs_[t], cell_divs_[t+1],
+            state.dt_intdom, state.voltage, state.current_density, state.conductivity);
+        PL();
+        PE(advance_integrate_matrix_solve);
+        matrix.solve(cell_divs_[t], cell_divs_[t+1]);
+        std::copy(solution.begin()+cv_divs_[t], solution.begin()+cv_divs_[t+1], state.voltage.begin()+cv_divs_[t]);
+        PL();
+
+        for (auto k: util::count_along(mechanisms_)) {
+            mechanisms_[k]->nrn_state_range(instance_divs_[k][t], instance_divs_[k][t+1]);
+        }
+    }
+}
+
+} // namespace multicore
+} // namespace arb
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <arbor/fvm_types.hpp>
+#include <arbor/mechanism.hpp>
+
+#include "backends/multicore/matrix_state.hpp"
+#include "backends/multicore/shared_state.hpp"
+
+namespace arb {
+namespace multicore {
+
+class mechanism;
+
+// Cache-blocked step schedule. The cells of a group are split into tiles of
+// consecutive cells, with an estimated state of about tile_bytes each. The
+// mechanism currents, matrix assembly and solution, and mechanism state
+// updates of each tile are then run back to back, so that the data of the
+// tile stays in cache between the phases of the step.
+//
+// Tiles are only made for flat matrix storage with implicit Euler steps and
+// for mechanisms with range kernels whose instances are sorted by CV, and
+// only if there would be more than one tile; otherwise the schedule is empty.
+
+class step_tiles {
+public:
+    using matrix_state = arb::multicore::matrix_state<fvm_value_type, fvm_index_type>;
+
+    step_tiles() = default;
+    step_tiles(const std::vector<mechanism_ptr>& mechanisms, const matrix_state& matrix, std::size_t tile_bytes);
+
+    bool empty() const { return size()<2; }
+    std::size_t size() const { return cell_divs_.empty()? 0: cell_divs_.size()-1; }
+
+    // Advance the voltage and mechanism state over one step, tile by tile.
+    // Currents must have been zeroed and gap junction currents added, and
+    // dt set.
+    void integrate(shared_state& state, matrix_state& matrix) const;
+
+private:
+    std::vector<fvm_index_type> cell_divs_;
+    std::vector<fvm_index_type> cv_divs_;
+
+    std::vector<mechanism*> mechanisms_;
+    std::vector<std::vector<fvm_size_type>> instance_divs_; // Per mechanism, by tile.
+};
+
+} // namespace multicore
+} // namespace arb
@@ -21,8 +21,13 @@ public:
     void nrn_init() override {}
     void nrn_state() override {}
     void nrn_current() override {
-        size_type n = size();
-        for (size_type i=0; i<n; ++i) {
+        nrn_current_range(0, size());
+    }
+
+    bool has_range_kernels() const override { return true; }
+    void nrn_state_range(size_type, size_type) override {}
+    void nrn_current_range(size_type begin, size_type end) override {
+        for (size_type i=begin; i<end; ++i) {
             auto cv = node_index_[i];
             auto t = vec_t_[vec_ci_[cv]];
 
@@ -54,9 +59,9 @@ protected:
         };
     }
 private:
-    fvm_value_type* delay;
-    fvm_value_type* duration;
-    fvm_value_type* amplitude;
+    state_type* delay;
+    state_type* duration;
+    state_type* amplitude;
 };
 } // namespace multicore
 
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include <arbor/assert.hpp>
 #include <arbor/fvm_types.hpp>
 #include <arbor/math.hpp>
 
 #include "backends/threshold_crossing.hpp"
 #include "execution_context.hpp"
+#include "threading/threading.hpp"
+#include "util/bytes.hpp"
 #include "multicore_common.hpp"
 
 namespace arb {
@@ -60,11 +65,67 @@ public:
         return crossings_;
     }
 
+    /// Split the thresholds into at most n_blocks contiguous blocks that
+    /// are tested in parallel on the thread pool.
+    void set_blocks(unsigned n_blocks, task_system_handle threads) {
+        block_divs_.clear();
+        block_crossings_.clear();
+        if (n_blocks>1 && n_cv_>1) {
+            n_blocks = std::min<fvm_size_type>(n_blocks, n_cv_);
+            for (fvm_size_type k = 0; k<=n_blocks; ++k) {
+                block_divs_.push_back(k*n_cv_/n_blocks);
+            }
+            block_crossings_.resize(n_blocks);
+        }
+        threads_ = std::move(threads);
+    }
+
     /// Tests each target for changed threshold state
     /// Crossing events are recorded for each threshold that
     /// is crossed since the last call to test
     void test() {
-        for (fvm_size_type i = 0; i<n_cv_; ++i) {
+        if (block_crossings_.empty()) {
+            test(0, n_cv_, crossings_);
+            return;
+        }
+
+        // Crossings are collected per block and appended in block order,
+        // which gives the same order as a serial test.
+        threading::parallel_for::apply(0, block_crossings_.size(), threads_.get(),
+            [&](int k) { test(block_divs_[k], block_divs_[k+1], block_crossings_[k]); });
+
+        for (auto& c: block_crossings_) {
+            crossings_.insert(crossings_.end(), c.begin(), c.end());
+            c.clear();
+        }
+    }
+
+    bool is_crossed(fvm_size_type i) const {
+        return is_crossed_[i];
+    }
+
+    /// The number of threshold values that are monitored.
+    std::size_t size() const {
+        return n_cv_;
+    }
+
+    /// Append the state of the detectors to buf, or restore it from the
+    /// state appended by a watcher of the same thresholds.
+    void serialize(std::vector<char>& buf) const {
+        util::write_bytes(buf, is_crossed_);
+        util::write_bytes(buf, v_prev_);
+    }
+
+    void deserialize(const char*& p) {
+        util::read_bytes(p, is_crossed_);
+        util::read_bytes(p, v_prev_);
+        clear_crossings();
+    }
+
+private:
+    /// Test the thresholds in [first, last), appending crossings to out.
+    void test(fvm_size_type first, fvm_size_type last, std::vector<threshold_crossing>& out) {
+        for (fvm_size_type i = first; i<last; ++i) {
             auto cv     = cv_index_[i];
             auto cell   = cv_to_intdom_[cv];
             auto v_prev = v_prev_[i];
@@ -77,7 +138,7 @@ public:
                     // linear interpolation.
                     auto pos = (thresh - v_prev)/(v - v_prev);
                     auto crossing_time = math::lerp(t_before_[cell], t_after_[cell], pos);
-                    crossings_.push_back({i, crossing_time});
+                    out.push_back({i, crossing_time});
 
                     is_crossed_[i] = true;
                 }
@@ -92,16 +153,6 @@ public:
         }
     }
 
-    bool is_crossed(fvm_size_type i) const {
-        return is_crossed_[i];
-    }
-
-    /// The number of threshold values that are monitored.
-    std::size_t size() const {
-        return n_cv_;
-    }
-
-private:
     /// Non-owning pointers to cv-to-cell map, per-cell time data,
     /// and the values for to test against thresholds.
     const fvm_index_type* cv_to_intdom_ = nullptr;
@@ -116,6 +167,11 @@ private:
     std::vector<fvm_value_type> thresholds_;
     std::vector<fvm_value_type> v_prev_;
     std::vector<threshold_crossing> crossings_;
+
+    /// Partition of thresholds into blocks tested in parallel, if any.
+    std::vector<fvm_size_type> block_divs_;
+    std::vector<std::vector<threshold_crossing>> block_crossings_;
+    task_system_handle threads_;
 };
 
 } // namespace multicore
@@ -8,6 +8,7 @@
 #include "cell_group.hpp"
 #include "profile/profiler_macro.hpp"
 #include "benchmark_cell_group.hpp"
+#include "util/bytes.hpp"
 
 #include "util/span.hpp"
 
@@ -35,13 +36,26 @@ void benchmark_cell_group::reset() {
     clear_spikes();
 }
 
+void benchmark_cell_group::serialize(std::vector<char>& buf) const {
+    util::write_bytes(buf, t_);
+}
+
+void benchmark_cell_group::deserialize(const char*& p) {
+    util::read_bytes(p, t_);
+    for (auto& c: cells_) {
+        c.time_sequence.reset();
+        c.time_sequence.events(0, t_);
+    }
+}
+
 cell_kind benchmark_cell_group::get_cell_kind() const {
     return cell_kind::benchmark;
 }
 
 void benchmark_cell_group::advance(epoch ep,
                                    time_type dt,
-                                   const event_lane_subrange& event_lanes)
+                                   const event_lane_subrange& event_lanes,
+                                   const resolved_lane_subrange&)
 {
     using std::chrono::high_resolution_clock;
     using duration_type = std::chrono::duration<double, std::micro>;
@@ -10,6 +10,8 @@
 #include <arbor/spike.hpp>
 #include <arbor/spike_event.hpp>
 
+#include "backends/event.hpp"
+#include "communication/gap_junction_voltage.hpp"
 #include "epoch.hpp"
 #include "event_binner.hpp"
 #include "util/rangeutil.hpp"
@@ -18,6 +20,18 @@ namespace arb {
 
 using event_lane_subrange = util::subrange_view_type<std::vector<pse_vector>>;
 
+// Lanes of events whose target handles were resolved by the communicator,
+// one time-sorted lane per cell, as for event_lane_subrange.
+using resolved_event_lane = std::vector<deliverable_event>;
+using resolved_lane_subrange = util::subrange_view_type<std::vector<resolved_event_lane>>;
+
+// Count of cell epochs advanced by a cell group, and of those in which the
+// cell was integrated rather than skipped at rest.
+struct cell_group_activity {
+    std::uint64_t advanced = 0;
+    std::uint64_t integrated = 0;
+};
+
 class cell_group {
 public:
     virtual ~cell_group() = default;
@@ -26,7 +40,14 @@ public:
 
     virtual void reset() = 0;
     virtual void set_binning_policy(binning_kind policy, time_type bin_interval) = 0;
-    virtual void advance(epoch epoch, time_type dt, const event_lane_subrange& events) = 0;
+    virtual void advance(epoch epoch, time_type dt, const event_lane_subrange& events, const resolved_lane_subrange& resolved) = 0;
+
+    // Resolve a target, given by the index of its cell in the group and its
+    // index on the cell, into the handle passed with events in the resolved
+    // lanes. Called by the communicator once for each connection to the
+    // group; groups that return false, the default, receive all events in
+    // the event lanes.
+    virtual bool resolve_target(cell_size_type, cell_lid_type, target_handle&) const { return false; }
 
     virtual const std::vector<spike>& spikes() const = 0;
     virtual void clear_spikes() = 0;
@@ -35,8 +56,30 @@ public:
     // from a sampler call back called from a different cell group running on a different thread.
 
     virtual void add_sampler(sampler_association_handle, cell_member_predicate, schedule, sampler_function, sampling_policy) = 0;
+
+    // Cell groups that do not support sampling ignore bulk samplers.
+    virtual void add_bulk_sampler(sampler_association_handle, cell_member_predicate, schedule, bulk_sampler_function, sample_reduction, sampling_policy) {}
     virtual void remove_sampler(sampler_association_handle) = 0;
     virtual void remove_all_samplers() = 0;
+
+    // Activity since construction or reset; cell groups that never skip
+    // integration need not count.
+    virtual cell_group_activity activity() const { return {}; }
+
+    // Gap junctions to cells of other groups, whose voltages are exchanged
+    // between epochs; see gap_junction_halo. Cell groups without gap
+    // junctions have none.
+    virtual gap_junction_halo_sites gap_junction_halo() const { return {}; }
+    virtual void export_gap_junction_voltages(std::vector<fvm_value_type>&) const {}
+    virtual void import_gap_junction_voltages(const std::vector<fvm_value_type>&) {}
+
+    // Append the state of the group to buf between epochs, or restore it
+    // from the state appended by a group of the same cells and back end, so
+    // that the group can be moved to another rank; see
+    // simulation::rebalance. Samplers and the binning policy are not part of
+    // the state, and are set before deserialize is called.
+    virtual void serialize(std::vector<char>& buf) const = 0;
+    virtual void deserialize(const char*& p) = 0;
 };
 
 using cell_group_ptr = std::unique_ptr<cell_group>;
@@ -1,3 +1,4 @@
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -28,6 +29,7 @@ communicator::communicator(const recipe& rec,
 {
     distributed_ = ctx.distributed;
     thread_pool_ = ctx.thread_pool;
+    gid_domain_ = dom_dec.gid_domain;
 
     num_domains_ = distributed_->size();
     num_local_groups_ = dom_dec.groups.size();
@@ -111,6 +113,91 @@ communicator::communicator(const recipe& rec,
         [&](cell_size_type i) {
             util::sort(util::subrange_view(connections_, cp[i], cp[i+1]));
         });
+
+    local_gids_ = std::move(gids);
+}
+
+int communicator::source_domain(cell_gid_type gid) const {
+    auto it = moved_.find(gid);
+    return it==moved_.end()? gid_domain_(gid): it->second;
+}
+
+void communicator::update_groups(
+        const recipe& rec,
+        const std::vector<group_description>& groups,
+        const std::unordered_map<cell_gid_type, int>& moved)
+{
+    for (auto& m: moved) {
+        moved_[m.first] = m.second;
+    }
+
+    std::vector<cell_gid_type> gids;
+    for (auto& g: groups) {
+        util::append(gids, g.gids);
+    }
+    std::unordered_map<cell_gid_type, cell_size_type> new_index;
+    for (auto i: util::count_along(gids)) {
+        new_index[gids[i]] = i;
+    }
+
+    // Map the old index of each local cell to the new one, or to npos if
+    // the cell has left, and mark the cells that stay.
+    constexpr auto npos = cell_size_type(-1);
+    std::vector<cell_size_type> index_map(local_gids_.size(), npos);
+    std::vector<char> stayed(gids.size(), 0);
+    for (auto i: util::count_along(local_gids_)) {
+        auto it = new_index.find(local_gids_[i]);
+        if (it!=new_index.end()) {
+            index_map[i] = it->second;
+            stayed[it->second] = 1;
+        }
+    }
+
+    // Keep the connections to cells that stay, in the bucket of the current
+    // domain of their source. Buckets that gain connections are re-sorted.
+    std::vector<std::vector<connection>> buckets(num_domains_);
+    std::vector<char> changed(num_domains_, 0);
+    const auto& cp = connection_part_;
+    for (auto dom: util::make_span(num_domains_)) {
+        for (auto& c: util::subrange_view(connections_, cp[dom], cp[dom+1])) {
+            auto i = index_map[c.index_on_domain()];
+            if (i==npos) continue;
+
+            auto src = source_domain(c.source().gid);
+            changed[src] |= src!=int(dom);
+            buckets[src].push_back({c.source(), c.destination(), c.weight(), c.delay(), i});
+        }
+    }
+
+    for (auto i: util::count_along(gids)) {
+        if (stayed[i]) continue;
+        for (auto c: rec.connections_on(gids[i])) {
+            auto src = source_domain(c.source.gid);
+            changed[src] = 1;
+            buckets[src].push_back({c.source, c.dest, c.weight, c.delay, cell_size_type(i)});
+        }
+    }
+
+    threading::parallel_for::apply(0, num_domains_, thread_pool_.get(),
+        [&](cell_size_type i) {
+            if (changed[i]) util::sort(buckets[i]);
+        });
+
+    connections_.clear();
+    connection_part_.assign(1, 0);
+    clear_targets();
+    for (auto& b: buckets) {
+        util::append(connections_, b);
+        connection_part_.push_back(connections_.size());
+    }
+
+    num_local_groups_ = groups.size();
+    num_local_cells_ = gids.size();
+    local_gids_ = std::move(gids);
+    index_part_ = util::make_partition(index_divisions_,
+        util::transform_view(
+            groups,
+            [](const group_description& g){return g.gids.size();}));
 }
 
 std::pair<cell_size_type, cell_size_type> communicator::group_queue_range(cell_size_type i) {
@@ -142,16 +229,58 @@ gathered_vector<spike> communicator::exchange(std::vector<spike> local_spikes) {
     return global_spikes;
 }
 
+void communicator::resolve_targets(const std::vector<cell_group_ptr>& groups) {
+    arb_assert(groups.size()==num_local_groups_);
+
+    // Local cell index to group index.
+    std::vector<cell_size_type> cell_group(num_local_cells_);
+    for (auto i: util::make_span(num_local_groups_)) {
+        for (auto j: util::make_span(index_part_[i])) {
+            cell_group[j] = i;
+        }
+    }
+
+    target_handles_.assign(connections_.size(), util::nullopt);
+    threading::parallel_for::apply(0, connections_.size(), thread_pool_.get(),
+        [&](std::size_t k) {
+            auto& c = connections_[k];
+            auto i = c.index_on_domain();
+            auto g = cell_group[i];
+            target_handle h;
+            if (groups[g]->resolve_target(i-index_part_[g].first, c.destination().index, h)) {
+                target_handles_[k] = h;
+            }
+        });
+}
+
+void communicator::clear_targets() {
+    target_handles_.clear();
+    target_handles_.shrink_to_fit();
+}
+
 void communicator::make_event_queues(
         const gathered_vector<spike>& global_spikes,
-        std::vector<pse_vector>& queues)
+        std::vector<pse_vector>& queues,
+        std::vector<resolved_event_lane>& resolved_queues)
 {
     arb_assert(queues.size()==num_local_cells_);
+    arb_assert(resolved_queues.size()==num_local_cells_);
 
     using util::subrange_view;
     using util::make_span;
     using util::make_range;
 
+    // Make the event of connection k for spike s.
+    auto push_event = [&](std::size_t k, const spike& s) {
+        auto& c = connections_[k];
+        if (!target_handles_.empty() && target_handles_[k]) {
+            resolved_queues[c.index_on_domain()].push_back({s.time+c.delay(), *target_handles_[k], c.weight()});
+        }
+        else {
+            queues[c.index_on_domain()].push_back(c.make_event(s));
+        }
+    };
+
     const auto& sp = global_spikes.partition();
     const auto& cp = connection_part_;
     for (auto dom: make_span(num_domains_)) {
@@ -180,7 +309,7 @@ void communicator::make_event_queues(
             while (cn!=cons.end() && sp!=spks.end()) {
                 auto sources = std::equal_range(sp, spks.end(), cn->source(), spike_pred());
                 for (auto s: make_range(sources)) {
-                    queues[cn->index_on_domain()].push_back(cn->make_event(s));
+                    push_event(cn-connections_.begin(), s);
                 }
 
                 sp = sources.first;
@@ -192,8 +321,8 @@ void communicator::make_event_queues(
             auto sp = spks.begin();
             while (cn!=cons.end() && sp!=spks.end()) {
                 auto targets = std::equal_range(cn, cons.end(), sp->source);
-                for (auto c: make_range(targets)) {
-                    queues[c.index_on_domain()].push_back(c.make_event(*sp));
+                for (auto c = targets.first; c!=targets.second; ++c) {
+                    push_event(c-connections_.begin(), *sp);
                 }
 
                 cn = targets.first;
@@ -1,12 +1,17 @@
 #pragma once
 
+#include <functional>
+#include <unordered_map>
 #include <vector>
 
 #include <arbor/common_types.hpp>
 #include <arbor/domain_decomposition.hpp>
 #include <arbor/recipe.hpp>
 #include <arbor/spike.hpp>
+#include <arbor/util/optional.hpp>
 
+#include "backends/event.hpp"
+#include "cell_group.hpp"
 #include "communication/gathered_vector.hpp"
 #include "connection.hpp"
 #include "execution_context.hpp"
@@ -48,14 +53,25 @@ public:
     /// Check each global spike in turn to see it generates local events.
     /// If so, make the events and insert them into the appropriate event list.
     ///
-    /// Takes reference to a vector of event lists as an argument, with one list
-    /// for each local cell group. On completion, the events in each list are
-    /// all events that must be delivered to targets in that cell group as a
-    /// result of the global spike exchange, plus any events that were already
-    /// in the list.
+    /// Takes reference to two vectors of event lists as arguments, with one
+    /// list for each local cell. On completion, the events in each list are
+    /// all events that must be delivered to targets in that cell as a result
+    /// of the global spike exchange, plus any events that were already in the
+    /// list. Events of connections with targets resolved by resolve_targets
+    /// are added to resolved_queues, and all others to queues.
     void make_event_queues(
             const gathered_vector<spike>& global_spikes,
-            std::vector<pse_vector>& queues);
+            std::vector<pse_vector>& queues,
+            std::vector<resolved_event_lane>& resolved_queues);
+
+    /// Store the handle of the target of each connection, if the cell group
+    /// of the target resolves it. The groups are the local cell groups, in
+    /// the order of the domain decomposition, or of the last update_groups,
+    /// which discards the handles.
+    void resolve_targets(const std::vector<cell_group_ptr>& groups);
+
+    /// Discard the handles stored by resolve_targets.
+    void clear_targets();
 
     /// Returns the total number of global spikes over the duration of the simulation
     std::uint64_t num_spikes() const;
@@ -64,6 +80,16 @@ public:
 
     const std::vector<connection>& connections() const;
 
+    /// Update the connections after cell groups have moved between domains.
+    ///
+    /// Takes the new local groups, in the order of their event queues, and
+    /// the new domain of every cell that moved on any domain. Connections of
+    /// the cells that stay are kept, and only those of the cells that arrived
+    /// are fetched from the recipe.
+    void update_groups(const recipe& rec,
+                       const std::vector<group_description>& groups,
+                       const std::unordered_map<cell_gid_type, int>& moved);
+
     void reset();
 
 private:
@@ -72,9 +98,21 @@ private:
     cell_size_type num_domains_;
     std::vector<connection> connections_;
     std::vector<cell_size_type> connection_part_;
+
+    // Target handle of each connection, if resolved; empty unless
+    // resolve_targets was called.
+    std::vector<util::optional<target_handle>> target_handles_;
     std::vector<cell_size_type> index_divisions_;
     util::partition_view_type<std::vector<cell_size_type>> index_part_;
 
+    // Gid of each local cell, and the domain of each cell: given by the
+    // domain decomposition, unless the cell has since moved.
+    std::vector<cell_gid_type> local_gids_;
+    std::function<int(cell_gid_type)> gid_domain_;
+    std::unordered_map<cell_gid_type, int> moved_;
+
+    int source_domain(cell_gid_type gid) const;
+
     distributed_context_handle distributed_;
     task_system_handle thread_pool_;
     std::uint64_t num_spikes_ = 0u;
@@ -68,6 +68,73 @@ struct dry_run_context_impl {
         return gathered_vector<cell_gid_type>(std::move(gathered_gids), std::move(partition));
     }
 
+    gathered_vector<cell_member_type>
+    gather_gj_sites(const std::vector<cell_member_type>& local_sites) const {
+        using count_type = typename gathered_vector<cell_member_type>::count_type;
+
+        count_type local_size = local_sites.size();
+
+        std::vector<cell_member_type> gathered_sites;
+        gathered_sites.reserve(local_size*num_ranks_);
+
+        for (count_type i = 0; i < num_ranks_; i++) {
+            gathered_sites.insert(gathered_sites.end(), local_sites.begin(), local_sites.end());
+        }
+
+        for (count_type i = 0; i < num_ranks_; i++) {
+            for (count_type j = i*local_size; j < (i+1)*local_size; j++){
+                gathered_sites[j].gid += num_cells_per_tile_*i;
+            }
+        }
+
+        std::vector<count_type> partition;
+        for (count_type i = 0; i <= num_ranks_; i++) {
+            partition.push_back(static_cast<count_type>(i*local_size));
+        }
+
+        return gathered_vector<cell_member_type>(std::move(gathered_sites), std::move(partition));
+    }
+
+    // The voltages of the sites of each tile are those of the local sites.
+    gathered_vector<fvm_value_type>
+    gather_gj_voltages(const std::vector<fvm_value_type>& local_voltages) const {
+        using count_type = typename gathered_vector<fvm_value_type>::count_type;
+
+        count_type local_size = local_voltages.size();
+
+        std::vector<fvm_value_type> gathered_voltages;
+        gathered_voltages.reserve(local_size*num_ranks_);
+
+        std::vector<count_type> partition;
+        for (count_type i = 0; i < num_ranks_; i++) {
+            partition.push_back(static_cast<count_type>(i*local_size));
+            gathered_voltages.insert(gathered_voltages.end(), local_voltages.begin(), local_voltages.end());
+        }
+        partition.push_back(static_cast<count_type>(num_ranks_*local_size));
+
+        return gathered_vector<fvm_value_type>(std::move(gathered_voltages), std::move(partition));
+    }
+
+    // Byte buffers are opaque, so every rank sees an unmodified copy.
+    gathered_vector<char>
+    gather_bytes(const std::vector<char>& local_bytes) const {
+        using count_type = typename gathered_vector<char>::count_type;
+
+        count_type local_size = local_bytes.size();
+
+        std::vector<char> gathered_bytes;
+        gathered_bytes.reserve(local_size*num_ranks_);
+
+        std::vector<count_type> partition;
+        for (count_type i = 0; i < num_ranks_; i++) {
+            partition.push_back(static_cast<count_type>(i*local_size));
+            gathered_bytes.insert(gathered_bytes.end(), local_bytes.begin(), local_bytes.end());
+        }
+        partition.push_back(static_cast<count_type>(num_ranks_*local_size));
+
+        return gathered_vector<char>(std::move(gathered_bytes), std::move(partition));
+    }
+
     int id() const { return 0; }
 
     int size() const { return num_ranks_; }
@@ -86,6 +153,11 @@ struct dry_run_context_impl {
         return std::vector<T>(num_ranks_, value);
     }
 
+    template <typename T>
+    std::vector<T> gather_all(T value) const {
+        return std::vector<T>(num_ranks_, value);
+    }
+
     void barrier() const {}
 
     std::string name() const { return "dryrun"; }
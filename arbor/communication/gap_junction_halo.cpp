@@ -0,0 +1,65 @@
+#include <unordered_map>
+#include <vector>
+
+#include <arbor/arbexcept.hpp>
+#include <arbor/common_types.hpp>
+
+#include "communication/gap_junction_halo.hpp"
+#include "profile/profiler_macro.hpp"
+#include "util/rangeutil.hpp"
+#include "util/span.hpp"
+
+namespace arb {
+
+gap_junction_halo::gap_junction_halo(const std::vector<cell_group_ptr>& groups, const distributed_context& dist) {
+    std::vector<gap_junction_halo_sites> group_sites;
+    std::vector<cell_member_type> local;
+    for (auto& g: groups) {
+        group_sites.push_back(g->gap_junction_halo());
+        util::append(local, group_sites.back().exported);
+    }
+
+    auto global = dist.gather_gj_sites(local);
+    num_global_sites_ = global.values().size();
+    if (!num_global_sites_) return;
+
+    std::unordered_map<cell_member_type, unsigned> index;
+    for (auto i: util::count_along(global.values())) {
+        index[global.values()[i]] = i;
+    }
+
+    for (auto& sites: group_sites) {
+        import_index_.emplace_back();
+        for (auto j: util::count_along(sites.imported)) {
+            auto it = index.find(sites.imported[j]);
+            if (it==index.end()) {
+                throw gj_unsupported_domain_decomposition(sites.imported_by[j], sites.imported[j].gid);
+            }
+            import_index_.back().push_back(it->second);
+        }
+    }
+}
+
+void gap_junction_halo::exchange(std::vector<cell_group_ptr>& groups, const distributed_context& dist) {
+    if (empty()) return;
+
+    PE(communication_gjexchange);
+    export_voltage_.clear();
+    for (auto& g: groups) {
+        g->export_gap_junction_voltages(export_voltage_);
+    }
+
+    auto global = dist.gather_gj_voltages(export_voltage_);
+    const auto& values = global.values();
+
+    for (auto i: util::count_along(groups)) {
+        import_voltage_.clear();
+        for (auto k: import_index_[i]) {
+            import_voltage_.push_back(values[k]);
+        }
+        groups[i]->import_gap_junction_voltages(import_voltage_);
+    }
+    PL();
+}
+
+} // namespace arb
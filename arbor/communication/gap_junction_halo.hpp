@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include <arbor/fvm_types.hpp>
+
+#include "cell_group.hpp"
+#include "communication/gap_junction_voltage.hpp"
+#include "distributed_context.hpp"
+
+namespace arb {
+
+// Exchange of the voltages at the sites of gap junctions that couple cells
+// in different cell groups, on the same or on different ranks.
+//
+// Each cell group exports the voltages at its sites with junctions to
+// cells of other groups, and imports the voltages at the peer sites, which
+// it holds fixed until the next exchange. The exported sites of all ranks
+// are gathered once, on construction, to find the position of each
+// imported site; the exchange then gathers only the voltages, in the same
+// order.
+
+class gap_junction_halo {
+public:
+    gap_junction_halo() = default;
+
+    // Throws gj_unsupported_domain_decomposition if a peer site is not
+    // exported by any group, e.g. if the junction is not also listed by the
+    // peer cell.
+    gap_junction_halo(const std::vector<cell_group_ptr>& groups, const distributed_context& dist);
+
+    // True if no junction couples cells of different groups on any rank.
+    bool empty() const {
+        return !num_global_sites_;
+    }
+
+    // Number of sites exported by all ranks.
+    std::size_t num_global_sites() const {
+        return num_global_sites_;
+    }
+
+    void exchange(std::vector<cell_group_ptr>& groups, const distributed_context& dist);
+
+private:
+    std::size_t num_global_sites_ = 0;
+
+    // Position of each imported site of each group in the gathered vector.
+    std::vector<std::vector<unsigned>> import_index_;
+
+    // Buffers for the exported and imported voltages.
+    std::vector<fvm_value_type> export_voltage_;
+    std::vector<fvm_value_type> import_voltage_;
+};
+
+} // namespace arb
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+#include <arbor/common_types.hpp>
+#include <arbor/fvm_types.hpp>
+
+namespace arb {
+
+// Gap junction sites of a cell group that are coupled to cells of other
+// groups: the sites of the group's cells, whose voltages are exported, and
+// the peer sites, whose voltages are imported, each without repeats, with
+// the gid of a cell of the group coupled to each peer site.
+struct gap_junction_halo_sites {
+    std::vector<cell_member_type> exported;
+    std::vector<cell_member_type> imported;
+    std::vector<cell_gid_type> imported_by;
+};
+
+} // namespace arb
@@ -38,6 +38,21 @@ struct mpi_context_impl {
         return mpi::gather_all_with_partition(local_gids, comm_);
     }
 
+    gathered_vector<cell_member_type>
+    gather_gj_sites(const std::vector<cell_member_type>& local_sites) const {
+        return mpi::gather_all_with_partition(local_sites, comm_);
+    }
+
+    gathered_vector<fvm_value_type>
+    gather_gj_voltages(const std::vector<fvm_value_type>& local_voltages) const {
+        return mpi::gather_all_with_partition(local_voltages, comm_);
+    }
+
+    gathered_vector<char>
+    gather_bytes(const std::vector<char>& local_bytes) const {
+        return mpi::gather_all_with_partition(local_bytes, comm_);
+    }
+
     std::string name() const { return "MPI"; }
     int id() const { return rank_; }
     int size() const { return size_; }
@@ -62,6 +77,11 @@ struct mpi_context_impl {
         return mpi::gather(value, root, comm_);
     }
 
+    template <typename T>
+    std::vector<T> gather_all(T value) const {
+        return mpi::gather_all(value, comm_);
+    }
+
     void barrier() const {
         mpi::barrier(comm_);
     }
@@ -3,6 +3,8 @@
 #include <memory>
 #include <string>
 
+#include <arbor/common_types.hpp>
+#include <arbor/fvm_types.hpp>
 #include <arbor/spike.hpp>
 #include <arbor/util/pp_util.hpp>
 
@@ -14,19 +16,22 @@ namespace arb {
     T min(T value) const { return impl_->min(value); }\
     T max(T value) const { return impl_->max(value); }\
     T sum(T value) const { return impl_->sum(value); }\
-    std::vector<T> gather(T value, int root) const { return impl_->gather(value, root); }
+    std::vector<T> gather(T value, int root) const { return impl_->gather(value, root); }\
+    std::vector<T> gather_all(T value) const { return impl_->gather_all(value); }
 
 #define ARB_INTERFACE_COLLECTIVES_(T) \
     virtual T min(T value) const = 0;\
     virtual T max(T value) const = 0;\
     virtual T sum(T value) const = 0;\
-    virtual std::vector<T> gather(T value, int root) const = 0;
+    virtual std::vector<T> gather(T value, int root) const = 0;\
+    virtual std::vector<T> gather_all(T value) const = 0;
 
 #define ARB_WRAP_COLLECTIVES_(T) \
     T min(T value) const override { return wrapped.min(value); }\
     T max(T value) const override { return wrapped.max(value); }\
     T sum(T value) const override { return wrapped.sum(value); }\
-    std::vector<T> gather(T value, int root) const override { return wrapped.gather(value, root); }
+    std::vector<T> gather(T value, int root) const override { return wrapped.gather(value, root); }\
+    std::vector<T> gather_all(T value) const override { return wrapped.gather_all(value); }
 
 #define ARB_COLLECTIVE_TYPES_ float, double, int, unsigned, long, unsigned long, long long, unsigned long long
 
@@ -43,6 +48,8 @@ class distributed_context {
 public:
     using spike_vector = std::vector<arb::spike>;
     using gid_vector = std::vector<cell_gid_type>;
+    using gj_site_vector = std::vector<cell_member_type>;
+    using gj_voltage_vector = std::vector<fvm_value_type>;
 
     // default constructor uses a local context: see below.
     distributed_context();
@@ -63,6 +70,21 @@ public:
         return impl_->gather_gids(local_gids);
     }
 
+    // Gather the gap junction sites exported by each rank, once, and then
+    // the voltages at these sites in the same order at each exchange.
+    gathered_vector<cell_member_type> gather_gj_sites(const gj_site_vector& local_sites) const {
+        return impl_->gather_gj_sites(local_sites);
+    }
+
+    gathered_vector<fvm_value_type> gather_gj_voltages(const gj_voltage_vector& local_voltages) const {
+        return impl_->gather_gj_voltages(local_voltages);
+    }
+
+    // Gather opaque byte buffers, e.g. serialized cell group state.
+    gathered_vector<char> gather_bytes(const std::vector<char>& local_bytes) const {
+        return impl_->gather_bytes(local_bytes);
+    }
+
     int id() const {
         return impl_->id();
     }
@@ -91,6 +113,12 @@ private:
             gather_spikes(const spike_vector& local_spikes) const = 0;
         virtual gathered_vector<cell_gid_type>
             gather_gids(const gid_vector& local_gids) const = 0;
+        virtual gathered_vector<cell_member_type>
+            gather_gj_sites(const gj_site_vector& local_sites) const = 0;
+        virtual gathered_vector<fvm_value_type>
+            gather_gj_voltages(const gj_voltage_vector& local_voltages) const = 0;
+        virtual gathered_vector<char>
+            gather_bytes(const std::vector<char>& local_bytes) const = 0;
         virtual int id() const = 0;
         virtual int size() const = 0;
         virtual void barrier() const = 0;
@@ -115,6 +143,18 @@ private:
         gather_gids(const gid_vector& local_gids) const override {
             return wrapped.gather_gids(local_gids);
         }
+        gathered_vector<cell_member_type>
+        gather_gj_sites(const gj_site_vector& local_sites) const override {
+            return wrapped.gather_gj_sites(local_sites);
+        }
+        gathered_vector<fvm_value_type>
+        gather_gj_voltages(const gj_voltage_vector& local_voltages) const override {
+            return wrapped.gather_gj_voltages(local_voltages);
+        }
+        gathered_vector<char>
+        gather_bytes(const std::vector<char>& local_bytes) const override {
+            return wrapped.gather_bytes(local_bytes);
+        }
         int id() const override {
             return wrapped.id();
         }
@@ -157,6 +197,30 @@ struct local_context {
                 {0u, static_cast<count_type>(local_gids.size())}
         );
     }
+    gathered_vector<cell_member_type>
+    gather_gj_sites(const std::vector<cell_member_type>& local_sites) const {
+        using count_type = typename gathered_vector<cell_member_type>::count_type;
+        return gathered_vector<cell_member_type>(
+                std::vector<cell_member_type>(local_sites),
+                {0u, static_cast<count_type>(local_sites.size())}
+        );
+    }
+    gathered_vector<fvm_value_type>
+    gather_gj_voltages(const std::vector<fvm_value_type>& local_voltages) const {
+        using count_type = typename gathered_vector<fvm_value_type>::count_type;
+        return gathered_vector<fvm_value_type>(
+                std::vector<fvm_value_type>(local_voltages),
+                {0u, static_cast<count_type>(local_voltages.size())}
+        );
+    }
+    gathered_vector<char>
+    gather_bytes(const std::vector<char>& local_bytes) const {
+        using count_type = typename gathered_vector<char>::count_type;
+        return gathered_vector<char>(
+                std::vector<char>(local_bytes),
+                {0u, static_cast<count_type>(local_bytes.size())}
+        );
+    }
 
     int id() const { return 0; }
 
@@ -174,6 +238,9 @@ struct local_context {
     template <typename T>
     std::vector<T> gather(T value, int) const { return {std::move(value)}; }
 
+    template <typename T>
+    std::vector<T> gather_all(T value) const { return {std::move(value)}; }
+
     void barrier() const {}
 
     std::string name() const { return "local"; }
@@ -10,6 +10,7 @@
 #include <arbor/util/optional.hpp>
 
 #include "event_binner.hpp"
+#include "util/bytes.hpp"
 
 namespace arb {
 
@@ -17,6 +18,22 @@ void event_binner::reset() {
     last_event_time_ = util::nullopt;
 }
 
+void event_binner::serialize(std::vector<char>& buf) const {
+    util::write_bytes(buf, bool(last_event_time_));
+    util::write_bytes(buf, last_event_time_? *last_event_time_: time_type(0));
+}
+
+void event_binner::deserialize(const char*& p) {
+    auto has_time = util::read_bytes<bool>(p);
+    auto t = util::read_bytes<time_type>(p);
+    if (has_time) {
+        last_event_time_ = t;
+    }
+    else {
+        last_event_time_ = util::nullopt;
+    }
+}
+
 time_type event_binner::bin(time_type t, time_type t_min) {
     time_type t_binned = t;
 
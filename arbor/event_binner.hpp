@@ -2,6 +2,7 @@
 
 #include <limits>
 #include <unordered_map>
+#include <vector>
 
 #include <arbor/common_types.hpp>
 #include <arbor/spike.hpp>
@@ -26,6 +27,10 @@ public:
 
     time_type bin(time_type t, time_type t_min = std::numeric_limits<time_type>::lowest());
 
+    // Append the time of the last binned event to buf, or restore it.
+    void serialize(std::vector<char>& buf) const;
+    void deserialize(const char*& p);
+
 private:
     binning_kind policy_;
 
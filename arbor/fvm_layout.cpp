@@ -1,3 +1,4 @@
+#include <numeric>
 #include <set>
 #include <stdexcept>
 #include <unordered_set>
@@ -100,16 +101,28 @@ namespace {
     //
     //     index_type seg        The segment currently being iterated over.
 
+    // Segments are visited in CV order, which differs from the order of
+    // segment_indices if the CVs have been renumbered; seg_index is the
+    // position of the segment in segment_indices.
     template <typename Seq, typename Action>
     void for_each_cv_in_segments(const fvm_discretization& D, const Seq& segment_indices, const Action& action) {
         using index_type = fvm_index_type;
         using size_type = fvm_size_type;
 
+        std::vector<index_type> segs;
+        for (const auto& seg: segment_indices) {
+            segs.push_back(seg);
+        }
+
+        std::vector<index_type> seg_order(segs.size());
+        std::iota(seg_order.begin(), seg_order.end(), 0);
+        util::stable_sort_by(seg_order, [&](index_type i) { return D.segments[segs[i]].proximal_cv; });
+
         std::unordered_map<index_type, size_type> parent_cv_indices;
         size_type cv_index = 0;
 
-        index_type seg_index = 0;
-        for (const auto& seg: segment_indices) {
+        for (index_type seg_index: seg_order) {
+            index_type seg = segs[seg_index];
             const segment_info& seg_info = D.segments[seg];
 
             if (seg_info.has_parent()) {
@@ -133,7 +146,6 @@ namespace {
 
             action(i, seg_info.distal_cv, seg_info.distal_cv_area, seg_index, seg);
             parent_cv_indices.insert({cv, i});
-            ++seg_index;
         }
     }
 
@@ -405,6 +417,79 @@ fvm_discretization fvm_discretize(const std::vector<cable_cell>& cells, const ca
     return D;
 }
 
+void fvm_renumber_cvs(fvm_discretization& D) {
+    using index_type = fvm_index_type;
+
+    // New index of each CV.
+    std::vector<index_type> cv_map(D.ncv);
+
+    std::vector<index_type> subtree_size, child_divs, children, stack;
+    for (auto cell_cvs: D.cell_cv_part()) {
+        const auto base = cell_cvs.first;
+        const index_type n = cell_cvs.second-base;
+        auto parent = [&](index_type i) { return D.parent_cv[base+i]-base; };
+
+        subtree_size.assign(n, 1);
+        for (index_type i = n-1; i>0; --i) {
+            arb_assert(parent(i)<i);
+            subtree_size[parent(i)] += subtree_size[i];
+        }
+
+        // Children of each CV in order of increasing subtree size.
+        child_divs.assign(n+1, 0);
+        for (index_type i = 1; i<n; ++i) {
+            ++child_divs[parent(i)+1];
+        }
+        std::partial_sum(child_divs.begin(), child_divs.end(), child_divs.begin());
+        children.resize(n);
+        auto fill = child_divs;
+        for (index_type i = 1; i<n; ++i) {
+            children[fill[parent(i)]++] = i;
+        }
+        for (index_type i = 0; i<n; ++i) {
+            std::stable_sort(children.begin()+child_divs[i], children.begin()+child_divs[i+1],
+                [&](index_type a, index_type b) { return subtree_size[a]<subtree_size[b]; });
+        }
+
+        index_type next = base;
+        stack.assign(1, 0);
+        while (!stack.empty()) {
+            auto i = stack.back();
+            stack.pop_back();
+            cv_map[base+i] = next++;
+            for (auto k = child_divs[i+1]; k>child_divs[i]; --k) {
+                stack.push_back(children[k-1]);
+            }
+        }
+    }
+
+    auto permute = [&](auto& values) {
+        auto old = values;
+        for (auto i: make_span(D.ncv)) {
+            values[cv_map[i]] = old[i];
+        }
+    };
+
+    auto old_parent = D.parent_cv;
+    for (auto i: make_span(D.ncv)) {
+        D.parent_cv[cv_map[i]] = cv_map[old_parent[i]];
+    }
+    permute(D.face_conductance);
+    permute(D.cv_area);
+    permute(D.cv_capacitance);
+    permute(D.init_membrane_potential);
+    permute(D.temperature_K);
+    permute(D.diam_um);
+
+    for (auto& seg: D.segments) {
+        if (seg.has_parent()) {
+            seg.parent_cv = cv_map[seg.parent_cv];
+        }
+        seg.proximal_cv = cv_map[seg.proximal_cv];
+        seg.distal_cv = cv_map[seg.distal_cv];
+    }
+}
+
 // Build up mechanisms.
 //
 // Processing procedes in the following stages:
@@ -97,6 +97,12 @@ struct fvm_discretization {
 
 fvm_discretization fvm_discretize(const std::vector<cable_cell>& cells, const cable_cell_parameter_set& params);
 
+// Renumber the CVs of each cell in depth-first order, visiting the children
+// of a CV in order of increasing subtree size. The CVs of each segment stay
+// contiguous, and each CV other than the first of a branch directly follows
+// its parent, as does the first child of each branch point.
+void fvm_renumber_cvs(fvm_discretization& D);
+
 
 // Post-discretization data for point and density mechanism instantiation.
 
@@ -9,6 +9,7 @@
 
 #include "backends/event.hpp"
 #include "backends/threshold_crossing.hpp"
+#include "communication/gap_junction_voltage.hpp"
 #include "execution_context.hpp"
 #include "sampler_map.hpp"
 #include "util/range.hpp"
@@ -19,6 +20,9 @@ struct fvm_integration_result {
     util::range<const threshold_crossing*> crossings;
     util::range<const fvm_value_type*> sample_time;
     util::range<const fvm_value_type*> sample_value;
+
+    // False if integration was skipped because the cells are at rest.
+    bool integrated = true;
 };
 
 // Common base class for FVM implementation on host or gpu back-end.
@@ -36,11 +40,26 @@ struct fvm_lowered_cell {
     virtual fvm_integration_result integrate(
         fvm_value_type tfinal,
         fvm_value_type max_dt,
-        std::vector<deliverable_event> staged_events,
-        std::vector<sample_event> staged_samples) = 0;
+        const std::vector<deliverable_event>& staged_events,
+        const std::vector<sample_event>& staged_samples) = 0;
 
     virtual fvm_value_type time() const = 0;
 
+    // Gap junctions to cells of other cell groups. Export appends the
+    // voltages at the exported sites; import sets the voltages of the
+    // imported sites, which are held fixed until the next import. Both are
+    // in the order of the sites in gap_junction_halo().
+    virtual gap_junction_halo_sites gap_junction_halo() const { return {}; }
+    virtual void export_gap_junction_voltages(std::vector<fvm_value_type>&) const {}
+    virtual void import_gap_junction_voltages(const std::vector<fvm_value_type>&) {}
+
+    // Append the dynamic state of the cells to buf between calls to
+    // integrate, or restore it from the state appended by a lowered cell of
+    // the same cells and back end. Serialize returns false if the back end
+    // does not support it.
+    virtual bool serialize(std::vector<char>& buf) const = 0;
+    virtual void deserialize(const char*& p) = 0;
+
     virtual ~fvm_lowered_cell() {}
 };
 
@@ -12,6 +12,7 @@
 #include <memory>
 #include <queue>
 #include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 #include <unordered_set>
@@ -19,6 +20,7 @@
 #include <arbor/assert.hpp>
 #include <arbor/common_types.hpp>
 #include <arbor/cable_cell_param.hpp>
+#include <arbor/mechinfo.hpp>
 #include <arbor/recipe.hpp>
 
 #include "builtin_mechanisms.hpp"
@@ -28,6 +30,7 @@
 #include "matrix.hpp"
 #include "profile/profiler_macro.hpp"
 #include "sampler_map.hpp"
+#include "util/bytes.hpp"
 #include "util/maputil.hpp"
 #include "util/meta.hpp"
 #include "util/range.hpp"
@@ -59,15 +62,36 @@ public:
     fvm_integration_result integrate(
         value_type tfinal,
         value_type max_dt,
-        std::vector<deliverable_event> staged_events,
-        std::vector<sample_event> staged_samples) override;
+        const std::vector<deliverable_event>& staged_events,
+        const std::vector<sample_event>& staged_samples) override;
 
+    // Gap junctions between cells of the group; junctions to cells of other
+    // groups are ignored.
     std::vector<fvm_gap_junction> fvm_gap_junctions(
         const std::vector<cable_cell>& cells,
         const std::vector<cell_gid_type>& gids,
         const recipe& rec,
         const fvm_discretization& D);
 
+    // Gap junctions to cells of other groups, with the index of the imported
+    // peer site in place of the peer CV. Sets the halo sites and the CVs of
+    // the exported sites.
+    std::vector<fvm_gap_junction> fvm_gap_junction_halo(
+        const std::vector<cable_cell>& cells,
+        const std::vector<cell_gid_type>& gids,
+        const recipe& rec,
+        const fvm_discretization& D);
+
+    gap_junction_halo_sites gap_junction_halo() const override {
+        return gj_halo_sites_;
+    }
+
+    void export_gap_junction_voltages(std::vector<value_type>& v) const override;
+    void import_gap_junction_voltages(const std::vector<value_type>& v) override;
+
+    bool serialize(std::vector<char>& buf) const override;
+    void deserialize(const char*& p) override;
+
     // Generates indom index for every gid, guarantees that gids belonging to the same supercell are in the same intdom
     // Fills cell_to_intdom map; returns number of intdoms
     fvm_size_type fvm_intdom(
@@ -104,9 +128,60 @@ private:
     std::vector<mechanism_ptr> mechanisms_; // excludes reversal potential calculators.
     std::vector<mechanism_ptr> revpot_mechanisms_;
 
+    // Mechanisms run in each step, as found from the ion dependencies of the
+    // mechanisms: reversal potential mechanisms of ions with concentrations
+    // that change, and mechanisms that write ion concentrations.
+    std::vector<mechanism*> step_revpot_mechanisms_;
+    std::vector<mechanism*> concentration_writers_;
+
     // Non-physical voltage check threshold, 0 => no check.
     value_type check_voltage_mV = 0;
 
+    // Adaptive time stepping parameters; disabled if tolerance is zero.
+    value_type adaptive_dt_tolerance_ = 0;
+    value_type adaptive_dt_max_ = 0;
+
+    // Quiescence detection; disabled if tolerance is zero. The membrane
+    // voltage and mechanism states at the end of the last integrated epoch
+    // are kept on the host, together with the CV areas [µm²], the membrane
+    // capacitance of the integration domains [pF] and the active intervals
+    // of current clamps.
+    value_type quiescence_tolerance_ = 0;
+    bool quiescent_ = false;
+    std::vector<value_type> epoch_voltage_;
+    std::vector<value_type> epoch_state_;
+    std::vector<value_type> cv_area_;
+    std::vector<index_type> cv_to_intdom_;
+    std::vector<value_type> intdom_capacitance_;
+    std::vector<std::pair<value_type, value_type>> stimulus_intervals_;
+
+    // Gap junction currents are solved for with the membrane voltage, in
+    // the matrix, rather than added from the voltage at the start of a step.
+    bool implicit_gap_junctions_ = false;
+
+    // Cache-blocked step schedule; empty if steps are not tiled.
+    typename backend::step_tiles step_tiles_;
+
+    // Membrane current probes read currents that tiled steps only compute
+    // tile by tile, after the samples of the step are taken.
+    bool current_probes_ = false;
+
+    // Mechanism updates split by cell block; empty if not split.
+    typename backend::mechanism_blocks mechanism_blocks_;
+
+    // Gap junctions to cells of other groups: the sites, the CVs of the
+    // exported sites and, for quiescence detection, the imported voltages.
+    gap_junction_halo_sites gj_halo_sites_;
+    std::vector<index_type> gj_export_cv_;
+    std::vector<value_type> gj_import_voltage_;
+
+    // CVs of the gap junction sites of each cell with gap junctions.
+    std::unordered_map<cell_gid_type, std::vector<unsigned>> gap_junction_site_cvs(
+        const std::vector<cable_cell>& cells,
+        const std::vector<cell_gid_type>& gids,
+        const recipe& rec,
+        const fvm_discretization& D);
+
     // Host-side views/copies and local state.
     decltype(backend::host_view(sample_time_)) sample_time_host_;
     decltype(backend::host_view(sample_value_)) sample_value_host_;
@@ -125,6 +200,23 @@ private:
         arb_assert((assert_tmin(), true));
     }
 
+    // Cells can skip integration to tfinal if they are at rest, receive no
+    // events and have no current clamp active before tfinal.
+    bool can_skip_to(value_type tfinal, const std::vector<deliverable_event>& staged_events) const {
+        if (!quiescent_ || !staged_events.empty()) return false;
+        for (auto& iv: stimulus_intervals_) {
+            if (iv.first<tfinal && iv.second>tmin_) return false;
+        }
+        return true;
+    }
+
+    // Advance time to tfinal without changing state, taking samples.
+    void skip_to(value_type tfinal);
+
+    // Update quiescent_ from the change in voltage and mechanism state since
+    // the last call, and the membrane current, after an epoch of length dt.
+    void update_quiescence(value_type dt);
+
     static unsigned dt_steps(value_type t0, value_type t1, value_type dt) {
         return t0>=t1? 0: 1+(unsigned)((t1-t0)/dt);
     }
@@ -154,6 +246,11 @@ void fvm_lowered_cell_impl<Backend>::reset() {
     state_->reset();
     set_tmin(0);
 
+    quiescent_ = false;
+    epoch_voltage_.clear();
+    epoch_state_.clear();
+    gj_import_voltage_.clear();
+
     for (auto& m: revpot_mechanisms_) {
         m->initialize();
     }
@@ -164,6 +261,11 @@ void fvm_lowered_cell_impl<Backend>::reset() {
 
     update_ion_state();
 
+    // Reversal potentials that do not change are only computed here.
+    for (auto& m: revpot_mechanisms_) {
+        m->nrn_current();
+    }
+
     // NOTE: Threshold watcher reset must come after the voltage values are set,
     // as voltage is implicitly read by watcher to set initial state.
     threshold_watcher_.reset();
@@ -173,8 +275,8 @@ template <typename Backend>
 fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
     value_type tfinal,
     value_type dt_max,
-    std::vector<deliverable_event> staged_events,
-    std::vector<sample_event> staged_samples)
+    const std::vector<deliverable_event>& staged_events,
+    const std::vector<sample_event>& staged_samples)
 {
     using util::as_const;
 
@@ -184,17 +286,40 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
     PE(advance_integrate_setup);
     threshold_watcher_.clear_crossings();
 
-    auto n_samples = staged_samples.size();
-    if (sample_time_.size() < n_samples) {
+    // Samples are stored at their offsets, which may be shared by reduced
+    // samples or followed by further values for whole-cell probes.
+    sample_size_type n_samples = 0;
+    for (const auto& ev: staged_samples) {
+        n_samples = std::max(n_samples, ev.raw.offset+ev.raw.width);
+    }
+    if (sample_time_.size() < (std::size_t)n_samples) {
         sample_time_ = array(n_samples);
         sample_value_ = array(n_samples);
     }
 
-    state_->deliverable_events.init(std::move(staged_events));
-    sample_events_.init(std::move(staged_samples));
+    state_->deliverable_events.init(staged_events);
+    sample_events_.init(staged_samples);
 
     arb_assert((assert_tmin(), true));
+
+    if (can_skip_to(tfinal, staged_events)) {
+        skip_to(tfinal);
+        PL();
+
+        return fvm_integration_result{
+            util::range_pointer_view(threshold_watcher_.crossings()),
+            util::range_pointer_view(sample_time_host_),
+            util::range_pointer_view(sample_value_host_),
+            false
+        };
+    }
+
+    const value_type tstart = tmin_;
     unsigned remaining_steps = dt_steps(tmin_, tfinal, dt_max);
+
+    // With adaptive steps, integration domains take steps of at least
+    // dt_max, and the step count is re-estimated after each step.
+    const bool adaptive = adaptive_dt_tolerance_>0;
     PL();
 
     // TODO: Consider devolving more of this to back-end routines (e.g.
@@ -205,7 +330,7 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
         // Update any required reversal potentials based on ionic concs.
 
         PE(advance_update_revpot)
-        for (auto& m: revpot_mechanisms_) {
+        for (auto m: step_revpot_mechanisms_) {
             m->nrn_current();
         }
         PL();
@@ -220,46 +345,102 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
         PE(advance_integrate_current_zero);
         state_->zero_currents();
         PL();
+
+        // Tiled steps compute the mechanism currents tile by tile after the
+        // samples are taken; steps that may sample currents are not tiled.
+        const bool tiled = !adaptive && !step_tiles_.empty() &&
+            !(current_probes_ && !sample_events_.empty());
+
         for (auto& m: mechanisms_) {
             m->deliver_events();
-            m->nrn_current();
+        }
+        if (!tiled) {
+            if (!mechanism_blocks_.empty()) {
+                backend::nrn_current(mechanism_blocks_);
+            }
+            else {
+                for (auto& m: mechanisms_) {
+                    m->nrn_current();
+                }
+            }
         }
 
         // Add current contribution from gap_junctions
-        state_->add_gj_current();
+        if (!implicit_gap_junctions_) {
+            state_->add_gj_current();
+        }
+        if (!gj_halo_sites_.imported.empty()) {
+            state_->add_gj_halo_current();
+        }
 
         PE(advance_integrate_events);
+        if (adaptive) {
+            // (Uses the marked events to restart integration domains that
+            // have received events with a short step.)
+            state_->update_time_to_adaptive(dt_max, tfinal);
+        }
         state_->deliverable_events.drop_marked_events();
 
         // Update event list and integration step times.
 
-        state_->update_time_to(dt_max, tfinal);
+        if (!adaptive) {
+            state_->update_time_to(dt_max, tfinal);
+        }
         state_->deliverable_events.event_time_if_before(state_->time_to);
-        state_->set_dt();
         PL();
 
         // Take samples at cell time if sample time in this step interval.
+        // Adaptive steps instead end at the next sample time, so that
+        // samples are taken at their sample times.
 
         PE(advance_integrate_samples);
-        sample_events_.mark_until(state_->time_to);
+        if (adaptive) {
+            sample_events_.mark_until_after(state_->time);
+        }
+        else {
+            sample_events_.mark_until(state_->time_to);
+        }
         state_->take_samples(sample_events_.marked_events(), sample_time_, sample_value_);
         sample_events_.drop_marked_events();
+        if (adaptive) {
+            sample_events_.event_time_if_before(state_->time_to);
+        }
         PL();
 
-        // Integrate voltage by matrix solve.
-
-        PE(advance_integrate_matrix_build);
-        matrix_.assemble(state_->dt_intdom, state_->voltage, state_->current_density, state_->conductivity);
-        PL();
-        PE(advance_integrate_matrix_solve);
-        matrix_.solve();
-        memory::copy(matrix_.solution(), state_->voltage);
+        PE(advance_integrate_events);
+        state_->set_dt();
         PL();
 
-        // Integrate mechanism state.
+        if (tiled) {
+            backend::integrate_step_tiles(step_tiles_, *state_, matrix_.state_);
+        }
+        else {
+            // Integrate voltage by matrix solve.
 
-        for (auto& m: mechanisms_) {
-            m->nrn_state();
+            PE(advance_integrate_matrix_build);
+            matrix_.assemble(state_->dt_intdom, state_->voltage, state_->current_density, state_->conductivity);
+            PL();
+            PE(advance_integrate_matrix_solve);
+            matrix_.solve();
+            if (adaptive) {
+                state_->update_dt_adaptive(matrix_.solution(), adaptive_dt_tolerance_, dt_max, adaptive_dt_max_);
+            }
+            memory::copy(matrix_.solution(), state_->voltage);
+            PL();
+
+            // Integrate mechanism state. With Crank-Nicolson steps, the states
+            // lag the voltage by half a step: they are advanced from the middle
+            // of this step to the middle of the next with the voltage at the
+            // end of this step, the midpoint of their own step.
+
+            if (!mechanism_blocks_.empty()) {
+                backend::nrn_state(mechanism_blocks_);
+            }
+            else {
+                for (auto& m: mechanisms_) {
+                    m->nrn_state();
+                }
+            }
         }
 
         // Update ion concentrations.
@@ -286,7 +467,7 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
         // Check for end of integration.
 
         PE(advance_integrate_stepsupdate);
-        if (!--remaining_steps) {
+        if (!--remaining_steps || adaptive) {
             tmin_ = state_->time_bounds().first;
             remaining_steps = dt_steps(tmin_, tfinal, dt_max);
         }
@@ -295,6 +476,10 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
 
     set_tmin(tfinal);
 
+    if (quiescence_tolerance_>0 && tfinal>tstart) {
+        update_quiescence(tfinal-tstart);
+    }
+
     const auto& crossings = threshold_watcher_.crossings();
     sample_time_host_ = backend::host_view(sample_time_);
     sample_value_host_ = backend::host_view(sample_value_);
@@ -306,10 +491,64 @@ fvm_integration_result fvm_lowered_cell_impl<Backend>::integrate(
     };
 }
 
+template <typename Backend>
+void fvm_lowered_cell_impl<Backend>::skip_to(value_type tfinal) {
+    // Each pass ends the domains' steps at their next sample time, where the
+    // sample is taken on the following pass.
+    for (;;) {
+        sample_events_.mark_until_after(state_->time);
+        state_->take_samples(sample_events_.marked_events(), sample_time_, sample_value_);
+        sample_events_.drop_marked_events();
+        if (tmin_>=tfinal) break;
+
+        state_->update_time_to(tfinal-tmin_, tfinal);
+        sample_events_.event_time_if_before(state_->time_to);
+        memory::copy(state_->time_to, state_->time);
+        tmin_ = state_->time_bounds().first;
+    }
+    set_tmin(tfinal);
+
+    sample_time_host_ = backend::host_view(sample_time_);
+    sample_value_host_ = backend::host_view(sample_value_);
+}
+
+template <typename Backend>
+void fvm_lowered_cell_impl<Backend>::update_quiescence(value_type dt) {
+    auto v = backend::host_view(state_->voltage);
+    auto i = backend::host_view(state_->current_density);
+    std::vector<value_type> s;
+    bool has_state = backend::mechanism_state(mechanisms_, s);
+
+    // Cells are at rest if the voltage and the mechanism states changed by
+    // less than the tolerance over the epoch, and the total membrane current
+    // of each integration domain would change its mean voltage by less than
+    // the tolerance over the next one. Current density [A/m²] times area
+    // [µm²] is in [pA], and over capacitance [pF] is a rate in [mV/ms].
+    auto small = [tol = quiescence_tolerance_](value_type x) { return std::abs(x)<tol; };
+
+    quiescent_ = has_state && !epoch_voltage_.empty() && s.size()==epoch_state_.size();
+    std::vector<value_type> intdom_current(intdom_capacitance_.size());
+    for (auto j: util::count_along(epoch_voltage_)) {
+        if (!quiescent_) break;
+        quiescent_ = small(v[j]-epoch_voltage_[j]);
+        intdom_current[cv_to_intdom_[j]] += i[j]*cv_area_[j];
+    }
+    for (auto k: util::count_along(intdom_current)) {
+        if (!quiescent_) break;
+        quiescent_ = small(intdom_current[k]/intdom_capacitance_[k]*dt);
+    }
+    for (auto j: util::count_along(epoch_state_)) {
+        if (!quiescent_) break;
+        quiescent_ = small(s[j]-epoch_state_[j]);
+    }
+    epoch_voltage_.assign(v.begin(), v.end());
+    epoch_state_ = std::move(s);
+}
+
 template <typename B>
 void fvm_lowered_cell_impl<B>::update_ion_state() {
     state_->ions_init_concentration();
-    for (auto& m: mechanisms_) {
+    for (auto m: concentration_writers_) {
         m->write_ions();
     }
 }
@@ -373,21 +612,31 @@ void fvm_lowered_cell_impl<B>::initialize(
 
     const mechanism_catalogue* catalogue = global_props.catalogue;
 
-    // Mechanism instantiator helper.
+    // Mechanism instantiator and info helpers.
     auto mech_instance = [&catalogue](const std::string& name) {
         auto cat = builtin_mechanisms().has(name)? &builtin_mechanisms(): catalogue;
         return cat->instance<backend>(name);
     };
+    auto mech_info = [&catalogue](const std::string& name) {
+        auto cat = builtin_mechanisms().has(name)? &builtin_mechanisms(): catalogue;
+        return (*cat)[name];
+    };
 
     // Check for physically reasonable membrane volages?
 
     check_voltage_mV = global_props.membrane_voltage_limit_mV;
+    adaptive_dt_tolerance_ = global_props.adaptive_dt_tolerance;
+    adaptive_dt_max_ = global_props.adaptive_dt_max;
+    quiescence_tolerance_ = global_props.quiescence_tolerance;
 
     auto num_intdoms = fvm_intdom(rec, gids, cell_to_intdom);
 
     // Discretize cells, build matrix.
 
     fvm_discretization D = fvm_discretize(cells, global_props.default_parameters);
+    if (global_props.renumber_cvs) {
+        fvm_renumber_cvs(D);
+    }
 
     std::vector<index_type> cv_to_intdom(D.ncv);
     std::transform(D.cv_to_cell.begin(), D.cv_to_cell.end(), cv_to_intdom.begin(),
@@ -397,6 +646,18 @@ void fvm_lowered_cell_impl<B>::initialize(
     matrix_ = matrix<backend>(D.parent_cv, D.cell_cv_bounds, D.cv_capacitance, D.face_conductance, D.cv_area, cell_to_intdom);
     sample_events_ = sample_event_stream(num_intdoms);
 
+    cv_area_.clear();
+    cv_to_intdom_.clear();
+    intdom_capacitance_.clear();
+    if (quiescence_tolerance_>0) {
+        cv_area_ = D.cv_area;
+        cv_to_intdom_ = cv_to_intdom;
+        intdom_capacitance_.assign(num_intdoms, 0);
+        for (auto i: count_along(D.cv_capacitance)) {
+            intdom_capacitance_[cv_to_intdom[i]] += D.cv_capacitance[i];
+        }
+    }
+
     // Discretize mechanism data.
 
     fvm_mechanism_data mech_data = fvm_build_mechanism_data(global_props,  cells, D);
@@ -404,6 +665,7 @@ void fvm_lowered_cell_impl<B>::initialize(
     // Discretize and build gap junction info.
 
     auto gj_vector = fvm_gap_junctions(cells, gids, rec, D);
+    auto gj_halo = fvm_gap_junction_halo(cells, gids, rec, D);
 
     // Create shared cell state.
     // (SIMD padding requires us to check each mechanism for alignment/padding constraints.)
@@ -415,6 +677,7 @@ void fvm_lowered_cell_impl<B>::initialize(
     state_ = std::make_unique<shared_state>(
                 num_intdoms, cv_to_intdom, gj_vector, D.init_membrane_potential, D.temperature_K, D.diam_um,
                 data_alignment? data_alignment: 1u);
+    state_->set_gj_halo(gj_halo, gj_halo_sites_.imported.size());
 
     // Instantiate mechanisms and ions.
 
@@ -429,8 +692,39 @@ void fvm_lowered_cell_impl<B>::initialize(
         }
     }
 
+    // Adaptive steps end at the switching times of stimuli, and quiescent
+    // cells are woken while stimuli are active.
+
+    std::vector<std::vector<value_type>> intdom_breakpoints(num_intdoms);
+    stimulus_intervals_.clear();
+    if (auto stim = value_by_key(mech_data.mechanisms, "_builtin_stimulus")) {
+        auto param = [&](const char* name) -> const std::vector<value_type>& {
+            return std::find_if(stim->param_values.begin(), stim->param_values.end(),
+                [&](auto& p) { return p.first==name; })->second;
+        };
+        auto& delay = param("delay");
+        auto& duration = param("duration");
+        for (auto i: count_along(stim->cv)) {
+            auto& bp = intdom_breakpoints[cv_to_intdom[stim->cv[i]]];
+            bp.push_back(delay[i]);
+            bp.push_back(delay[i]+duration[i]);
+            stimulus_intervals_.push_back({delay[i], delay[i]+duration[i]});
+        }
+    }
+    if (adaptive_dt_tolerance_>0 && !backend::set_adaptive_dt(*state_, intdom_breakpoints)) {
+        adaptive_dt_tolerance_ = 0;
+    }
+
     target_handles.resize(mech_data.ntarget);
 
+    // Ions with currents or concentrations written by mechanisms, and the
+    // reversal potential mechanisms with their ion dependencies.
+    std::unordered_set<std::string> current_ions, concentration_ions;
+    std::vector<std::pair<mechanism*, mechanism_info>> revpot_info;
+
+    step_revpot_mechanisms_.clear();
+    concentration_writers_.clear();
+
     unsigned mech_id = 0;
     for (auto& m: mech_data.mechanisms) {
         auto& name = m.first;
@@ -490,11 +784,47 @@ void fvm_lowered_cell_impl<B>::initialize(
             minst.mech->set_parameter(pv.first, pv.second);
         }
 
+        auto info = mech_info(name);
         if (config.kind==mechanismKind::revpot) {
             revpot_mechanisms_.push_back(mechanism_ptr(minst.mech.release()));
+            revpot_info.push_back({revpot_mechanisms_.back().get(), std::move(info)});
         }
         else {
             mechanisms_.push_back(mechanism_ptr(minst.mech.release()));
+
+            bool writes_concentration = false;
+            for (auto& ion: info.ions) {
+                if (ion.second.write_current) {
+                    current_ions.insert(ion.first);
+                }
+                if (ion.second.write_concentration_int || ion.second.write_concentration_ext) {
+                    concentration_ions.insert(ion.first);
+                    writes_concentration = true;
+                }
+            }
+            if (writes_concentration) {
+                concentration_writers_.push_back(mechanisms_.back().get());
+            }
+        }
+    }
+
+    // Ion currents that are never written stay zero, and concentrations that
+    // are never written keep their initial values. Reversal potential
+    // mechanisms, which have no state, then only need to run when the
+    // concentrations of one of their ions change.
+
+    for (auto& i: state_->ion_data) {
+        i.second.write_current = current_ions.count(i.first);
+        i.second.write_concentration = concentration_ions.count(i.first);
+    }
+
+    for (auto& r: revpot_info) {
+        bool changing = false;
+        for (auto& ion: r.second.ions) {
+            changing |= concentration_ions.count(ion.first)>0;
+        }
+        if (changing) {
+            step_revpot_mechanisms_.push_back(r.first);
         }
     }
 
@@ -515,38 +845,57 @@ void fvm_lowered_cell_impl<B>::initialize(
             probe_info pi = rec.get_probe({gid, j});
             auto where = any_cast<cell_probe_address>(pi.address);
 
-            auto cv = D.branch_location_cv(cell_idx, where.location);
             probe_handle handle;
+            std::size_t width = 1;
+            bool whole_cell = false;
 
             switch (where.kind) {
             case cell_probe_address::membrane_voltage:
-                handle = state_->voltage.data()+cv;
+                handle = state_->voltage.data()+D.branch_location_cv(cell_idx, where.location);
                 break;
             case cell_probe_address::membrane_current:
-                handle = state_->current_density.data()+cv;
+                handle = state_->current_density.data()+D.branch_location_cv(cell_idx, where.location);
+                current_probes_ = true;
+                break;
+            case cell_probe_address::membrane_voltage_cell:
+                handle = state_->voltage.data()+D.cell_cv_bounds[cell_idx];
+                width = D.cell_cv_bounds[cell_idx+1]-D.cell_cv_bounds[cell_idx];
+                whole_cell = true;
+                break;
+            case cell_probe_address::membrane_current_cell:
+                handle = state_->current_density.data()+D.cell_cv_bounds[cell_idx];
+                width = D.cell_cv_bounds[cell_idx+1]-D.cell_cv_bounds[cell_idx];
+                whole_cell = true;
+                current_probes_ = true;
                 break;
             default:
                 throw arbor_internal_error("fvm_lowered_cell: unrecognized probeKind");
             }
 
-            probe_map.insert({pi.id, {handle, pi.tag}});
+            probe_map.insert({pi.id, {handle, pi.tag, width, whole_cell}});
         }
     }
 
     threshold_watcher_ = backend::voltage_watcher(*state_, detector_cv, detector_threshold, context_);
+    backend::set_branch_parallel(matrix_.state_, global_props.branch_parallel_solve);
+    backend::set_interleaved(matrix_.state_, global_props.interleave_cell_matrices);
+    implicit_gap_junctions_ = global_props.implicit_gap_junctions && !gj_vector.empty() &&
+        backend::set_implicit_gap_junctions(matrix_.state_, gj_vector,
+            global_props.gap_junction_tolerance, global_props.gap_junction_iterations);
+    backend::set_crank_nicolson(matrix_.state_, global_props.integrator==integration_scheme::crank_nicolson);
+    backend::set_cell_blocks(matrix_.state_, threshold_watcher_, global_props.cell_group_blocks, context_);
+    step_tiles_ = backend::make_step_tiles(mechanisms_, matrix_.state_, global_props.step_tile_bytes);
+    mechanism_blocks_ = backend::make_mechanism_blocks(mechanisms_, matrix_.state_);
 
     reset();
 }
 
-// Get vector of gap_junctions
 template <typename B>
-std::vector<fvm_gap_junction> fvm_lowered_cell_impl<B>::fvm_gap_junctions(
+std::unordered_map<cell_gid_type, std::vector<unsigned>> fvm_lowered_cell_impl<B>::gap_junction_site_cvs(
         const std::vector<cable_cell>& cells,
         const std::vector<cell_gid_type>& gids,
         const recipe& rec, const fvm_discretization& D) {
 
-    std::vector<fvm_gap_junction> v;
-
     std::unordered_map<cell_gid_type, std::vector<unsigned>> gid_to_cvs;
     for (auto cell_idx: util::make_span(0, D.ncell)) {
 
@@ -561,12 +910,30 @@ std::vector<fvm_gap_junction> fvm_lowered_cell_impl<B>::fvm_gap_junctions(
         }
     }
 
+    return gid_to_cvs;
+}
+
+// Get vector of gap_junctions
+template <typename B>
+std::vector<fvm_gap_junction> fvm_lowered_cell_impl<B>::fvm_gap_junctions(
+        const std::vector<cable_cell>& cells,
+        const std::vector<cell_gid_type>& gids,
+        const recipe& rec, const fvm_discretization& D) {
+
+    std::vector<fvm_gap_junction> v;
+
+    auto gid_to_cvs = gap_junction_site_cvs(cells, gids, rec, D);
+    std::unordered_set<cell_gid_type> local_gids(gids.begin(), gids.end());
+
     for (auto gid: gids) {
         auto gj_list = rec.gap_junctions_on(gid);
         for (auto g: gj_list) {
             if (gid != g.local.gid && gid != g.peer.gid) {
                 throw arb::bad_cell_description(cell_kind::cable, gid);
             }
+            if (!local_gids.count(g.local.gid) || !local_gids.count(g.peer.gid)) {
+                continue;
+            }
             cell_gid_type cv0, cv1;
             try {
                 cv0 = gid_to_cvs[g.local.gid].at(g.local.index);
@@ -585,6 +952,106 @@ std::vector<fvm_gap_junction> fvm_lowered_cell_impl<B>::fvm_gap_junctions(
     return v;
 }
 
+template <typename B>
+std::vector<fvm_gap_junction> fvm_lowered_cell_impl<B>::fvm_gap_junction_halo(
+        const std::vector<cable_cell>& cells,
+        const std::vector<cell_gid_type>& gids,
+        const recipe& rec, const fvm_discretization& D) {
+
+    std::vector<fvm_gap_junction> v;
+
+    gj_halo_sites_ = {};
+    gj_export_cv_.clear();
+
+    auto gid_to_cvs = gap_junction_site_cvs(cells, gids, rec, D);
+    std::unordered_set<cell_gid_type> local_gids(gids.begin(), gids.end());
+    std::unordered_map<cell_member_type, index_type> exported, imported;
+
+    for (auto gid: gids) {
+        for (auto g: rec.gap_junctions_on(gid)) {
+            if (gid != g.local.gid && gid != g.peer.gid) {
+                throw arb::bad_cell_description(cell_kind::cable, gid);
+            }
+            auto site = gid==g.local.gid? g.local: g.peer;
+            auto peer = gid==g.local.gid? g.peer: g.local;
+            if (local_gids.count(peer.gid)) {
+                continue;
+            }
+
+            index_type cv;
+            try {
+                cv = gid_to_cvs[gid].at(site.index);
+            }
+            catch (std::out_of_range&) {
+                throw arb::bad_cell_description(cell_kind::cable, gid);
+            }
+
+            if (!exported.count(site)) {
+                exported[site] = gj_export_cv_.size();
+                gj_halo_sites_.exported.push_back(site);
+                gj_export_cv_.push_back(cv);
+            }
+            if (!imported.count(peer)) {
+                imported[peer] = gj_halo_sites_.imported.size();
+                gj_halo_sites_.imported.push_back(peer);
+                gj_halo_sites_.imported_by.push_back(gid);
+            }
+            v.push_back(fvm_gap_junction(std::make_pair(cv, imported[peer]), g.ggap * 1e3 / D.cv_area[cv]));
+        }
+    }
+
+    return v;
+}
+
+template <typename B>
+void fvm_lowered_cell_impl<B>::export_gap_junction_voltages(std::vector<value_type>& v) const {
+    if (gj_export_cv_.empty()) return;
+
+    auto voltage = backend::host_view(state_->voltage);
+    for (auto cv: gj_export_cv_) {
+        v.push_back(voltage[cv]);
+    }
+}
+
+template <typename B>
+void fvm_lowered_cell_impl<B>::import_gap_junction_voltages(const std::vector<value_type>& v) {
+    arb_assert(v.size()==gj_halo_sites_.imported.size());
+    if (v.empty()) return;
+
+    // Cells at rest are woken by a change in the voltage of their peers.
+    if (quiescence_tolerance_>0) {
+        for (auto i: util::count_along(v)) {
+            if (gj_import_voltage_.empty() || std::abs(v[i]-gj_import_voltage_[i])>=quiescence_tolerance_) {
+                quiescent_ = false;
+                break;
+            }
+        }
+        gj_import_voltage_ = v;
+    }
+
+    state_->set_gj_halo_voltage(v);
+}
+
+template <typename B>
+bool fvm_lowered_cell_impl<B>::serialize(std::vector<char>& buf) const {
+    util::write_bytes(buf, tmin_);
+    util::write_bytes(buf, quiescent_);
+    util::write_bytes(buf, epoch_voltage_);
+    util::write_bytes(buf, epoch_state_);
+    util::write_bytes(buf, gj_import_voltage_);
+    return backend::serialize_state(*state_, mechanisms_, revpot_mechanisms_, threshold_watcher_, buf);
+}
+
+template <typename B>
+void fvm_lowered_cell_impl<B>::deserialize(const char*& p) {
+    util::read_bytes(p, tmin_);
+    util::read_bytes(p, quiescent_);
+    util::read_bytes(p, epoch_voltage_);
+    util::read_bytes(p, epoch_state_);
+    util::read_bytes(p, gj_import_voltage_);
+    backend::deserialize_state(*state_, mechanisms_, revpot_mechanisms_, threshold_watcher_, p);
+}
+
 template <typename B>
 fvm_size_type fvm_lowered_cell_impl<B>::fvm_intdom(
         const recipe& rec,
@@ -619,8 +1086,9 @@ fvm_size_type fvm_lowered_cell_impl<B>::fvm_intdom(
                         gj.peer.gid==g?  gj.local.gid:
                         throw bad_cell_description(cell_kind::cable, g);
 
+                // Cells of other groups are coupled through the halo.
                 if (!gid_to_loc.count(peer)) {
-                    throw gj_unsupported_domain_decomposition(g, peer);
+                    continue;
                 }
 
                 if (!visited.count(peer)) {
@@ -65,6 +65,18 @@ struct bad_event_time: arbor_exception {
     time_type sim_time;
 };
 
+// Trace and spike file errors:
+
+struct trace_file_error: arbor_exception {
+    trace_file_error(const std::string& path, const std::string& what);
+    std::string path;
+};
+
+struct spike_file_error: arbor_exception {
+    spike_file_error(const std::string& path, const std::string& what);
+    std::string path;
+};
+
 // Mechanism catalogue errors:
 
 struct no_such_mechanism: arbor_exception {
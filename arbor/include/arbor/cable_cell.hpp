@@ -3,6 +3,7 @@
 
 #include <unordered_map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <arbor/arbexcept.hpp>
@@ -28,15 +29,24 @@ struct lid_range {
 };
 
 // Probe type for cell descriptions.
+//
+// The membrane_voltage_cell and membrane_current_cell kinds sample the
+// value at every CV of the cell, in CV order, and ignore the location.
+// Sampler functions receive one record per sample time, with data of type
+// `const cable_sample_range*`.
 struct cell_probe_address {
     enum probe_kind {
-        membrane_voltage, membrane_current
+        membrane_voltage, membrane_current,
+        membrane_voltage_cell, membrane_current_cell
     };
 
     mlocation location;
     probe_kind kind;
 };
 
+// Sample data of whole-cell probes: the half-open range of values.
+using cable_sample_range = std::pair<const double*, const double*>;
+
 // Forward declare the implementation, for PIMPL.
 struct cable_cell_impl;
 
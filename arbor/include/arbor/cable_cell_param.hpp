@@ -276,6 +276,23 @@ struct cable_cell_parameter_set: public cable_cell_local_parameter_set {
 
 extern cable_cell_local_parameter_set neuron_parameter_defaults;
 
+// Time integration scheme for the membrane voltage.
+//
+// implicit_euler:  first order, unconditionally stable.
+// crank_nicolson:  second order: the voltage is advanced by an implicit Euler
+//                  half step followed by extrapolation to the end of the step,
+//                  and mechanism states are staggered by half a step, as with
+//                  secondorder=1 in NEURON: the states are advanced with the
+//                  voltage at the end of a step, the middle of their own step,
+//                  and the currents of a step use the states at its middle.
+//                  Ion currents are not corrected to the middle of the step
+//                  as with secondorder=2.
+
+enum class integration_scheme {
+    implicit_euler,
+    crank_nicolson
+};
+
 // Global cable cell data.
 
 struct cable_cell_global_properties {
@@ -288,6 +305,73 @@ struct cable_cell_global_properties {
     // True => combine linear synapses for performance.
     bool coalesce_synapses = true;
 
+    // If >1, the multicore back end splits matrix assembly and solution,
+    // mechanism updates and spike threshold testing in each cell group into
+    // up to this many blocks of whole cells, which are run in parallel on the
+    // thread pool.
+    // Useful when there are fewer cell groups than threads.
+    unsigned cell_group_blocks = 1;
+
+    // If true, the multicore back end stores the matrices of cells of
+    // similar size interleaved in blocks of the SIMD width, and assembles
+    // and solves them with SIMD operations across cells. The GPU back end
+    // always interleaves.
+    bool interleave_cell_matrices = false;
+
+    // If true, the multicore back end solves the matrices branch by branch,
+    // with the branches at the same depth of the cell trees solved in
+    // parallel over up to cell_group_blocks tasks. Takes precedence over
+    // interleave_cell_matrices.
+    bool branch_parallel_solve = false;
+
+    // If true, the CVs of each cell are numbered depth first rather than
+    // branch by branch, so that most CVs directly follow their parent in
+    // memory.
+    bool renumber_cvs = false;
+
+    // If positive, the multicore back end adapts the time step of each
+    // integration domain between the dt given to simulation::run and
+    // adaptive_dt_max [ms], keeping the estimated local truncation error of
+    // the membrane voltage per step below this tolerance [mV]. Steps end at
+    // event, sample and current clamp switching times, and restart from dt
+    // after event delivery. Ignored by the GPU back end.
+    double adaptive_dt_tolerance = 0;
+    double adaptive_dt_max = 0.5;
+
+    // If positive, a cell group whose membrane voltage and mechanism state
+    // variables changed by less than this tolerance at every CV over the last
+    // epoch, and whose total membrane current would change the mean voltage
+    // of each cell by less than this tolerance [mV] over an epoch, is treated
+    // as being at rest: following epochs without events or active current
+    // clamps are skipped, with samples taken from the frozen state. Ignored
+    // by the GPU back end.
+    double quiescence_tolerance = 0;
+
+    // If true, gap junction currents are solved for in the matrix together
+    // with the membrane voltage, by conjugate gradient iteration over the
+    // coupled cells preconditioned by the Hines solve of each cell. The
+    // iteration stops after gap_junction_iterations, or once the voltage
+    // changes by less than gap_junction_tolerance [mV]. The GPU back end
+    // always treats gap junctions explicitly.
+    bool implicit_gap_junctions = false;
+    unsigned gap_junction_iterations = 10;
+    double gap_junction_tolerance = 1e-6;
+
+    // Scheme used to advance the membrane voltage over a step. The GPU back
+    // end always uses implicit_euler.
+    integration_scheme integrator = integration_scheme::implicit_euler;
+
+    // If positive, the multicore back end advances each cell group tile by
+    // tile within a step: the group is split into tiles of consecutive cells
+    // with about this many bytes of state, and the mechanism currents,
+    // matrix solution and mechanism state updates of each tile run back to
+    // back while its data is in cache. Tiling requires implicit Euler steps
+    // and flat matrix storage (no interleaving, branch parallel solve or
+    // implicit gap junctions), and is not used for adaptive steps or, in
+    // groups with membrane current probes, while samples remain to be taken
+    // in an epoch.
+    std::size_t step_tile_bytes = 0;
+
     // Available ion species, together with charge.
     std::unordered_map<std::string, int> ion_species = {
         {"na", 1},
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <arbor/common_types.hpp>
+#include <arbor/version.hpp>
 
 // Basic types shared across FVM implementations/backends.
 
@@ -10,6 +11,14 @@ using fvm_value_type = double;
 using fvm_size_type = cell_local_size_type;
 using fvm_index_type = int;
 
+// Mechanism state and parameters, and ion concentrations, on the multicore
+// back end. Voltage, time and the matrix solution are always fvm_value_type.
+#ifdef ARB_MIXED_PRECISION_ENABLED
+using fvm_state_type = float;
+#else
+using fvm_state_type = fvm_value_type;
+#endif
+
 struct fvm_gap_junction {
     using value_type = fvm_value_type;
     using index_type = fvm_index_type;
@@ -1,24 +1,102 @@
 #pragma once
 
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <arbor/context.hpp>
 #include <arbor/domain_decomposition.hpp>
 #include <arbor/recipe.hpp>
 
 namespace arb {
 
+// Throughput of trial cell groups of a given size, in cell integration
+// steps per second of wall-clock time.
+struct group_size_trial {
+    std::size_t group_size;
+    double throughput;
+};
+
+struct group_size_tuning {
+    cell_kind kind;
+    std::size_t group_size; // Size with the highest throughput.
+    std::vector<group_size_trial> trials;
+};
+
 struct partition_hint {
     constexpr static std::size_t max_size = -1;
 
     std::size_t cpu_group_size = 1;
     std::size_t gpu_group_size = max_size;
     bool prefer_gpu = true;
+
+    // Replace cpu_group_size with the result of tune_cpu_group_size on a
+    // sample of the local cells of the kind without gap junctions.
+    bool tune_cpu_group_size = false;
+
+    // Called with the result of tuning, if set.
+    std::function<void (const group_size_tuning&)> tuning_report;
+
+    // Place cells connected by gap junctions independently, rather than
+    // keeping each connected component in one cell group, so that large
+    // components are spread over groups and ranks. Junctions between groups
+    // couple cells through voltages exchanged between epochs; see
+    // simulation::set_gap_junction_interval.
+    bool split_gap_junctions = false;
 };
 
 using partition_hint_map = std::unordered_map<cell_kind, partition_hint>;
 
+// Estimated relative cost of advancing the cell with the given gid. The
+// unit is arbitrary: only ratios of costs are used by the load balancer.
+using cell_cost_function = std::function<double (cell_gid_type)>;
+
+// Weights used to estimate the cost of a cable cell from its discretization.
+struct cable_cell_cost_model {
+    // Cost per CV (matrix assembly and solution).
+    double cv_cost = 1;
+
+    // Cost per mechanism instance, scaled by the mechanism weight.
+    double instance_cost = 1;
+
+    // Cost per synapse target (event delivery).
+    double target_cost = 0.5;
+
+    // Relative weight by mechanism name. Mechanisms without an entry
+    // are weighted by one plus their number of state variables.
+    std::unordered_map<std::string, double> mechanism_weight;
+};
+
+// Cost estimate derived from the recipe: cable cells are discretized and
+// costed with the supplied model, other cell kinds have unit cost.
+// The returned function keeps a reference to rec.
+cell_cost_function make_cell_cost_estimator(const recipe& rec, cable_cell_cost_model model = {});
+
+// Time the integration of the sample cells, all of kind k and without gap
+// junctions, in multicore cell groups of sizes 1, 2, 4, ..., up to the sample
+// size. All groups of a trial are advanced concurrently over the threads of
+// ctx for the given number of steps, after one warm-up step.
+group_size_tuning tune_cpu_group_size(
+    const recipe& rec,
+    const context& ctx,
+    cell_kind k,
+    const std::vector<cell_gid_type>& sample,
+    unsigned steps = 10,
+    time_type dt = 0.025);
+
+domain_decomposition partition_load_balance(
+    const recipe& rec,
+    const context& ctx,
+    partition_hint_map hint_map = {});
+
+// Partition cells so that the estimated cost, rather than the number of
+// cells, is balanced over domains and over the cell groups of each domain.
+// The group size hints determine the number of cell groups per cell kind.
 domain_decomposition partition_load_balance(
     const recipe& rec,
     const context& ctx,
+    const cell_cost_function& cost,
     partition_hint_map hint_map = {});
 
 } // namespace arb
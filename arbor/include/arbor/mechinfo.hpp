@@ -41,6 +41,10 @@ struct ion_dependency {
     // Support for NMODL 'VALENCE n' construction.
     bool verify_ion_charge = false;
     int expected_ion_charge = 0;
+
+    // Infos that do not say otherwise are taken to write the ion current,
+    // so that it is zeroed before each step.
+    bool write_current = true;
 };
 
 // A hash of the mechanism dynamics description is used to ensure that offline-compiled
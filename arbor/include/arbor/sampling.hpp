@@ -23,6 +23,11 @@ struct sample_record {
 
 using sampler_function = std::function<void (cell_member_type, probe_tag, std::size_t, const sample_record*)>;
 
+// Bulk samplers receive the n sample times and values of one probe as
+// contiguous arrays, valid for the duration of the call. Sample times
+// are given in double precision, as computed by the cell group.
+using bulk_sampler_function = std::function<void (cell_member_type, probe_tag, std::size_t, const double*, const double*)>;
+
 using sampler_association_handle = std::size_t;
 
 enum class sampling_policy {
@@ -31,4 +36,22 @@ enum class sampling_policy {
     // exact         // placeholder: unsupported
 };
 
+// Reduction of each run of `window` consecutive scheduled samples of a probe
+// to one sample, performed in the back end before samples are passed to a
+// bulk sampler. Reduced samples have the time of the first sample in their
+// window; windows may span several calls to run().
+
+enum class sample_reduction_kind {
+    none,     // every sample is passed on
+    mean,     // mean value over the window
+    min,      // minimum value over the window
+    max,      // maximum value over the window
+    decimate  // first sample of the window
+};
+
+struct sample_reduction {
+    sample_reduction_kind kind = sample_reduction_kind::none;
+    unsigned window = 1;
+};
+
 } // namespace arb
@@ -35,6 +35,15 @@ public:
     sampler_association_handle add_sampler(cell_member_predicate probe_ids,
         schedule sched, sampler_function f, sampling_policy policy = sampling_policy::lax);
 
+    sampler_association_handle add_sampler(cell_member_predicate probe_ids,
+        schedule sched, bulk_sampler_function f, sampling_policy policy = sampling_policy::lax);
+
+    // Bulk sampler receiving samples reduced over windows of consecutive
+    // sample times; see sample_reduction.
+    sampler_association_handle add_sampler(cell_member_predicate probe_ids,
+        schedule sched, bulk_sampler_function f, sample_reduction reduction,
+        sampling_policy policy = sampling_policy::lax);
+
     void remove_sampler(sampler_association_handle);
 
     void remove_all_samplers();
@@ -57,6 +66,46 @@ public:
     // are to be delivered at or after the current simulation time.
     void inject_events(const pse_vector& events);
 
+    // Wall-clock time in seconds spent advancing each local cell group, in
+    // the order of the domain decomposition groups, accumulated since
+    // construction, reset or the last call to rebalance. After groups have
+    // been moved by rebalance, the groups that stayed come first, in their
+    // order, followed by the groups that arrived.
+    std::vector<double> group_advance_times() const;
+
+    // Fraction of the epochs advanced by local cable cells, accumulated since
+    // construction or reset, in which the cells were integrated rather than
+    // skipped at rest (see cable_cell_global_properties::quiescence_tolerance).
+    double active_fraction() const;
+
+    // Move cell groups, with their state, from the ranks with the largest to
+    // those with the smallest measured advance time, reorder the dispatch of
+    // cell groups to threads by decreasing advance time, and restart the
+    // measurement. A collective call, between calls to run, e.g. when the
+    // activity of the model changes; rec must be the recipe the simulation
+    // was built from.
+    void rebalance(const recipe& rec);
+
+    // Run sampler and spike callbacks on a separate thread, concurrently with
+    // integration, with at most max_pending callbacks queued; integration
+    // waits when the queue is full. Callbacks are passed copies of the sample
+    // and spike data, and all have completed when run returns. An exception
+    // thrown by a callback is rethrown from run. A max_pending of zero, the
+    // default, runs callbacks synchronously.
+    void set_async_callbacks(std::size_t max_pending);
+
+    // Gap junctions between cells in different cell groups, possibly on
+    // different ranks, couple the cells through the voltages at the junction
+    // sites, which are exchanged every interval [ms] and held fixed in
+    // between. The default interval, zero, exchanges every time step.
+    void set_gap_junction_interval(time_type interval);
+
+    // If enabled, the targets of the connections to local cells are looked
+    // up once, rather than by the cell groups for every event, at the cost of
+    // storing a handle per connection. Events from connections are then
+    // delivered with the stored handles. Disabled by default.
+    void set_resolved_targets(bool enable);
+
     ~simulation();
 
 private:
@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+ * Binary spike output.
+ *
+ * A spike file is a header followed by spike records of 16 bytes: the
+ * source gid and index (uint32) and the spike time (float64).
+ */
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <arbor/spike.hpp>
+
+namespace arb {
+
+// Spike export function that writes spikes to a spike file on a background
+// I/O thread.
+//
+// Spikes are copied into a block, which is handed to the I/O thread once it
+// holds block_size spikes; while the thread is busy writing the previous
+// block, the current block keeps growing, so that the caller never waits for
+// the file system. The I/O thread sorts each block by time: as successive
+// calls export the spikes of successive epochs, the file is sorted by time
+// if the sink is used as the local spike callback of one simulation run
+// sequence. Copies of a sink share the same file, which is flushed and closed
+// with the last copy.
+//
+// With several ranks, each should write its local spikes to its own file.
+
+class spike_file_sink {
+public:
+    explicit spike_file_sink(const std::string& path, std::size_t block_size = 1<<16);
+
+    void operator()(const std::vector<spike>& spikes);
+
+    // Wait until all spikes are written.
+    void flush();
+
+private:
+    struct impl;
+    std::shared_ptr<impl> impl_;
+};
+
+std::vector<spike> read_spike_file(const std::string& path);
+
+// Merge spike files, each sorted by time, into one file sorted by time,
+// with bounded memory use.
+void merge_spike_files(const std::vector<std::string>& inputs, const std::string& output);
+
+} // namespace arb
@@ -0,0 +1,60 @@
+#pragma once
+
+/*
+ * Streaming binary output of scalar trace data from cell probes.
+ *
+ * A trace file is a header followed by a sequence of blocks. Each block
+ * holds consecutive samples of one probe as two columns: the sample times
+ * (float64) followed by the sample values (float32 or float64). Blocks of
+ * different probes are interleaved in the order they are written.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <arbor/common_types.hpp>
+#include <arbor/sampling.hpp>
+
+namespace arb {
+
+enum class trace_value_type {
+    float32, float64
+};
+
+// Bulk sampler that appends samples to a trace file.
+//
+// Samples are buffered per probe, and a block is written to the file when a
+// buffer holds block_size samples, so that memory use is bounded by the
+// number of probes independent of the length of the run. Copies of a sink
+// share the same file, which is flushed and closed with the last copy.
+// Call flush() to write out buffered samples, e.g. at the end of a run.
+
+class trace_file_sink {
+public:
+    explicit trace_file_sink(const std::string& path,
+        trace_value_type value_type = trace_value_type::float64,
+        std::size_t block_size = 4096);
+
+    void operator()(cell_member_type probe_id, probe_tag tag, std::size_t n, const double* times, const double* values);
+
+    void flush();
+
+private:
+    struct impl;
+    std::shared_ptr<impl> impl_;
+};
+
+// Samples of one probe, read from a trace file.
+struct trace_file_column {
+    cell_member_type probe_id;
+    probe_tag tag;
+    std::vector<double> time;
+    std::vector<double> value;
+};
+
+// Read all columns of a trace file, ordered by probe id.
+std::vector<trace_file_column> read_trace_file(const std::string& path);
+
+} // namespace arb
@@ -1,6 +1,7 @@
 #include <lif_cell_group.hpp>
 
 #include "profile/profiler_macro.hpp"
+#include "util/bytes.hpp"
 #include "util/span.hpp"
 
 using namespace arb;
@@ -24,7 +25,7 @@ cell_kind lif_cell_group::get_cell_kind() const {
     return cell_kind::lif;
 }
 
-void lif_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes) {
+void lif_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes, const resolved_lane_subrange&) {
     PE(advance_lif);
     if (event_lanes.size() > 0) {
         for (auto lid: util::make_span(gids_.size())) {
@@ -53,6 +54,20 @@ void lif_cell_group::remove_all_samplers() {}
 void lif_cell_group::set_binning_policy(binning_kind policy, time_type bin_interval) {
 }
 
+void lif_cell_group::serialize(std::vector<char>& buf) const {
+    for (auto& c: cells_) {
+        util::write_bytes(buf, c.V_m);
+    }
+    util::write_bytes(buf, last_time_updated_);
+}
+
+void lif_cell_group::deserialize(const char*& p) {
+    for (auto& c: cells_) {
+        util::read_bytes(p, c.V_m);
+    }
+    util::read_bytes(p, last_time_updated_);
+}
+
 void lif_cell_group::reset() {
     spikes_.clear();
     last_time_updated_.clear();
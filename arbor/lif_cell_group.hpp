@@ -24,7 +24,7 @@ public:
     virtual cell_kind get_cell_kind() const override;
     virtual void reset() override;
     virtual void set_binning_policy(binning_kind policy, time_type bin_interval) override;
-    virtual void advance(epoch epoch, time_type dt, const event_lane_subrange& events) override;
+    virtual void advance(epoch epoch, time_type dt, const event_lane_subrange& events, const resolved_lane_subrange&) override;
 
     virtual const std::vector<spike>& spikes() const override;
     virtual void clear_spikes() override;
@@ -35,6 +35,9 @@ public:
     virtual void remove_sampler(sampler_association_handle) override;
     virtual void remove_all_samplers() override;
 
+    virtual void serialize(std::vector<char>& buf) const override;
+    virtual void deserialize(const char*& p) override;
+
 private:
     // Advances a single cell (lid) with the exact solution (jumps can be arbitrary).
     // Parameter dt is ignored, since we make jumps between two consecutive spikes.
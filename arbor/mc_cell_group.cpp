@@ -1,8 +1,15 @@
+#include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <numeric>
+#include <type_traits>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <arbor/arbexcept.hpp>
 #include <arbor/assert.hpp>
+#include <arbor/cable_cell.hpp>
 #include <arbor/common_types.hpp>
 #include <arbor/sampling.hpp>
 #include <arbor/recipe.hpp>
@@ -15,17 +22,16 @@
 #include "mc_cell_group.hpp"
 #include "profile/profiler_macro.hpp"
 #include "sampler_map.hpp"
+#include "util/bytes.hpp"
 #include "util/filter.hpp"
 #include "util/maputil.hpp"
 #include "util/partition.hpp"
 #include "util/range.hpp"
+#include "util/rangeutil.hpp"
 #include "util/span.hpp"
 
 namespace arb {
 
-ARB_DEFINE_LEXICOGRAPHIC_ORDERING(arb::target_handle,(a.mech_id,a.mech_index,a.intdom_index),(b.mech_id,b.mech_index,b.intdom_index))
-ARB_DEFINE_LEXICOGRAPHIC_ORDERING(arb::deliverable_event,(a.time,a.handle,a.weight),(b.time,b.handle,b.weight))
-
 mc_cell_group::mc_cell_group(const std::vector<cell_gid_type>& gids, const recipe& rec, fvm_lowered_cell_ptr lowered):
     gids_(gids), lowered_(std::move(lowered))
 {
@@ -50,6 +56,18 @@ mc_cell_group::mc_cell_group(const std::vector<cell_gid_type>& gids, const recip
     // Construct cell implementation, retrieving handles and maps. 
     lowered_->initialize(gids_, rec, cell_to_intdom_, target_handles_, probe_map_);
 
+    // Order cells by integration domain for event staging.
+    cells_by_intdom_.resize(gids_.size());
+    std::iota(cells_by_intdom_.begin(), cells_by_intdom_.end(), 0);
+    util::stable_sort_by(cells_by_intdom_, [&](cell_size_type i) { return cell_to_intdom_[i]; });
+
+    intdom_cell_divs_.push_back(0);
+    for (auto i: util::count_along(cells_by_intdom_)) {
+        if (i+1==cells_by_intdom_.size() || cell_to_intdom_[cells_by_intdom_[i]]!=cell_to_intdom_[cells_by_intdom_[i+1]]) {
+            intdom_cell_divs_.push_back(i+1);
+        }
+    }
+
     // Create a list of the global identifiers for the spike sources
     for (auto source_gid: gids_) {
         for (cell_lid_type lid = 0; lid<rec.num_sources(source_gid); ++lid) {
@@ -61,10 +79,12 @@ mc_cell_group::mc_cell_group(const std::vector<cell_gid_type>& gids, const recip
 
 void mc_cell_group::reset() {
     spikes_.clear();
+    activity_ = {};
 
     sample_events_.clear();
     for (auto &assoc: sampler_map_) {
         assoc.sched.reset();
+        assoc.window_count = 0;
     }
 
     for (auto& b: binners_) {
@@ -74,56 +94,125 @@ void mc_cell_group::reset() {
     lowered_->reset();
 }
 
+void mc_cell_group::serialize(std::vector<char>& buf) const {
+    if (!lowered_->serialize(buf)) {
+        throw arbor_internal_error("mc_cell_group: back end state cannot be serialized");
+    }
+    for (auto& b: binners_) {
+        b.serialize(buf);
+    }
+    util::write_bytes(buf, activity_);
+
+    // Reduction windows that span epochs, by sampler handle.
+    std::vector<char> windows;
+    std::uint64_t n = 0;
+    sampler_map_.for_each([&](sampler_association_handle h, const sampler_association& sa) {
+        util::write_bytes(windows, h);
+        util::write_bytes(windows, sa.window_count);
+        util::write_bytes(windows, sa.window_time);
+        util::write_bytes(windows, sa.window_value);
+        ++n;
+    });
+    util::write_bytes(buf, n);
+    buf.insert(buf.end(), windows.begin(), windows.end());
+}
+
+void mc_cell_group::deserialize(const char*& p) {
+    lowered_->deserialize(p);
+    for (auto& b: binners_) {
+        b.deserialize(p);
+    }
+    util::read_bytes(p, activity_);
+
+    auto n = util::read_bytes<std::uint64_t>(p);
+    for (std::uint64_t i = 0; i<n; ++i) {
+        auto h = util::read_bytes<sampler_association_handle>(p);
+        sampler_association window;
+        util::read_bytes(p, window.window_count);
+        util::read_bytes(p, window.window_time);
+        util::read_bytes(p, window.window_value);
+        if (auto sa = sampler_map_.find(h)) {
+            sa->window_count = window.window_count;
+            sa->window_time = std::move(window.window_time);
+            sa->window_value = std::move(window.window_value);
+        }
+    }
+}
+
 void mc_cell_group::set_binning_policy(binning_kind policy, time_type bin_interval) {
     binners_.clear();
     binners_.resize(gids_.size(), event_binner(policy, bin_interval));
+    binned_ = policy!=binning_kind::none;
 }
 
-void mc_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes) {
+void mc_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes, const resolved_lane_subrange& resolved_lanes) {
     time_type tstart = lowered_->time();
 
     PE(advance_eventsetup);
     staged_events_.clear();
 
-    fvm_index_type ev_begin = 0, ev_mid = 0, ev_end = 0;
     // skip event binning if empty lanes are passed
-    if (event_lanes.size()) {
-
-        std::vector<cell_size_type> idx_sorted_by_intdom(cell_to_intdom_.size());
-        std::iota(idx_sorted_by_intdom.begin(), idx_sorted_by_intdom.end(), 0);
-        util::sort_by(idx_sorted_by_intdom, [&](cell_size_type i) { return cell_to_intdom_[i]; });
-
-        /// Event merging on integration domain could benefit from the use of the logic from `tree_merge_events`
-        fvm_index_type prev_intdom = -1;
-        for (auto i: util::count_along(gids_)) {
-            unsigned count_staged = 0;
-
-            auto lid = idx_sorted_by_intdom[i];
-            auto& lane = event_lanes[lid];
-            auto curr_intdom = cell_to_intdom_[lid];
+    if (event_lanes.size() || resolved_lanes.size()) {
+        // Append the events of cell lid due before the end of the epoch to
+        // out as deliverable events, in time order. Events from connections
+        // arrive with their target handles resolved by the communicator;
+        // the handles of other events, e.g. from generators, are read from
+        // the block of the handle table for the cell. Times are passed
+        // through the binner only if a binning policy is set.
+        const pse_vector no_events;
+        const resolved_event_lane no_resolved;
+        auto stage_lane = [&](cell_size_type lid, std::vector<deliverable_event>& out) {
+            auto& binner = binners_[lid];
+            auto stage = [&](time_type t, target_handle h, float w) {
+                t = binned_? binner.bin(t, tstart): std::max(t, tstart);
+                out.push_back(deliverable_event(t, h, w));
+            };
+
+            const auto& resolved = resolved_lanes.size()? resolved_lanes[lid]: no_resolved;
+            auto r = resolved.begin();
+            auto r_end = std::lower_bound(r, resolved.end(), ep.tfinal, event_time_less());
+
+            const auto& events = event_lanes.size()? event_lanes[lid]: no_events;
+            if (events.empty()) {
+                for (; r!=r_end; ++r) stage(r->time, r->handle, r->weight);
+                return;
+            }
 
-            for (auto e: lane) {
+            const target_handle* handles = target_handles_.data()+target_handle_divisions_[lid];
+            for (const auto& e: events) {
                 if (e.time>=ep.tfinal) break;
-                e.time = binners_[lid].bin(e.time, tstart);
-                auto h = target_handles_[target_handle_divisions_[lid]+e.target.index];
-                auto ev = deliverable_event(e.time, h, e.weight);
-                staged_events_.push_back(ev);
-                count_staged++;
+                for (; r!=r_end && r->time<e.time; ++r) stage(r->time, r->handle, r->weight);
+                stage(e.time, handles[e.target.index], e.weight);
+            }
+            for (; r!=r_end; ++r) stage(r->time, r->handle, r->weight);
+        };
+
+        for (auto cells: util::partition_view(intdom_cell_divs_)) {
+            // A cell alone in its integration domain is staged directly.
+            if (cells.second-cells.first==1) {
+                stage_lane(cells_by_intdom_[cells.first], staged_events_);
+                continue;
             }
 
-            ev_end += count_staged;
-
-            if (curr_intdom != prev_intdom) {
-                ev_begin = ev_end - count_staged;
-                prev_intdom = curr_intdom;
+            // Otherwise merge the time-sorted events of the cells in the
+            // domain with a tournament tree.
+            lane_events_.clear();
+            lane_event_divs_.assign(1, 0);
+            for (auto i: util::make_span(cells)) {
+                stage_lane(cells_by_intdom_[i], lane_events_);
+                lane_event_divs_.push_back(lane_events_.size());
             }
-            else {
-                std::inplace_merge(staged_events_.begin() + ev_begin,
-                                   staged_events_.begin() + ev_mid,
-                                   staged_events_.begin() + ev_end);
+
+            lane_spans_.clear();
+            for (auto evs: util::partition_view(lane_event_divs_)) {
+                lane_spans_.push_back({lane_events_.data()+evs.first, lane_events_.data()+evs.second});
             }
 
-            ev_mid = ev_end;
+            lane_merge_.reset(lane_spans_);
+            while (!lane_merge_.empty()) {
+                staged_events_.push_back(lane_merge_.head());
+                lane_merge_.pop();
+            }
         }
     }
     PL();
@@ -144,12 +233,25 @@ void mc_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& e
 
     struct sampler_call_info {
         sampler_function sampler;
+        bulk_sampler_function bulk_sampler;
         cell_member_type probe_id;
         probe_tag tag;
 
         // Offsets are into lowered cell sample time and event arrays.
         sample_size_type begin_offset;
         sample_size_type end_offset;
+
+        // Association and probe index, for reductions: window_count is the
+        // number of samples in the pending window at the start of the epoch.
+        sampler_association* assoc;
+        unsigned probe_index;
+        unsigned window_count;
+
+        // Number of values per sample, and whether samples are passed as
+        // ranges of values: whole-cell probes of single-CV cells have width
+        // one, but still take ranges.
+        sample_size_type width;
+        bool whole_cell;
     };
 
     PE(advance_samplesetup);
@@ -168,41 +270,139 @@ void mc_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& e
         sample_size_type n_times = sample_times.size();
         max_samples_per_call = std::max(max_samples_per_call, n_times);
 
-        for (cell_member_type pid: sa.probe_ids) {
+        // With a reduction, sample k of the epoch belongs to window
+        // (window_count+k)/window, where window 0 may have been started in
+        // an earlier epoch. The back end reduces the samples of a window into
+        // one offset; the first sample of each window assigns the value.
+        const auto kind = sa.reduction.kind;
+        const unsigned window = sa.reduction.window;
+        const unsigned count = sa.window_count;
+        const sample_op op =
+            kind==sample_reduction_kind::mean? sample_op::add:
+            kind==sample_reduction_kind::min?  sample_op::min:
+            kind==sample_reduction_kind::max?  sample_op::max:
+                                               sample_op::assign;
+
+        for (auto j: util::count_along(sa.probe_ids)) {
+            cell_member_type pid = sa.probe_ids[j];
             auto cell_index = gid_index_map_.at(pid.gid);
             auto p = probe_map_[pid];
-
-            call_info.push_back({sa.sampler, pid, p.tag, n_samples, n_samples+n_times});
-
-            for (auto t: sample_times) {
-                sample_event ev{t, (cell_gid_type)cell_to_intdom_[cell_index], {p.handle, n_samples++}};
-                sample_events.push_back(ev);
+            auto intdom = (cell_gid_type)cell_to_intdom_[cell_index];
+            sample_size_type width = p.width;
+
+            sample_size_type begin = n_samples;
+            for (sample_size_type k = 0; k<n_times; ++k) {
+                auto pos = count+k;
+                if (kind==sample_reduction_kind::decimate) {
+                    if (pos%window) continue;
+                    sample_events.push_back(sample_event{sample_times[k], intdom, {p.handle, n_samples, sample_op::assign, width}});
+                    n_samples += width;
+                }
+                else {
+                    auto slot_op = k==0 || pos%window==0? sample_op::assign: op;
+                    sample_events.push_back(sample_event{sample_times[k], intdom, {p.handle, (sample_size_type)(begin+pos/window*width), slot_op, width}});
+                }
             }
+            if (kind!=sample_reduction_kind::decimate) {
+                n_samples = (sample_size_type)(begin+(count+n_times+window-1)/window*width);
+            }
+
+            call_info.push_back({sa.sampler, sa.bulk_sampler, pid, p.tag, begin, n_samples, &sa, (unsigned)j, count, width, p.whole_cell});
         }
+        sa.window_count = (count+n_times)%window;
     }
 
-    // Sample events must be ordered by time for the lowered cell.
-    util::sort_by(sample_events, [](const sample_event& ev) { return event_time(ev); });
+    // Sample events must be grouped by integration domain and ordered by
+    // time within each domain for the lowered cell.
+    util::sort_by(sample_events, [](const sample_event& ev) { return std::make_pair(event_index(ev), event_time(ev)); });
     PL();
 
     // Run integration and collect samples, spikes.
-    auto result = lowered_->integrate(ep.tfinal, dt, staged_events_, std::move(sample_events));
+    auto result = lowered_->integrate(ep.tfinal, dt, staged_events_, sample_events);
+    activity_.advanced += gids_.size();
+    if (result.integrated) activity_.integrated += gids_.size();
 
     // For each sampler callback registered in `call_info`, construct the
     // vector of sample entries from the lowered cell sample times and values
-    // and then call the callback.
+    // and then call the callback. Bulk samplers are passed the lowered cell
+    // sample time and value arrays directly, unless the first or last reduced
+    // value belongs to a window that spans epochs.
+
+    static_assert(std::is_same<fvm_value_type, double>::value,
+        "bulk samplers require double precision sample times and values");
 
     PE(advance_sampledeliver);
     std::vector<sample_record> sample_records;
-    sample_records.reserve(max_samples_per_call);
+    std::vector<cable_sample_range> sample_ranges;
+    std::vector<double> reduced_time, reduced_value;
 
     for (auto& sc: call_info) {
+        if (sc.bulk_sampler) {
+            std::size_t n = sc.end_offset-sc.begin_offset;
+            const double* times = result.sample_time.begin()+sc.begin_offset;
+            const double* values = result.sample_value.begin()+sc.begin_offset;
+
+            auto& sa = *sc.assoc;
+            auto kind = sa.reduction.kind;
+            if (kind==sample_reduction_kind::none || kind==sample_reduction_kind::decimate) {
+                sc.bulk_sampler(sc.probe_id, sc.tag, n, times, values);
+                continue;
+            }
+
+            reduced_time.assign(times, times+n);
+            reduced_value.assign(values, values+n);
+
+            auto j = sc.probe_index;
+            if (sc.window_count) {
+                // Complete the window pending from earlier epochs.
+                double v = sa.window_value[j];
+                reduced_time[0] = sa.window_time[j];
+                reduced_value[0] =
+                    kind==sample_reduction_kind::min? std::min(v, reduced_value[0]):
+                    kind==sample_reduction_kind::max? std::max(v, reduced_value[0]):
+                    v+reduced_value[0];
+            }
+            if (sa.window_count) {
+                // Hold back the last window until it is complete.
+                --n;
+                sa.window_time[j] = reduced_time[n];
+                sa.window_value[j] = reduced_value[n];
+            }
+            if (kind==sample_reduction_kind::mean) {
+                for (std::size_t i = 0; i<n; ++i) {
+                    reduced_value[i] /= sa.reduction.window;
+                }
+            }
+
+            if (n) {
+                sc.bulk_sampler(sc.probe_id, sc.tag, n, reduced_time.data(), reduced_value.data());
+            }
+            continue;
+        }
+
+        sample_records.reserve(max_samples_per_call);
         sample_records.clear();
-        for (auto i = sc.begin_offset; i!=sc.end_offset; ++i) {
-           sample_records.push_back(sample_record{time_type(result.sample_time[i]), &result.sample_value[i]});
+        if (sc.whole_cell) {
+            // Whole-cell probes: one record per sample time, with the range
+            // of values stored contiguously from the sample offset.
+            sample_ranges.clear();
+            for (auto i = sc.begin_offset; i!=sc.end_offset; i += sc.width) {
+                const double* values = &result.sample_value[i];
+                sample_ranges.push_back({values, values+sc.width});
+            }
+            for (auto k: util::count_along(sample_ranges)) {
+                auto i = sc.begin_offset+k*sc.width;
+                const cable_sample_range* range = &sample_ranges[k];
+                sample_records.push_back(sample_record{time_type(result.sample_time[i]), range});
+            }
+        }
+        else {
+            for (auto i = sc.begin_offset; i!=sc.end_offset; ++i) {
+               sample_records.push_back(sample_record{time_type(result.sample_time[i]), &result.sample_value[i]});
+            }
         }
 
-        sc.sampler(sc.probe_id, sc.tag, sc.end_offset-sc.begin_offset, sample_records.data());
+        sc.sampler(sc.probe_id, sc.tag, sample_records.size(), sample_records.data());
     }
     PL();
 
@@ -227,6 +427,27 @@ void mc_cell_group::add_sampler(sampler_association_handle h, cell_member_predic
     }
 }
 
+void mc_cell_group::add_bulk_sampler(sampler_association_handle h, cell_member_predicate probe_ids,
+                                     schedule sched, bulk_sampler_function fn, sample_reduction reduction,
+                                     sampling_policy policy)
+{
+    // Bulk samplers take one value per sample, so whole-cell probes are excluded.
+    auto scalar_probe = [this](cell_member_type pid) { return !probe_map_.at(pid).whole_cell; };
+    std::vector<cell_member_type> probeset =
+        util::assign_from(util::filter(util::filter(util::keys(probe_map_), probe_ids), scalar_probe));
+
+    if (reduction.kind==sample_reduction_kind::none || !reduction.window) {
+        reduction = sample_reduction{sample_reduction_kind::none, 1};
+    }
+
+    if (!probeset.empty()) {
+        sampler_association sa{std::move(sched), {}, std::move(probeset), std::move(fn), reduction};
+        sa.window_time.resize(sa.probe_ids.size());
+        sa.window_value.resize(sa.probe_ids.size());
+        sampler_map_.add(h, std::move(sa));
+    }
+}
+
 void mc_cell_group::remove_sampler(sampler_association_handle h) {
     sampler_map_.remove(h);
 }
@@ -17,6 +17,7 @@
 #include "event_binner.hpp"
 #include "event_queue.hpp"
 #include "fvm_lowered_cell.hpp"
+#include "merge_events.hpp"
 #include "profile/profiler_macro.hpp"
 #include "sampler_map.hpp"
 #include "util/double_buffer.hpp"
@@ -40,7 +41,13 @@ public:
 
     void set_binning_policy(binning_kind policy, time_type bin_interval) override;
 
-    void advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes) override;
+    void advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes, const resolved_lane_subrange& resolved_lanes) override;
+
+    bool resolve_target(cell_size_type lid, cell_lid_type index, target_handle& handle) const override {
+        if (index>=target_handle_divisions_[lid+1]-target_handle_divisions_[lid]) return false;
+        handle = target_handles_[target_handle_divisions_[lid]+index];
+        return true;
+    }
 
     const std::vector<spike>& spikes() const override {
         return spikes_;
@@ -53,10 +60,33 @@ public:
     void add_sampler(sampler_association_handle h, cell_member_predicate probe_ids,
                      schedule sched, sampler_function fn, sampling_policy policy) override;
 
+    void add_bulk_sampler(sampler_association_handle h, cell_member_predicate probe_ids,
+                          schedule sched, bulk_sampler_function fn, sample_reduction reduction,
+                          sampling_policy policy) override;
+
     void remove_sampler(sampler_association_handle h) override;
 
     void remove_all_samplers() override;
 
+    cell_group_activity activity() const override {
+        return activity_;
+    }
+
+    gap_junction_halo_sites gap_junction_halo() const override {
+        return lowered_->gap_junction_halo();
+    }
+
+    void export_gap_junction_voltages(std::vector<fvm_value_type>& v) const override {
+        lowered_->export_gap_junction_voltages(v);
+    }
+
+    void import_gap_junction_voltages(const std::vector<fvm_value_type>& v) override {
+        lowered_->import_gap_junction_voltages(v);
+    }
+
+    void serialize(std::vector<char>& buf) const override;
+    void deserialize(const char*& p) override;
+
 private:
     // List of the gids of the cells in the group.
     std::vector<cell_gid_type> gids_;
@@ -76,12 +106,31 @@ private:
     // Spikes that are generated.
     std::vector<spike> spikes_;
 
+    // Cell epochs advanced and integrated.
+    cell_group_activity activity_;
+
     // Event time binning manager.
     std::vector<event_binner> binners_;
 
+    // False if the binning policy is binning_kind::none.
+    bool binned_ = false;
+
     // List of events to deliver
     std::vector<deliverable_event> staged_events_;
 
+    // Local cell indices sorted by integration domain, partitioned by
+    // integration domain.
+    std::vector<cell_size_type> cells_by_intdom_;
+    std::vector<cell_size_type> intdom_cell_divs_;
+
+    // Scratch space for merging the events of cells that share an
+    // integration domain: events of the cells of one domain, partitioned
+    // by cell, and one span per cell.
+    std::vector<deliverable_event> lane_events_;
+    std::vector<std::size_t> lane_event_divs_;
+    std::vector<util::range<const deliverable_event*>> lane_spans_;
+    impl::basic_tourney_tree<deliverable_event> lane_merge_{deliverable_event(terminal_time, target_handle{}, 0)};
+
     // Pending samples to be taken.
     event_queue<sample_event> sample_events_;
 
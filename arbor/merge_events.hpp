@@ -1,9 +1,12 @@
 #pragma once
 
-#include <iosfwd>
+#include <ostream>
+#include <utility>
 #include <vector>
 
+#include <arbor/assert.hpp>
 #include <arbor/event_generator.hpp>
+#include <arbor/math.hpp>
 #include <arbor/spike_event.hpp>
 
 #include "profile/profiler_macro.hpp"
@@ -18,38 +21,153 @@ using event_span = util::range<const spike_event*>;
 void tree_merge_events(std::vector<event_span>& sources, pse_vector& out);
 
 namespace impl {
-    // The tournament tree is used internally by the merge_events method, and
-    // it is not intended for use elsewhere. It is exposed here for unit testing
-    // of its functionality.
-    class tourney_tree {
-        using key_val = std::pair<unsigned, spike_event>;
+    // The tournament tree is used internally by the merge_events method and
+    // to merge the event lanes of cells that share an integration domain.
+    // It is exposed here for unit testing of its functionality.
+    //
+    // The tree merges k sorted lists of events of type E, which must have a
+    // `time` member and be ordered by operator<. The sentinel event
+    // `terminal`, with time terminal_time, marks exhausted lists.
+    //
+    // The tree maintains a heap-like data structure, with entries of type:
+    //      std::pair<unsigned, E>
+    // where the unsigned ∈ [0, k-1] is the id of the list from which the event
+    // was drawn. The id is stored so that the operation of removing the most
+    // recent event knows which leaf node needs to be updated (i.e. the leaf
+    // node of the list from which the most recent event was drawn).
+    //
+    // unsigned is used for storing the index, because if drawing events from
+    // more event generators than can be counted using an unsigned a complete
+    // redesign will be needed.
+    template <typename E>
+    class basic_tourney_tree {
+        using key_val = std::pair<unsigned, E>;
+        using span_type = util::range<const E*>;
 
     public:
-        tourney_tree(std::vector<event_span>& input);
-        bool empty() const;
-        spike_event head() const;
-        void pop();
-        friend std::ostream& operator<<(std::ostream&, const tourney_tree&);
+        // Construct an empty tree, to be filled by reset().
+        explicit basic_tourney_tree(E terminal): terminal_(terminal) {}
+
+        basic_tourney_tree(std::vector<span_type>& input, E terminal):
+            terminal_(terminal)
+        {
+            reset(input);
+        }
+
+        // Rebuild the tree to merge the lists in input, reusing the tree
+        // storage. The input is updated as events are popped, and must
+        // outlive the tree or the next call to reset.
+        void reset(std::vector<span_type>& input) {
+            input_ = &input;
+            n_lanes_ = input.size();
+
+            // Must have at least 1 queue.
+            arb_assert(n_lanes_>=1u);
+
+            leaves_ = math::next_pow2(n_lanes_);
+
+            // Must be able to fit leaves in unsigned count.
+            arb_assert(leaves_>=n_lanes_);
+            nodes_ = 2*leaves_-1;
+
+            // Allocate space for the tree nodes
+            heap_.resize(nodes_);
+            // Set the leaf nodes
+            for (auto i=0u; i<leaves_; ++i) {
+                heap_[leaf(i)] = i<n_lanes_?
+                    key_val(i, input[i].empty()? terminal_: input[i].front()):
+                    key_val(i, terminal_); // null leaf node
+            }
+            // Walk the tree to initialize the non-leaf nodes
+            setup(0);
+        }
+
+        bool empty() const {
+            return event(0).time == terminal_time;
+        }
+
+        E head() const {
+            return event(0);
+        }
+
+        // Remove the smallest (most recent) event from the tree, then update
+        // the tree so that head() returns the next event.
+        void pop() {
+            unsigned lane = id(0);
+            unsigned i = leaf(lane);
+
+            // draw the next event from the input lane
+            auto& in = (*input_)[lane];
+
+            if (!in.empty()) {
+                ++in.left;
+            }
+
+            event(i) = in.empty()? terminal_: in.front();
+
+            // re-heapify the tree with a single walk from leaf to root
+            while ((i=parent(i))) {
+                merge_up(i);
+            }
+            merge_up(0); // handle the root
+        }
+
+        friend std::ostream& operator<<(std::ostream& out, const basic_tourney_tree& tt) {
+            unsigned nxt = 1;
+            for (unsigned i = 0; i<tt.nodes_; ++i) {
+                if (i==nxt-1) {
+                    nxt*=2;
+                    out << "\n";
+                }
+                out << "{" << tt.heap_[i].first << "," << tt.heap_[i].second << "}\n";
+            }
+            return out;
+        }
 
     private:
-        void setup(unsigned i);
-        void merge_up(unsigned i);
-        void update_lane(unsigned lane);
-        unsigned parent(unsigned i) const;
-        unsigned left(unsigned i) const;
-        unsigned right(unsigned i) const;
-        unsigned leaf(unsigned i) const;
-        bool is_leaf(unsigned i) const;
-        const unsigned& id(unsigned i) const;
-        spike_event& event(unsigned i);
-        const spike_event& event(unsigned i) const;
-        unsigned next_power_2(unsigned x) const;
+        void setup(unsigned i) {
+            if (is_leaf(i)) return;
+            setup(left(i));
+            setup(right(i));
+            merge_up(i);
+        }
+
+        // Update the value at node i of the tree to be the smallest
+        // of its left and right children.
+        // The result is undefined for leaf nodes.
+        void merge_up(unsigned i) {
+            const auto l = left(i);
+            const auto r = right(i);
+            heap_[i] = event(l)<event(r)? heap_[l]: heap_[r];
+        }
+
+        // The tree is stored using the standard heap indexing scheme.
+        unsigned parent(unsigned i) const { return (i-1)>>1; }
+        unsigned left(unsigned i) const { return (i<<1) + 1; }
+        unsigned right(unsigned i) const { return left(i)+1; }
+        unsigned leaf(unsigned i) const { return i+leaves_-1; }
+        bool is_leaf(unsigned i) const { return i>=leaves_-1; }
+        const unsigned& id(unsigned i) const { return heap_[i].first; }
+        E& event(unsigned i) { return heap_[i].second; }
+        const E& event(unsigned i) const { return heap_[i].second; }
 
         std::vector<key_val> heap_;
-        std::vector<event_span>& input_;
-        unsigned leaves_;
-        unsigned nodes_;
-        unsigned n_lanes_;
+        std::vector<span_type>* input_ = nullptr;
+        E terminal_;
+        unsigned leaves_ = 0;
+        unsigned nodes_ = 0;
+        unsigned n_lanes_ = 0;
+    };
+
+    // A postsynaptic spike event that has delivery time set to
+    // terminal_time, used as a sentinel in `tourney_tree`.
+    static constexpr spike_event terminal_pse{cell_member_type{0,0}, terminal_time, 0};
+
+    class tourney_tree: public basic_tourney_tree<spike_event> {
+    public:
+        tourney_tree(std::vector<event_span>& input):
+            basic_tourney_tree<spike_event>(input, terminal_pse)
+        {}
     };
 }
 
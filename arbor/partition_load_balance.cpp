@@ -1,49 +1,289 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 #include <queue>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <arbor/cable_cell.hpp>
 #include <arbor/domain_decomposition.hpp>
 #include <arbor/load_balance.hpp>
+#include <arbor/profile/timer.hpp>
 #include <arbor/recipe.hpp>
 #include <arbor/symmetric_recipe.hpp>
 #include <arbor/context.hpp>
 
+#include "builtin_mechanisms.hpp"
+#include "cell_group.hpp"
 #include "cell_group_factory.hpp"
+#include "communication/gathered_vector.hpp"
 #include "execution_context.hpp"
+#include "fvm_layout.hpp"
 #include "gpu_context.hpp"
+#include "threading/threading.hpp"
 #include "util/maputil.hpp"
 #include "util/partition.hpp"
+#include "util/rangeutil.hpp"
 #include "util/span.hpp"
 #include "util/strprintf.hpp"
 
 namespace arb {
 
-domain_decomposition partition_load_balance(
+cell_cost_function make_cell_cost_estimator(const recipe& rec, cable_cell_cost_model model) {
+    return [&rec, model = std::move(model)](cell_gid_type gid) -> double {
+        if (rec.get_cell_kind(gid)!=cell_kind::cable) {
+            return 1.;
+        }
+
+        std::vector<cable_cell> cells;
+        try {
+            cells.push_back(util::any_cast<cable_cell>(rec.get_cell_description(gid)));
+        }
+        catch (util::bad_any_cast&) {
+            throw bad_cell_description(cell_kind::cable, gid);
+        }
+
+        cable_cell_global_properties gprop;
+        try {
+            util::any rec_props = rec.get_global_properties(cell_kind::cable);
+            if (rec_props.has_value()) {
+                gprop = util::any_cast<cable_cell_global_properties>(rec_props);
+            }
+        }
+        catch (util::bad_any_cast&) {
+            throw bad_global_property(cell_kind::cable);
+        }
+        check_global_properties(gprop);
+
+        fvm_discretization D = fvm_discretize(cells, gprop.default_parameters);
+        fvm_mechanism_data M = fvm_build_mechanism_data(gprop, cells, D);
+
+        double cost = model.cv_cost*D.ncv + model.target_cost*M.ntarget;
+        for (auto& entry: M.mechanisms) {
+            const std::string& name = entry.first;
+
+            double weight;
+            if (auto w = util::value_by_key(model.mechanism_weight, name)) {
+                weight = *w;
+            }
+            else {
+                auto cat = builtin_mechanisms().has(name)? &builtin_mechanisms(): gprop.catalogue;
+                weight = 1+(*cat)[name].state.size();
+            }
+            cost += model.instance_cost*weight*entry.second.cv.size();
+        }
+        return cost;
+    };
+}
+
+group_size_tuning tune_cpu_group_size(
     const recipe& rec,
     const context& ctx,
-    partition_hint_map hint_map)
+    cell_kind k,
+    const std::vector<cell_gid_type>& sample,
+    unsigned steps,
+    time_type dt)
 {
-    const bool gpu_avail = ctx->gpu->has_gpu();
+    group_size_tuning result{k, 1, {}};
+    if (sample.empty() || !steps) {
+        return result;
+    }
+
+    auto factory = cell_kind_implementation(k, backend_kind::multicore, *ctx);
+    if (!factory) {
+        throw arbor_exception(util::pprintf("unable to tune cell group size: no multicore implementation for {}", k));
+    }
+
+    const std::size_t n = sample.size();
+    std::vector<pse_vector> lanes(n);
+
+    std::vector<std::size_t> sizes;
+    for (std::size_t size = 1; size<n; size *= 2) {
+        sizes.push_back(size);
+    }
+    sizes.push_back(n);
+
+    double best = -1;
+    for (auto size: sizes) {
+        std::vector<cell_group_ptr> groups;
+        std::vector<std::pair<cell_size_type, cell_size_type>> lane_ranges;
+        for (std::size_t first = 0; first<n; first += size) {
+            std::size_t last = std::min(first+size, n);
+            groups.push_back(factory(std::vector<cell_gid_type>(sample.begin()+first, sample.begin()+last), rec));
+            lane_ranges.push_back({first, last});
+        }
 
-    struct partition_gid_domain {
-        partition_gid_domain(gathered_vector<cell_gid_type> divs, unsigned domains):
-            gids_by_rank(std::move(divs)), num_domains(domains)
-        {}
-
-        int operator()(cell_gid_type gid) const {
-            using namespace util;
-            auto rank_part = partition_view(gids_by_rank.partition());
-            for (auto i: count_along(rank_part)) {
-                if (binary_search_index(subrange_view(gids_by_rank.values(), rank_part[i]), gid)) {
-                    return i;
+        auto advance_all = [&](epoch ep) {
+            threading::parallel_for::apply(0, groups.size(), ctx->thread_pool.get(),
+                [&](int i) {
+                    groups[i]->advance(ep, dt, util::subrange_view(lanes, lane_ranges[i]), {});
+                    groups[i]->clear_spikes();
+                });
+        };
+
+        advance_all(epoch(0, dt));
+
+        auto t0 = profile::timer<>::tic();
+        advance_all(epoch(1, dt*(1+steps)));
+        double elapsed = profile::timer<>::toc(t0);
+
+        double throughput = elapsed>0? n*steps/elapsed: 0;
+        result.trials.push_back({size, throughput});
+        if (throughput>best) {
+            best = throughput;
+            result.group_size = size;
+        }
+    }
+
+    return result;
+}
+
+namespace {
+
+// Split the gid range into one contiguous range per domain such that each
+// range has approximately the same total cost. The costs are known only in
+// aggregate for each block of the equal-count partition count_divs, and are
+// taken to be uniform within a block, so that every domain computes the same
+// divisions from the gathered block costs.
+std::vector<cell_gid_type> weighted_gid_divisions(
+    const std::vector<cell_gid_type>& count_divs,
+    const std::vector<double>& block_cost)
+{
+    const unsigned nblock = block_cost.size();
+    const double total = std::accumulate(block_cost.begin(), block_cost.end(), 0.);
+    if (!(total>0)) {
+        return count_divs;
+    }
+
+    std::vector<cell_gid_type> divs(nblock+1);
+    divs[0] = count_divs.front();
+    divs[nblock] = count_divs.back();
+
+    unsigned b = 0;
+    double cost_before = 0; // Total cost of blocks preceding block b.
+    for (unsigned d = 1; d<nblock; ++d) {
+        const double target = total*d/nblock;
+        while (b+1<nblock && cost_before+block_cost[b]<target) {
+            cost_before += block_cost[b++];
+        }
+
+        double frac = block_cost[b]>0? (target-cost_before)/block_cost[b]: 0;
+        frac = std::min(1., std::max(0., frac));
+
+        auto n = count_divs[b+1]-count_divs[b];
+        cell_gid_type g = count_divs[b] + (cell_gid_type)std::lround(frac*n);
+        divs[d] = std::max(divs[d-1], g);
+    }
+    return divs;
+}
+
+// Distribute weighted items over at most n_groups groups, longest processing
+// time first: items are taken in order of decreasing cost and assigned to the
+// group with the least total cost. Returns the item indices of each non-empty
+// group, sorted, with groups ordered by their first item.
+std::vector<std::vector<unsigned>> balance_items(const std::vector<double>& item_cost, std::size_t n_groups) {
+    const unsigned n_items = item_cost.size();
+    n_groups = std::max<std::size_t>(1, std::min<std::size_t>(n_groups, n_items));
+
+    std::vector<unsigned> order(n_items);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(),
+        [&](unsigned a, unsigned b) { return item_cost[a]>item_cost[b]; });
+
+    using load = std::pair<double, unsigned>; // (total cost, group index)
+    std::priority_queue<load, std::vector<load>, std::greater<load>> least;
+    for (unsigned i = 0; i<n_groups; ++i) {
+        least.push({0., i});
+    }
+
+    std::vector<std::vector<unsigned>> groups(n_groups);
+    for (auto i: order) {
+        auto top = least.top();
+        least.pop();
+        groups[top.second].push_back(i);
+        least.push({top.first+item_cost[i], top.second});
+    }
+
+    groups.erase(std::remove_if(groups.begin(), groups.end(),
+            [](auto& g) { return g.empty(); }), groups.end());
+    for (auto& g: groups) {
+        util::sort(g);
+    }
+    util::sort_by(groups, [](auto& g) { return g.front(); });
+    return groups;
+}
+
+// Map from gid to domain, stored as the sorted first gids of maximal runs of
+// consecutive gids that are assigned to the same domain. When each domain
+// is assigned a contiguous gid range there is one run per domain; gids
+// assigned outside the range of their domain (members of gap junction
+// super cells) add at most two runs each. Lookup is a binary search over
+// the runs, and gids outside the model map to -1.
+struct partition_gid_domain {
+    // gid_divisions partitions the gids into one contiguous range per domain;
+    // exceptions holds, for each domain, the gids assigned to it that lie
+    // outside its range.
+    partition_gid_domain(
+        const std::vector<cell_gid_type>& gid_divisions,
+        const gathered_vector<cell_gid_type>& exceptions)
+    {
+        std::vector<std::pair<cell_gid_type, int>> reassigned;
+        reassigned.reserve(exceptions.values().size());
+
+        const auto& exc_part = exceptions.partition();
+        for (unsigned dom = 0; dom+1<exc_part.size(); ++dom) {
+            for (auto i = exc_part[dom]; i<exc_part[dom+1]; ++i) {
+                reassigned.push_back({exceptions.values()[i], (int)dom});
+            }
+        }
+        util::sort(reassigned);
+
+        auto add_run = [this](cell_gid_type first, int dom) {
+            if (domains.empty() || domains.back()!=dom) {
+                run_first.push_back(first);
+                domains.push_back(dom);
+            }
+        };
+
+        auto e = reassigned.begin();
+        const int n_dom = gid_divisions.size()-1;
+        for (int dom = 0; dom<n_dom; ++dom) {
+            const cell_gid_type hi = gid_divisions[dom+1];
+            for (cell_gid_type gid = gid_divisions[dom]; gid<hi;) {
+                if (e!=reassigned.end() && e->first==gid) {
+                    add_run(gid, e->second);
+                    ++gid;
+                    ++e;
+                }
+                else {
+                    add_run(gid, dom);
+                    gid = e!=reassigned.end() && e->first<hi? e->first: hi;
                 }
             }
-            return -1;
         }
 
-        const gathered_vector<cell_gid_type> gids_by_rank;
-        unsigned num_domains;
-    };
+        // Sentinel run for gids past the end of the model.
+        run_first.push_back(gid_divisions.back());
+        domains.push_back(-1);
+    }
+
+    int operator()(cell_gid_type gid) const {
+        auto it = std::upper_bound(run_first.begin(), run_first.end(), gid);
+        return it==run_first.begin()? -1: domains[it-run_first.begin()-1];
+    }
+
+    std::vector<cell_gid_type> run_first;
+    std::vector<int> domains;
+};
+
+domain_decomposition partition_load_balance_impl(
+    const recipe& rec,
+    const context& ctx,
+    const cell_cost_function* cost,
+    partition_hint_map hint_map)
+{
+    const bool gpu_avail = ctx->gpu->has_gpu();
 
     struct cell_identifier {
         cell_gid_type id;
@@ -68,6 +308,24 @@ domain_decomposition partition_load_balance(
     auto gid_part = make_partition(
         gid_divisions, transform_view(make_span(num_domains), dom_size));
 
+    // Cost of local cells; when weighting, the domain boundaries are moved
+    // so that each domain receives an equal share of the estimated cost.
+    std::unordered_map<cell_gid_type, double> cell_cost;
+    auto cost_of = [&](cell_gid_type gid) {
+        auto it = cell_cost.find(gid);
+        return it!=cell_cost.end()? it->second: cell_cost[gid] = (*cost)(gid);
+    };
+
+    if (cost) {
+        double local_cost = 0;
+        for (auto gid: make_span(gid_part[domain_id])) {
+            local_cost += cost_of(gid);
+        }
+
+        gid_divisions = weighted_gid_divisions(gid_divisions, ctx->distributed->gather_all(local_cost));
+        gid_part = util::partition_view(gid_divisions);
+    }
+
     // Local load balance
 
     std::vector<std::vector<cell_gid_type>> super_cells; //cells connected by gj
@@ -76,10 +334,16 @@ domain_decomposition partition_load_balance(
     // Map to track visited cells (cells that already belong to a group)
     std::unordered_set<cell_gid_type> visited;
 
+    // Cells of kinds whose components may be split are placed independently.
+    auto split_components = [&](cell_gid_type gid) {
+        auto hint = util::value_by_key(hint_map, rec.get_cell_kind(gid));
+        return hint && hint->split_gap_junctions;
+    };
+
     // Connected components algorithm using BFS
     std::queue<cell_gid_type> q;
     for (auto gid: make_span(gid_part[domain_id])) {
-        if (!rec.gap_junctions_on(gid).empty()) {
+        if (!rec.gap_junctions_on(gid).empty() && !split_components(gid)) {
             // If cell hasn't been visited yet, must belong to new super_cell
             // Perform BFS starting from that cell
             if (!visited.count(gid)) {
@@ -186,6 +450,58 @@ domain_decomposition partition_load_balance(
             backend = backend_kind::gpu;
             group_size = hint.gpu_group_size;
         }
+        else if (hint.tune_cpu_group_size) {
+            // Sample the first cells of this kind that have no gap junctions.
+            const std::size_t max_sample = 64;
+            std::vector<cell_gid_type> sample;
+            for (auto cell: kind_lists[k]) {
+                if (sample.size()==max_sample) break;
+                if (!cell.is_super_cell) {
+                    sample.push_back(cell.id);
+                }
+            }
+
+            if (!sample.empty()) {
+                auto tuning = tune_cpu_group_size(rec, ctx, k, sample);
+                group_size = tuning.group_size;
+                if (hint.tuning_report) {
+                    hint.tuning_report(tuning);
+                }
+            }
+        }
+
+        if (cost) {
+            // Balance the cost of cells and super cells over the groups.
+            const auto& cell_list = kind_lists[k];
+            std::size_t n_cells = 0;
+            std::vector<double> item_cost;
+            for (auto cell: cell_list) {
+                if (cell.is_super_cell) {
+                    n_cells += super_cells[cell.id].size();
+                    item_cost.push_back(util::sum_by(super_cells[cell.id], cost_of));
+                }
+                else {
+                    ++n_cells;
+                    item_cost.push_back(cost_of(cell.id));
+                }
+            }
+
+            std::size_t n_groups = n_cells/group_size + (n_cells%group_size!=0);
+            for (auto& items: balance_items(item_cost, n_groups)) {
+                std::vector<cell_gid_type> group_elements;
+                for (auto i: items) {
+                    auto cell = cell_list[i];
+                    if (cell.is_super_cell) {
+                        util::append(group_elements, super_cells[cell.id]);
+                    }
+                    else {
+                        group_elements.push_back(cell.id);
+                    }
+                }
+                groups.push_back({k, std::move(group_elements), backend});
+            }
+            continue;
+        }
 
         std::vector<cell_gid_type> group_elements;
         // group_elements are sorted such that the gids of all members of a super_cell are consecutive.
@@ -213,12 +529,19 @@ domain_decomposition partition_load_balance(
 
     cell_size_type num_local_cells = local_gids.size();
 
-    // Exchange gid list with all other nodes
+    // Local gids outside the gid range of this domain are members of super
+    // cells that straddle a domain boundary. Only these need to be exchanged
+    // for every domain to be able to compute the domain of any gid.
 
-    util::sort(local_gids);
+    std::vector<cell_gid_type> reassigned_gids;
+    auto local_range = gid_part[domain_id];
+    for (auto gid: local_gids) {
+        if (gid<local_range.first || gid>=local_range.second) {
+            reassigned_gids.push_back(gid);
+        }
+    }
 
-    // global all-to-all to gather a local copy of the global gid list on each node.
-    auto global_gids = ctx->distributed->gather_gids(local_gids);
+    auto global_reassigned = ctx->distributed->gather_gids(reassigned_gids);
 
     domain_decomposition d;
     d.num_domains = num_domains;
@@ -226,10 +549,29 @@ domain_decomposition partition_load_balance(
     d.num_local_cells = num_local_cells;
     d.num_global_cells = num_global_cells;
     d.groups = std::move(groups);
-    d.gid_domain = partition_gid_domain(std::move(global_gids), num_domains);
+    d.gid_domain = partition_gid_domain(gid_divisions, global_reassigned);
 
     return d;
 }
 
+} // anonymous namespace
+
+domain_decomposition partition_load_balance(
+    const recipe& rec,
+    const context& ctx,
+    partition_hint_map hint_map)
+{
+    return partition_load_balance_impl(rec, ctx, nullptr, std::move(hint_map));
+}
+
+domain_decomposition partition_load_balance(
+    const recipe& rec,
+    const context& ctx,
+    const cell_cost_function& cost,
+    partition_hint_map hint_map)
+{
+    return partition_load_balance_impl(rec, ctx, &cost, std::move(hint_map));
+}
+
 } // namespace arb
 
@@ -5,6 +5,7 @@
  * cell group classes (see sampling_api doc).
  */
 
+#include <cstddef>
 #include <functional>
 #include <mutex>
 #include <unordered_map>
@@ -20,10 +21,22 @@ namespace arb {
 // An association between a samplers, schedule, and set of probe ids, as provided
 // to e.g. `model::add_sampler()`.
 
+// Exactly one of sampler and bulk_sampler is set. A reduction applies only
+// to bulk samplers.
+
 struct sampler_association {
     schedule sched;
     sampler_function sampler;
     std::vector<cell_member_type> probe_ids;
+    bulk_sampler_function bulk_sampler;
+    sample_reduction reduction;
+
+    // Reduction windows may span epochs: the number of samples taken so far
+    // in the current window, and for each probe the time and partially
+    // reduced value of the window.
+    unsigned window_count = 0;
+    std::vector<double> window_time;
+    std::vector<double> window_value;
 };
 
 // Maintain a set of associations paired with handles used for deletion.
@@ -45,10 +58,24 @@ public:
         map_.clear();
     }
 
+    // The association with handle h, or null if there is none.
+    sampler_association* find(sampler_association_handle h) {
+        std::lock_guard<std::mutex> lock(m_);
+        auto i = map_.find(h);
+        return i==map_.end()? nullptr: &i->second;
+    }
+
+    // Call f(h, assoc) for each handle and association.
+    template <typename F>
+    void for_each(F&& f) const {
+        std::lock_guard<std::mutex> lock(m_);
+        for (auto& p: map_) f(p.first, p.second);
+    }
+
 private:
     using assoc_map = std::unordered_map<sampler_association_handle, sampler_association>;
     assoc_map map_;
-    std::mutex m_;
+    mutable std::mutex m_;
 
     static sampler_association& second(assoc_map::value_type& p) { return p.second; }
     auto assoc_view() { return util::transform_view(map_, &sampler_association_map::second); }
@@ -67,6 +94,8 @@ struct probe_association {
     using probe_handle_type = Handle;
     probe_handle_type handle;
     probe_tag tag;
+    std::size_t width = 1; // number of contiguous values sampled from handle
+    bool whole_cell = false; // if true, samples are ranges of width values
 };
 
 template <typename Handle>
@@ -1,25 +1,39 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <numeric>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
+#include <arbor/cable_cell.hpp>
 #include <arbor/context.hpp>
 #include <arbor/domain_decomposition.hpp>
 #include <arbor/generic_event.hpp>
+#include <arbor/profile/timer.hpp>
 #include <arbor/recipe.hpp>
 #include <arbor/schedule.hpp>
 #include <arbor/simulation.hpp>
+#include <arbor/util/any_ptr.hpp>
 
 #include "cell_group.hpp"
 #include "cell_group_factory.hpp"
 #include "communication/communicator.hpp"
+#include "communication/gap_junction_halo.hpp"
 #include "execution_context.hpp"
 #include "merge_events.hpp"
 #include "thread_private_spike_store.hpp"
+#include "threading/callback_queue.hpp"
 #include "threading/threading.hpp"
+#include "util/bytes.hpp"
 #include "util/double_buffer.hpp"
 #include "util/filter.hpp"
 #include "util/maputil.hpp"
 #include "util/partition.hpp"
+#include "util/rangeutil.hpp"
 #include "util/span.hpp"
 #include "profile/profiler_macro.hpp"
 
@@ -60,6 +74,10 @@ public:
     sampler_association_handle add_sampler(cell_member_predicate probe_ids,
         schedule sched, sampler_function f, sampling_policy policy = sampling_policy::lax);
 
+    sampler_association_handle add_sampler(cell_member_predicate probe_ids,
+        schedule sched, bulk_sampler_function f, sample_reduction reduction,
+        sampling_policy policy = sampling_policy::lax);
+
     void remove_sampler(sampler_association_handle);
 
     void remove_all_samplers();
@@ -72,6 +90,38 @@ public:
 
     void inject_events(const pse_vector& events);
 
+    const std::vector<double>& group_advance_times() const {
+        return group_time_;
+    }
+
+    double active_fraction() const {
+        cell_group_activity total;
+        for (auto& group: cell_groups_) {
+            auto a = group->activity();
+            total.advanced += a.advanced;
+            total.integrated += a.integrated;
+        }
+        return total.advanced? double(total.integrated)/total.advanced: 1.;
+    }
+
+    void rebalance(const recipe& rec);
+
+    void set_async_callbacks(std::size_t max_pending);
+
+    void set_gap_junction_interval(time_type interval) {
+        gj_interval_ = interval;
+    }
+
+    void set_resolved_targets(bool enable) {
+        resolved_targets_ = enable;
+        if (enable) {
+            communicator_.resolve_targets(cell_groups_);
+        }
+        else {
+            communicator_.clear_targets();
+        }
+    }
+
     spike_export_function global_export_callback_;
     spike_export_function local_export_callback_;
 
@@ -84,6 +134,14 @@ private:
         return event_lanes_[epoch_id%2];
     }
 
+    std::vector<resolved_event_lane>& resolved_lanes(std::size_t epoch_id) {
+        return resolved_lanes_[epoch_id%2];
+    }
+
+    // Cell groups moved to this rank by rebalance are built with the
+    // execution context of the simulation.
+    execution_context context_;
+
     // keep track of information about the current integration interval
     epoch epoch_;
 
@@ -91,6 +149,15 @@ private:
     time_type min_delay_;
     std::vector<cell_group_ptr> cell_groups_;
 
+    // Kind, back end and cells of each local cell group.
+    std::vector<group_description> groups_;
+
+    // Wall-clock time [s] spent advancing each cell group since construction,
+    // reset or the last rebalance, and the order in which the groups are
+    // dispatched to the task system.
+    std::vector<double> group_time_;
+    std::vector<cell_size_type> group_order_;
+
     // one set of event_generators for each local cell
     std::vector<std::vector<event_generator>> event_generators_;
 
@@ -101,15 +168,39 @@ private:
 
     communicator communicator_;
 
+    // Voltages of gap junctions between cell groups are exchanged at the
+    // start of each epoch, and epochs last at most gj_interval_, or one
+    // time step if zero.
+    distributed_context_handle distributed_;
+    gap_junction_halo gj_halo_;
+    time_type gj_interval_ = 0;
+
     task_system_handle task_system_;
 
     // Pending events to be delivered.
     std::array<std::vector<pse_vector>, 2> event_lanes_;
     std::vector<pse_vector> pending_events_;
 
+    // Pending events of connections whose targets were resolved by the
+    // communicator, to be delivered without lookup by their cell groups;
+    // empty unless resolved_targets_ is set.
+    bool resolved_targets_ = false;
+    std::array<std::vector<resolved_event_lane>, 2> resolved_lanes_;
+    std::vector<resolved_event_lane> pending_resolved_;
+
     // Sampler associations handles are managed by a helper class.
     util::handle_set<sampler_association_handle> sassoc_handles_;
 
+    // Sampler associations and binning policy, which are applied to cell
+    // groups moved to this rank by rebalance.
+    std::map<sampler_association_handle, std::function<void (cell_group&, time_type)>> samplers_;
+    binning_kind binning_policy_ = binning_kind::none;
+    time_type bin_interval_ = 0;
+
+    // Queue for sampler and spike callbacks that run concurrently with
+    // integration; null if callbacks are run synchronously.
+    std::unique_ptr<threading::callback_queue> callbacks_;
+
     // Apply a functional to each cell group in parallel.
     template <typename L>
     void foreach_group(L&& fn) {
@@ -133,7 +224,9 @@ simulation_state::simulation_state(
     ):
     local_spikes_(new spike_double_buffer(thread_private_spike_store(ctx.thread_pool),
                                           thread_private_spike_store(ctx.thread_pool))),
+    context_(ctx),
     communicator_(rec, decomp, ctx),
+    distributed_(ctx.distributed),
     task_system_(ctx.thread_pool)
 {
     const auto num_local_cells = communicator_.num_local_cells();
@@ -143,6 +236,7 @@ simulation_state::simulation_state(
 
     // Initialize empty buffers for pending events for each local cell
     pending_events_.resize(num_local_cells);
+    pending_resolved_.resize(num_local_cells);
 
     event_generators_.resize(num_local_cells);
     cell_local_size_type lidx = 0;
@@ -158,6 +252,7 @@ simulation_state::simulation_state(
     }
 
     // Generate the cell groups in parallel, with one task per cell group.
+    groups_ = decomp.groups;
     cell_groups_.resize(decomp.groups.size());
     foreach_group_index(
         [&](cell_group_ptr& group, int i) {
@@ -166,26 +261,45 @@ simulation_state::simulation_state(
             group = factory(group_info.gids, rec);
         });
 
+    gj_halo_ = gap_junction_halo(cell_groups_, *distributed_);
+
+    group_time_.assign(cell_groups_.size(), 0.);
+    group_order_.resize(cell_groups_.size());
+    std::iota(group_order_.begin(), group_order_.end(), 0);
+
     // Create event lane buffers.
     // There is one set for each epoch: current (0) and next (1).
     // For each epoch there is one lane for each cell in the cell group.
     event_lanes_[0].resize(num_local_cells);
     event_lanes_[1].resize(num_local_cells);
+    resolved_lanes_[0].resize(num_local_cells);
+    resolved_lanes_[1].resize(num_local_cells);
 }
 
 void simulation_state::reset() {
+    if (callbacks_) {
+        callbacks_->wait();
+    }
+
     t_ = 0.;
 
     // Reset cell group state.
     foreach_group(
         [](cell_group_ptr& group) { group->reset(); });
 
+    util::fill(group_time_, 0.);
+
     // Clear all pending events in the event lanes.
     for (auto& lanes: event_lanes_) {
         for (auto& lane: lanes) {
             lane.clear();
         }
     }
+    for (auto& lanes: resolved_lanes_) {
+        for (auto& lane: lanes) {
+            lane.clear();
+        }
+    }
 
     // Reset all event generators.
     for (auto& lane: event_generators_) {
@@ -197,6 +311,9 @@ void simulation_state::reset() {
     for (auto& lane: pending_events_) {
         lane.clear();
     }
+    for (auto& lane: pending_resolved_) {
+        lane.clear();
+    }
 
     communicator_.reset();
 
@@ -210,14 +327,28 @@ time_type simulation_state::run(time_type tfinal, time_type dt) {
     // If spike exchange and cell update are serialized, this is the
     // minimum delay of the network, however we use half this period
     // to overlap communication and computation.
-    const time_type t_interval = min_delay_/2;
+    time_type t_interval = min_delay_/2;
 
-    // task that updates cell state in parallel.
+    // Gap junctions between cell groups couple the groups through voltages
+    // that are held fixed over an epoch.
+    if (!gj_halo_.empty()) {
+        t_interval = std::min(t_interval, gj_interval_>0? gj_interval_: dt);
+    }
+
+    // task that updates cell state in parallel, dispatching groups in the
+    // order given by group_order_.
     auto update_cells = [&] () {
-        foreach_group_index(
-            [&](cell_group_ptr& group, int i) {
-                auto queues = util::subrange_view(event_lanes(epoch_.id), communicator_.group_queue_range(i));
-                group->advance(epoch_, dt, queues);
+        threading::parallel_for::apply(0, cell_groups_.size(), task_system_.get(),
+            [&](int k) {
+                auto i = group_order_[k];
+                auto& group = cell_groups_[i];
+                auto lanes = communicator_.group_queue_range(i);
+                auto queues = util::subrange_view(event_lanes(epoch_.id), lanes);
+                auto resolved = util::subrange_view(resolved_lanes(epoch_.id), lanes);
+
+                auto t0 = profile::timer<>::tic();
+                group->advance(epoch_, dt, queues, resolved);
+                group_time_[i] += profile::timer<>::toc(t0);
 
                 PE(advance_spikes);
                 local_spikes_->current().insert(group->spikes());
@@ -237,16 +368,27 @@ time_type simulation_state::run(time_type tfinal, time_type dt) {
         auto global_spikes = communicator_.exchange(local_spikes);
 
         PE(communication_spikeio);
-        if (local_export_callback_) {
-            local_export_callback_(local_spikes);
+        if (callbacks_) {
+            // The callbacks are passed copies of the spike vectors.
+            if (local_export_callback_) {
+                callbacks_->push([f = local_export_callback_, spikes = local_spikes]() { f(spikes); });
+            }
+            if (global_export_callback_) {
+                callbacks_->push([f = global_export_callback_, spikes = global_spikes.values()]() { f(spikes); });
+            }
         }
-        if (global_export_callback_) {
-            global_export_callback_(global_spikes.values());
+        else {
+            if (local_export_callback_) {
+                local_export_callback_(local_spikes);
+            }
+            if (global_export_callback_) {
+                global_export_callback_(global_spikes.values());
+            }
         }
         PL();
 
         PE(communication_walkspikes);
-        communicator_.make_event_queues(global_spikes, pending_events_);
+        communicator_.make_event_queues(global_spikes, pending_events_, pending_resolved_);
         PL();
 
         const auto t0 = epoch_.tfinal;
@@ -264,6 +406,8 @@ time_type simulation_state::run(time_type tfinal, time_type dt) {
         // these buffers will store the new spikes generated in update_cells.
         local_spikes_->current().clear();
 
+        gj_halo_.exchange(cell_groups_, *distributed_);
+
         // run the tasks, overlapping if the threading model and number of
         // available threads permits it.
         threading::task_group g(task_system_.get());
@@ -281,9 +425,298 @@ time_type simulation_state::run(time_type tfinal, time_type dt) {
     local_spikes_->exchange();
     exchange();
 
+    // The spikes in both buffers have now been exchanged, and must not be
+    // exchanged again by the next run, e.g. after rebalance has moved their
+    // source cells to another rank.
+    local_spikes_->current().clear();
+    local_spikes_->previous().clear();
+
+    // Callbacks for this run complete before returning.
+    if (callbacks_) {
+        callbacks_->wait();
+    }
+
     return t_;
 }
 
+namespace {
+// Measured cost of a cell group, as exchanged between ranks by rebalance.
+struct group_cost {
+    double time;
+    bool pinned;
+};
+
+// A cell group moved from the rank `from` to the rank `to`.
+struct group_move {
+    int from;
+    int to;
+    cell_size_type index;
+};
+
+// Plan the moves of cell groups between ranks. Repeatedly move the group of
+// the most loaded rank that best halves the difference to the least loaded
+// rank, while that reduces the imbalance. Every rank computes the same plan
+// from the same costs; groups are moved at most once.
+std::vector<group_move> plan_moves(const std::vector<std::vector<group_cost>>& costs) {
+    const int n_rank = costs.size();
+
+    std::vector<double> load(n_rank, 0.);
+    std::vector<std::vector<char>> moved(n_rank);
+    for (int r = 0; r<n_rank; ++r) {
+        for (auto& c: costs[r]) {
+            load[r] += c.time;
+        }
+        moved[r].assign(costs[r].size(), 0);
+    }
+
+    std::vector<group_move> moves;
+    while (true) {
+        int hi = std::max_element(load.begin(), load.end())-load.begin();
+        int lo = std::min_element(load.begin(), load.end())-load.begin();
+        const double gap = load[hi]-load[lo];
+
+        int best = -1;
+        double best_score = 0;
+        for (auto i: util::count_along(costs[hi])) {
+            auto& c = costs[hi][i];
+            if (moved[hi][i] || c.pinned || c.time<=0 || c.time>=gap) continue;
+
+            double score = std::abs(gap-2*c.time);
+            if (best<0 || score<best_score) {
+                best = i;
+                best_score = score;
+            }
+        }
+        if (best<0) break;
+
+        moved[hi][best] = 1;
+        load[hi] -= costs[hi][best].time;
+        load[lo] += costs[hi][best].time;
+        moves.push_back({hi, lo, cell_size_type(best)});
+    }
+    return moves;
+}
+
+// Fields of a group moved between ranks, as read from the gathered buffer.
+struct moved_group {
+    int to;
+    cell_kind kind;
+    backend_kind backend;
+    double time;
+    std::vector<cell_gid_type> gids;
+    std::vector<char> state;
+    std::vector<pse_vector> lanes[2];
+    std::vector<pse_vector> pending;
+    std::vector<resolved_event_lane> resolved[2];
+    std::vector<resolved_event_lane> pending_resolved;
+};
+} // anonymous namespace
+
+// Move cell groups from the most to the least loaded ranks, by measured
+// advance time, then dispatch the most expensive groups first, so that the
+// cheaper groups fill idle threads at the end of each epoch, and restart
+// the timing.
+//
+// Groups are moved with their state, their pending events and the state of
+// the event generators of their cells; samplers and the binning policy are
+// applied to the groups that arrive.
+void simulation_state::rebalance(const recipe& rec) {
+    if (callbacks_) {
+        callbacks_->wait();
+    }
+
+    const int rank = distributed_->id();
+    const int n_rank = distributed_->size();
+
+    std::vector<char> buf;
+    util::write_bytes(buf, std::uint64_t(cell_groups_.size()));
+    for (auto i: util::count_along(cell_groups_)) {
+        util::write_bytes(buf, group_cost{group_time_[i], groups_[i].backend==backend_kind::gpu});
+    }
+    std::vector<std::vector<group_cost>> costs(n_rank);
+    {
+        auto gathered = distributed_->gather_bytes(buf);
+        for (int r = 0; r<n_rank; ++r) {
+            const char* p = gathered.values().data()+gathered.partition()[r];
+            costs[r].resize(util::read_bytes<std::uint64_t>(p));
+            for (auto& c: costs[r]) {
+                util::read_bytes(p, c);
+            }
+        }
+    }
+    auto moves = plan_moves(costs);
+
+    if (!moves.empty()) {
+        // Serialize the groups leaving this rank.
+        std::vector<char> outgoing(cell_groups_.size(), 0);
+        buf.clear();
+        for (auto& m: moves) {
+            if (m.from!=rank) continue;
+
+            auto i = m.index;
+            outgoing[i] = 1;
+            util::write_bytes(buf, m.to);
+            util::write_bytes(buf, groups_[i].kind);
+            util::write_bytes(buf, groups_[i].backend);
+            util::write_bytes(buf, group_time_[i]);
+            util::write_bytes(buf, groups_[i].gids);
+
+            std::vector<char> state;
+            cell_groups_[i]->serialize(state);
+            util::write_bytes(buf, state);
+
+            auto lanes = communicator_.group_queue_range(i);
+            for (auto l: util::make_span(lanes)) {
+                util::write_bytes(buf, event_lanes_[0][l]);
+                util::write_bytes(buf, event_lanes_[1][l]);
+                util::write_bytes(buf, pending_events_[l]);
+                util::write_bytes(buf, resolved_lanes_[0][l]);
+                util::write_bytes(buf, resolved_lanes_[1][l]);
+                util::write_bytes(buf, pending_resolved_[l]);
+            }
+        }
+
+        // Every rank reads the gids of all moved groups, and keeps the
+        // groups moved to it.
+        std::vector<moved_group> incoming;
+        std::unordered_map<cell_gid_type, int> moved;
+        {
+            auto gathered = distributed_->gather_bytes(buf);
+            const char* p = gathered.values().data();
+            const char* end = p+gathered.values().size();
+            while (p!=end) {
+                moved_group g;
+                util::read_bytes(p, g.to);
+                util::read_bytes(p, g.kind);
+                util::read_bytes(p, g.backend);
+                util::read_bytes(p, g.time);
+                util::read_bytes(p, g.gids);
+                util::read_bytes(p, g.state);
+                const auto n = g.gids.size();
+                g.lanes[0].resize(n);
+                g.lanes[1].resize(n);
+                g.pending.resize(n);
+                g.resolved[0].resize(n);
+                g.resolved[1].resize(n);
+                g.pending_resolved.resize(n);
+                for (auto j: util::make_span(n)) {
+                    util::read_bytes(p, g.lanes[0][j]);
+                    util::read_bytes(p, g.lanes[1][j]);
+                    util::read_bytes(p, g.pending[j]);
+                    util::read_bytes(p, g.resolved[0][j]);
+                    util::read_bytes(p, g.resolved[1][j]);
+                    util::read_bytes(p, g.pending_resolved[j]);
+                    moved[g.gids[j]] = g.to;
+                }
+                if (g.to==rank) {
+                    incoming.push_back(std::move(g));
+                }
+            }
+        }
+
+        // Keep the groups that stay, in their order, followed by the
+        // groups that arrive.
+        std::vector<group_description> groups;
+        std::vector<cell_group_ptr> cell_groups;
+        std::vector<double> times;
+        std::array<std::vector<pse_vector>, 2> lanes;
+        std::vector<pse_vector> pending;
+        std::array<std::vector<resolved_event_lane>, 2> resolved;
+        std::vector<resolved_event_lane> pending_resolved;
+        std::vector<std::vector<event_generator>> generators;
+        for (auto i: util::count_along(cell_groups_)) {
+            if (outgoing[i]) continue;
+
+            groups.push_back(std::move(groups_[i]));
+            cell_groups.push_back(std::move(cell_groups_[i]));
+            times.push_back(group_time_[i]);
+            for (auto l: util::make_span(communicator_.group_queue_range(i))) {
+                lanes[0].push_back(std::move(event_lanes_[0][l]));
+                lanes[1].push_back(std::move(event_lanes_[1][l]));
+                pending.push_back(std::move(pending_events_[l]));
+                resolved[0].push_back(std::move(resolved_lanes_[0][l]));
+                resolved[1].push_back(std::move(resolved_lanes_[1][l]));
+                pending_resolved.push_back(std::move(pending_resolved_[l]));
+                generators.push_back(std::move(event_generators_[l]));
+            }
+        }
+
+        const auto n_kept = cell_groups.size();
+        cell_groups.resize(n_kept+incoming.size());
+        for (auto& g: incoming) {
+            groups.emplace_back(g.kind, g.gids, g.backend);
+            times.push_back(g.time);
+            for (auto j: util::count_along(g.gids)) {
+                lanes[0].push_back(std::move(g.lanes[0][j]));
+                lanes[1].push_back(std::move(g.lanes[1][j]));
+                pending.push_back(std::move(g.pending[j]));
+                resolved[0].push_back(std::move(g.resolved[0][j]));
+                resolved[1].push_back(std::move(g.resolved[1][j]));
+                pending_resolved.push_back(std::move(g.pending_resolved[j]));
+
+                // Advance the generators to the time of the simulation.
+                generators.push_back(rec.event_generators(g.gids[j]));
+                for (auto& gen: generators.back()) {
+                    gen.reset();
+                    gen.events(0, t_);
+                }
+            }
+        }
+
+        threading::parallel_for::apply(0, incoming.size(), task_system_.get(),
+            [&](int k) {
+                auto& g = incoming[k];
+                auto factory = cell_kind_implementation(g.kind, g.backend, context_);
+                auto& group = cell_groups[n_kept+k];
+                group = factory(g.gids, rec);
+                group->set_binning_policy(binning_policy_, bin_interval_);
+                for (auto& s: samplers_) {
+                    s.second(*group, t_);
+                }
+                const char* p = g.state.data();
+                group->deserialize(p);
+            });
+
+        groups_ = std::move(groups);
+        cell_groups_ = std::move(cell_groups);
+        group_time_ = std::move(times);
+        event_lanes_ = std::move(lanes);
+        pending_events_ = std::move(pending);
+        resolved_lanes_ = std::move(resolved);
+        pending_resolved_ = std::move(pending_resolved);
+        event_generators_ = std::move(generators);
+
+        gid_to_local_.clear();
+        cell_size_type lidx = 0;
+        for (auto& g: groups_) {
+            for (auto gid: g.gids) {
+                gid_to_local_[gid] = lidx++;
+            }
+        }
+
+        // The handles in the moved lanes remain valid: the groups that
+        // arrive lower their cells as the groups they replace.
+        communicator_.update_groups(rec, groups_, moved);
+        if (resolved_targets_) {
+            communicator_.resolve_targets(cell_groups_);
+        }
+        gj_halo_ = gap_junction_halo(cell_groups_, *distributed_);
+    }
+
+    group_order_.resize(cell_groups_.size());
+    std::iota(group_order_.begin(), group_order_.end(), 0);
+    std::stable_sort(group_order_.begin(), group_order_.end(),
+        [&](cell_size_type a, cell_size_type b) { return group_time_[a]>group_time_[b]; });
+    util::fill(group_time_, 0.);
+}
+
+void simulation_state::set_async_callbacks(std::size_t max_pending) {
+    if (callbacks_) {
+        callbacks_->wait();
+    }
+    callbacks_.reset(max_pending? new threading::callback_queue(max_pending): nullptr);
+}
+
 template <typename Seq, typename Value, typename Less = std::less<>>
 auto split_sorted_range(Seq&& seq, const Value& v, Less cmp = Less{}) {
     auto canon = util::canonical_view(seq);
@@ -366,9 +799,67 @@ void simulation_state::setup_events(time_type t_from, time_type t_to, std::size_
 
             merge_cell_events(t_from, t_to, old_events, pending, event_generators_[i], event_lanes(epoch+1)[i]);
             pending_events_[i].clear();
+
+            // Events with resolved targets have no generators: merge the
+            // pending events with the old events ≥ t_from.
+            PE(communication_enqueue_sort);
+            util::sort(pending_resolved_[i]);
+            PL();
+
+            PE(communication_enqueue_merge);
+            auto& old_resolved = resolved_lanes(epoch)[i];
+            auto& new_resolved = resolved_lanes(epoch+1)[i];
+            new_resolved.clear();
+            std::merge(pending_resolved_[i].begin(), pending_resolved_[i].end(),
+                std::lower_bound(old_resolved.begin(), old_resolved.end(), t_from, event_time_less()), old_resolved.end(),
+                std::back_inserter(new_resolved));
+            pending_resolved_[i].clear();
+            PL();
             });
 }
 
+namespace {
+// Copy of the samples passed to a sampler, for deferred delivery.
+struct sample_batch {
+    std::vector<sample_record> records;
+    std::vector<double> values;
+    std::vector<cable_sample_range> ranges;
+};
+
+// Copy scalar and whole-cell sample values into the batch; returns false if
+// the records hold data of another type.
+bool copy_samples(std::size_t n, const sample_record* recs, sample_batch& batch) {
+    std::vector<std::size_t> divs = {0};
+    for (std::size_t i = 0; i<n; ++i) {
+        if (auto p = util::any_cast<const double*>(recs[i].data)) {
+            batch.values.push_back(*p);
+        }
+        else if (auto p = util::any_cast<const cable_sample_range*>(recs[i].data)) {
+            batch.values.insert(batch.values.end(), p->first, p->second);
+        }
+        else {
+            return false;
+        }
+        divs.push_back(batch.values.size());
+    }
+
+    batch.ranges.reserve(n);
+    batch.records.reserve(n);
+    for (std::size_t i = 0; i<n; ++i) {
+        const double* v = batch.values.data();
+        if (util::any_cast<const double*>(recs[i].data)) {
+            batch.records.push_back({recs[i].time, v+divs[i]});
+        }
+        else {
+            batch.ranges.push_back({v+divs[i], v+divs[i+1]});
+            const cable_sample_range* r = &batch.ranges.back();
+            batch.records.push_back({recs[i].time, r});
+        }
+    }
+    return true;
+}
+} // anonymous namespace
+
 sampler_association_handle simulation_state::add_sampler(
         cell_member_predicate probe_ids,
         schedule sched,
@@ -377,8 +868,66 @@ sampler_association_handle simulation_state::add_sampler(
 {
     sampler_association_handle h = sassoc_handles_.acquire();
 
+    // With asynchronous callbacks, the sampler is passed a copy of the
+    // samples from the callback thread.
+    f = [this, f = std::move(f)](cell_member_type pid, probe_tag tag, std::size_t n, const sample_record* recs) {
+        if (!callbacks_) {
+            f(pid, tag, n, recs);
+            return;
+        }
+        auto batch = std::make_shared<sample_batch>();
+        if (!copy_samples(n, recs, *batch)) {
+            f(pid, tag, n, recs);
+            return;
+        }
+        callbacks_->push([f, pid, tag, batch]() { f(pid, tag, batch->records.size(), batch->records.data()); });
+    };
+
+    // The schedule is advanced to the time of the group it is added to.
+    auto& add = samplers_[h] =
+        [h, probe_ids = std::move(probe_ids), sched = std::move(sched), f = std::move(f), policy]
+        (cell_group& group, time_type t) {
+            auto s = sched;
+            s.events(0, t);
+            group.add_sampler(h, probe_ids, std::move(s), f, policy);
+        };
+
+    foreach_group(
+        [&](cell_group_ptr& group) { add(*group, 0); });
+
+    return h;
+}
+
+sampler_association_handle simulation_state::add_sampler(
+        cell_member_predicate probe_ids,
+        schedule sched,
+        bulk_sampler_function f,
+        sample_reduction reduction,
+        sampling_policy policy)
+{
+    sampler_association_handle h = sassoc_handles_.acquire();
+
+    f = [this, f = std::move(f)](cell_member_type pid, probe_tag tag, std::size_t n, const double* t, const double* v) {
+        if (!callbacks_) {
+            f(pid, tag, n, t, v);
+            return;
+        }
+        callbacks_->push(
+            [f, pid, tag, times = std::vector<double>(t, t+n), values = std::vector<double>(v, v+n)]() {
+                f(pid, tag, times.size(), times.data(), values.data());
+            });
+    };
+
+    auto& add = samplers_[h] =
+        [h, probe_ids = std::move(probe_ids), sched = std::move(sched), f = std::move(f), reduction, policy]
+        (cell_group& group, time_type t) {
+            auto s = sched;
+            s.events(0, t);
+            group.add_bulk_sampler(h, probe_ids, std::move(s), f, reduction, policy);
+        };
+
     foreach_group(
-        [&](cell_group_ptr& group) { group->add_sampler(h, probe_ids, sched, f, policy); });
+        [&](cell_group_ptr& group) { add(*group, 0); });
 
     return h;
 }
@@ -387,6 +936,7 @@ void simulation_state::remove_sampler(sampler_association_handle h) {
     foreach_group(
         [h](cell_group_ptr& group) { group->remove_sampler(h); });
 
+    samplers_.erase(h);
     sassoc_handles_.release(h);
 }
 
@@ -394,10 +944,13 @@ void simulation_state::remove_all_samplers() {
     foreach_group(
         [](cell_group_ptr& group) { group->remove_all_samplers(); });
 
+    samplers_.clear();
     sassoc_handles_.clear();
 }
 
 void simulation_state::set_binning_policy(binning_kind policy, time_type bin_interval) {
+    binning_policy_ = policy;
+    bin_interval_ = bin_interval;
     foreach_group(
         [&](cell_group_ptr& group) { group->set_binning_policy(policy, bin_interval); });
 }
@@ -443,6 +996,25 @@ sampler_association_handle simulation::add_sampler(
     return impl_->add_sampler(std::move(probe_ids), std::move(sched), std::move(f), policy);
 }
 
+sampler_association_handle simulation::add_sampler(
+    cell_member_predicate probe_ids,
+    schedule sched,
+    bulk_sampler_function f,
+    sampling_policy policy)
+{
+    return impl_->add_sampler(std::move(probe_ids), std::move(sched), std::move(f), sample_reduction{}, policy);
+}
+
+sampler_association_handle simulation::add_sampler(
+    cell_member_predicate probe_ids,
+    schedule sched,
+    bulk_sampler_function f,
+    sample_reduction reduction,
+    sampling_policy policy)
+{
+    return impl_->add_sampler(std::move(probe_ids), std::move(sched), std::move(f), reduction, policy);
+}
+
 void simulation::remove_sampler(sampler_association_handle h) {
     impl_->remove_sampler(h);
 }
@@ -471,6 +1043,30 @@ void simulation::inject_events(const pse_vector& events) {
     impl_->inject_events(events);
 }
 
+std::vector<double> simulation::group_advance_times() const {
+    return impl_->group_advance_times();
+}
+
+double simulation::active_fraction() const {
+    return impl_->active_fraction();
+}
+
+void simulation::rebalance(const recipe& rec) {
+    impl_->rebalance(rec);
+}
+
+void simulation::set_async_callbacks(std::size_t max_pending) {
+    impl_->set_async_callbacks(max_pending);
+}
+
+void simulation::set_gap_junction_interval(time_type interval) {
+    impl_->set_gap_junction_interval(interval);
+}
+
+void simulation::set_resolved_targets(bool enable) {
+    impl_->set_resolved_targets(enable);
+}
+
 simulation::~simulation() = default;
 
 } // namespace arb
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arbor/arbexcept.hpp>
+#include <arbor/spike.hpp>
+#include <arbor/spike_file.hpp>
+
+namespace arb {
+
+namespace {
+const char spike_file_magic[8] = {'A', 'R', 'B', 'S', 'P', 'I', 'K', 'E'};
+const std::uint32_t spike_file_version = 1;
+
+struct file_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+};
+
+struct spike_record {
+    std::uint32_t gid;
+    std::uint32_t index;
+    double time;
+};
+
+static_assert(sizeof(spike_record)==16, "unexpected spike record padding");
+
+bool time_less(const spike_record& a, const spike_record& b) {
+    return a.time<b.time;
+}
+
+std::ofstream open_spike_file(const std::string& path) {
+    std::ofstream out(path, std::ios::binary|std::ios::trunc);
+    if (!out) {
+        throw spike_file_error(path, "unable to open for writing");
+    }
+
+    file_header h;
+    std::memcpy(h.magic, spike_file_magic, sizeof(h.magic));
+    h.version = spike_file_version;
+    h.record_size = sizeof(spike_record);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    return out;
+}
+
+// Sequential reader of the records of a spike file, buffered in blocks.
+class spike_file_reader {
+public:
+    explicit spike_file_reader(const std::string& path, std::size_t block_size = 1<<14):
+        path_(path), in_(path, std::ios::binary), block_size_(block_size)
+    {
+        if (!in_) {
+            throw spike_file_error(path, "unable to open for reading");
+        }
+
+        file_header h;
+        if (!in_.read(reinterpret_cast<char*>(&h), sizeof(h)) ||
+            std::memcmp(h.magic, spike_file_magic, sizeof(h.magic)) ||
+            h.version!=spike_file_version ||
+            h.record_size!=sizeof(spike_record))
+        {
+            throw spike_file_error(path, "not a spike file");
+        }
+        fill();
+    }
+
+    bool done() const { return pos_==block_.size(); }
+    const spike_record& peek() const { return block_[pos_]; }
+
+    void next() {
+        if (++pos_==block_.size()) fill();
+    }
+
+private:
+    std::string path_;
+    std::ifstream in_;
+    std::size_t block_size_;
+    std::vector<spike_record> block_;
+    std::size_t pos_ = 0;
+
+    void fill() {
+        block_.resize(block_size_);
+        in_.read(reinterpret_cast<char*>(block_.data()), block_size_*sizeof(spike_record));
+        auto bytes = std::size_t(in_.gcount());
+        if (bytes%sizeof(spike_record)) {
+            throw spike_file_error(path_, "truncated record");
+        }
+        block_.resize(bytes/sizeof(spike_record));
+        pos_ = 0;
+    }
+};
+} // anonymous namespace
+
+struct spike_file_sink::impl {
+    std::string path;
+    std::size_t block_size;
+    std::ofstream out;
+
+    // Current block, filled by the caller, and the block pending for the
+    // I/O thread; `writing` is set while the I/O thread writes a block.
+    std::vector<spike_record> current, pending;
+    bool writing = false;
+    bool quit = false;
+    bool failed = false;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread io_thread;
+
+    impl(const std::string& path, std::size_t block_size):
+        path(path),
+        block_size(std::max<std::size_t>(block_size, 1)),
+        out(open_spike_file(path)),
+        io_thread([this] { run(); })
+    {
+        current.reserve(this->block_size);
+    }
+
+    ~impl() {
+        hand_over();
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            quit = true;
+        }
+        changed.notify_all();
+        io_thread.join();
+    }
+
+    // Pass the current block to the I/O thread, unless it has not yet taken
+    // the previous one. Called with the mutex held.
+    void try_hand_over() {
+        if (pending.empty() && !current.empty()) {
+            std::swap(current, pending);
+            changed.notify_all();
+        }
+    }
+
+    void hand_over() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return pending.empty(); });
+        try_hand_over();
+    }
+
+    void append(const std::vector<spike>& spikes) {
+        std::lock_guard<std::mutex> guard(mutex);
+        for (auto& s: spikes) {
+            current.push_back({s.source.gid, s.source.index, s.time});
+        }
+        if (current.size()>=block_size) {
+            try_hand_over();
+        }
+    }
+
+    void flush() {
+        hand_over();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return pending.empty() && !writing; });
+        if (failed) {
+            throw spike_file_error(path, "write failure");
+        }
+    }
+
+    void run() {
+        std::vector<spike_record> block;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            changed.wait(lock, [this] { return quit || !pending.empty(); });
+            if (pending.empty()) return;
+
+            std::swap(block, pending);
+            writing = true;
+            changed.notify_all();
+            lock.unlock();
+
+            std::stable_sort(block.begin(), block.end(), time_less);
+            out.write(reinterpret_cast<const char*>(block.data()), block.size()*sizeof(spike_record));
+            out.flush();
+            block.clear();
+
+            lock.lock();
+            writing = false;
+            failed = failed || !out;
+            changed.notify_all();
+        }
+    }
+};
+
+spike_file_sink::spike_file_sink(const std::string& path, std::size_t block_size):
+    impl_(std::make_shared<impl>(path, block_size))
+{}
+
+void spike_file_sink::operator()(const std::vector<spike>& spikes) {
+    impl_->append(spikes);
+}
+
+void spike_file_sink::flush() {
+    impl_->flush();
+}
+
+std::vector<spike> read_spike_file(const std::string& path) {
+    std::vector<spike> spikes;
+    for (spike_file_reader in(path); !in.done(); in.next()) {
+        auto& r = in.peek();
+        spikes.push_back(spike({r.gid, r.index}, r.time));
+    }
+    return spikes;
+}
+
+void merge_spike_files(const std::vector<std::string>& inputs, const std::string& output) {
+    std::vector<spike_file_reader> readers;
+    readers.reserve(inputs.size());
+    for (auto& path: inputs) {
+        readers.emplace_back(path);
+    }
+
+    // Heap of input indices, ordered by the time of their next record and
+    // then by input index.
+    auto later = [&readers](std::size_t a, std::size_t b) {
+        auto ta = readers[a].peek().time, tb = readers[b].peek().time;
+        return ta>tb || (ta==tb && a>b);
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(later)> heap(later);
+    for (std::size_t i = 0; i<readers.size(); ++i) {
+        if (!readers[i].done()) heap.push(i);
+    }
+
+    auto out = open_spike_file(output);
+    std::vector<spike_record> block;
+    const std::size_t block_size = 1<<14;
+
+    while (!heap.empty()) {
+        auto i = heap.top();
+        heap.pop();
+
+        block.push_back(readers[i].peek());
+        if (block.size()==block_size) {
+            out.write(reinterpret_cast<const char*>(block.data()), block.size()*sizeof(spike_record));
+            block.clear();
+        }
+
+        readers[i].next();
+        if (!readers[i].done()) heap.push(i);
+    }
+    out.write(reinterpret_cast<const char*>(block.data()), block.size()*sizeof(spike_record));
+
+    if (!out.flush()) {
+        throw spike_file_error(output, "write failure");
+    }
+}
+
+} // namespace arb
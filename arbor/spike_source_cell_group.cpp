@@ -7,6 +7,7 @@
 #include "cell_group.hpp"
 #include "profile/profiler_macro.hpp"
 #include "spike_source_cell_group.hpp"
+#include "util/bytes.hpp"
 #include "util/span.hpp"
 
 namespace arb {
@@ -30,7 +31,7 @@ cell_kind spike_source_cell_group::get_cell_kind() const {
     return cell_kind::spike_source;
 }
 
-void spike_source_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes) {
+void spike_source_cell_group::advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes, const resolved_lane_subrange&) {
     PE(advance_sscell);
 
     for (auto i: util::count_along(gids_)) {
@@ -45,6 +46,18 @@ void spike_source_cell_group::advance(epoch ep, time_type dt, const event_lane_s
     PL();
 };
 
+void spike_source_cell_group::serialize(std::vector<char>& buf) const {
+    util::write_bytes(buf, t_);
+}
+
+void spike_source_cell_group::deserialize(const char*& p) {
+    util::read_bytes(p, t_);
+    for (auto& s: time_sequences_) {
+        s.reset();
+        s.events(0, t_);
+    }
+}
+
 void spike_source_cell_group::reset() {
     for (auto& s: time_sequences_) {
         s.reset();
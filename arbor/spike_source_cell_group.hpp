@@ -19,7 +19,7 @@ public:
 
     cell_kind get_cell_kind() const override;
 
-    void advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes) override;
+    void advance(epoch ep, time_type dt, const event_lane_subrange& event_lanes, const resolved_lane_subrange&) override;
 
     void reset() override;
 
@@ -35,6 +35,10 @@ public:
 
     void remove_all_samplers() override {}
 
+    // The state is the time reached; the schedules are replayed up to it.
+    void serialize(std::vector<char>& buf) const override;
+    void deserialize(const char*& p) override;
+
 private:
     time_type t_ = 0;
     std::vector<spike> spikes_;
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+#include "threading/callback_queue.hpp"
+
+namespace arb {
+namespace threading {
+
+callback_queue::callback_queue(std::size_t capacity):
+    capacity_(std::max<std::size_t>(capacity, 1)),
+    worker_([this] { run(); })
+{}
+
+callback_queue::~callback_queue() {
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        quit_ = true;
+    }
+    changed_.notify_all();
+    worker_.join();
+}
+
+void callback_queue::push(task t) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return tasks_.size()<capacity_; });
+
+    if (!error_) {
+        tasks_.push_back(std::move(t));
+        changed_.notify_all();
+    }
+}
+
+void callback_queue::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return tasks_.empty() && !busy_; });
+
+    if (error_) {
+        auto e = std::move(error_);
+        error_ = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+void callback_queue::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        changed_.wait(lock, [this] { return quit_ || !tasks_.empty(); });
+        if (tasks_.empty()) return;
+
+        task t = std::move(tasks_.front());
+        tasks_.pop_front();
+        busy_ = true;
+        changed_.notify_all();
+        lock.unlock();
+
+        std::exception_ptr e;
+        try {
+            t();
+        }
+        catch (...) {
+            e = std::current_exception();
+        }
+
+        lock.lock();
+        busy_ = false;
+        if (e && !error_) {
+            error_ = e;
+            tasks_.clear();
+        }
+        changed_.notify_all();
+    }
+}
+
+} // namespace threading
+} // namespace arb
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace arb {
+namespace threading {
+
+// Run tasks in FIFO order on a dedicated thread, so that slow consumers of
+// simulation output, e.g. samplers that write to file, do not hold up the
+// caller. At most `capacity` tasks are pending: push blocks until there is
+// room, applying back pressure to the producer.
+//
+// The first exception thrown by a task is rethrown by the next call to
+// wait(); tasks queued or pushed after the failure are discarded.
+
+class callback_queue {
+public:
+    using task = std::function<void ()>;
+
+    explicit callback_queue(std::size_t capacity);
+
+    callback_queue(const callback_queue&) = delete;
+    callback_queue& operator=(const callback_queue&) = delete;
+
+    // Runs all pending tasks before returning.
+    ~callback_queue();
+
+    void push(task t);
+
+    // Block until all pushed tasks have run.
+    void wait();
+
+private:
+    std::size_t capacity_;
+    std::deque<task> tasks_;
+    bool busy_ = false;
+    bool quit_ = false;
+    std::exception_ptr error_;
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::thread worker_;
+
+    void run();
+};
+
+} // namespace threading
+} // namespace arb
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <arbor/arbexcept.hpp>
+#include <arbor/common_types.hpp>
+#include <arbor/trace_file.hpp>
+
+namespace arb {
+
+namespace {
+const char trace_file_magic[8] = {'A', 'R', 'B', 'T', 'R', 'A', 'C', 'E'};
+const std::uint32_t trace_file_version = 1;
+
+struct file_header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t value_size; // 4 or 8 bytes
+};
+
+struct block_header {
+    std::uint32_t gid;
+    std::uint32_t index;
+    std::int32_t tag;
+    std::uint32_t n;
+};
+
+// Buffered samples of one probe.
+struct column {
+    probe_tag tag;
+    std::vector<double> time;
+    std::vector<double> value;
+};
+} // anonymous namespace
+
+struct trace_file_sink::impl {
+    std::string path;
+    trace_value_type value_type;
+    std::size_t block_size;
+
+    std::ofstream out;
+    std::mutex out_mutex;
+
+    // Columns are only created under the lock; a probe is sampled by one
+    // thread at a time, so appending to its column needs no lock.
+    std::map<cell_member_type, std::unique_ptr<column>> columns;
+    std::mutex columns_mutex;
+
+    std::vector<float> narrow;
+
+    impl(const std::string& path, trace_value_type value_type, std::size_t block_size):
+        path(path), value_type(value_type), block_size(std::max<std::size_t>(block_size, 1)),
+        out(path, std::ios::binary|std::ios::trunc)
+    {
+        if (!out) {
+            throw trace_file_error(path, "unable to open for writing");
+        }
+
+        file_header h;
+        std::memcpy(h.magic, trace_file_magic, sizeof(h.magic));
+        h.version = trace_file_version;
+        h.value_size = value_type==trace_value_type::float32? 4: 8;
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    }
+
+    ~impl() {
+        try {
+            flush();
+        }
+        catch (...) {}
+    }
+
+    column& get_column(cell_member_type probe_id, probe_tag tag) {
+        std::lock_guard<std::mutex> guard(columns_mutex);
+        auto& c = columns[probe_id];
+        if (!c) {
+            c.reset(new column{tag, {}, {}});
+            c->time.reserve(block_size);
+            c->value.reserve(block_size);
+        }
+        return *c;
+    }
+
+    void write_block(cell_member_type probe_id, column& c) {
+        if (c.time.empty()) return;
+
+        std::lock_guard<std::mutex> guard(out_mutex);
+        block_header h{probe_id.gid, probe_id.index, std::int32_t(c.tag), std::uint32_t(c.time.size())};
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(c.time.data()), c.time.size()*sizeof(double));
+
+        if (value_type==trace_value_type::float32) {
+            narrow.assign(c.value.begin(), c.value.end());
+            out.write(reinterpret_cast<const char*>(narrow.data()), narrow.size()*sizeof(float));
+        }
+        else {
+            out.write(reinterpret_cast<const char*>(c.value.data()), c.value.size()*sizeof(double));
+        }
+        if (!out) {
+            throw trace_file_error(path, "write failure");
+        }
+
+        c.time.clear();
+        c.value.clear();
+    }
+
+    void append(cell_member_type probe_id, probe_tag tag, std::size_t n, const double* times, const double* values) {
+        column& c = get_column(probe_id, tag);
+        while (n) {
+            std::size_t k = std::min(n, block_size-c.time.size());
+            c.time.insert(c.time.end(), times, times+k);
+            c.value.insert(c.value.end(), values, values+k);
+            times += k;
+            values += k;
+            n -= k;
+
+            if (c.time.size()==block_size) {
+                write_block(probe_id, c);
+            }
+        }
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> guard(columns_mutex);
+        for (auto& kv: columns) {
+            write_block(kv.first, *kv.second);
+        }
+        std::lock_guard<std::mutex> out_guard(out_mutex);
+        out.flush();
+    }
+};
+
+trace_file_sink::trace_file_sink(const std::string& path, trace_value_type value_type, std::size_t block_size):
+    impl_(std::make_shared<impl>(path, value_type, block_size))
+{}
+
+void trace_file_sink::operator()(cell_member_type probe_id, probe_tag tag, std::size_t n, const double* times, const double* values) {
+    impl_->append(probe_id, tag, n, times, values);
+}
+
+void trace_file_sink::flush() {
+    impl_->flush();
+}
+
+std::vector<trace_file_column> read_trace_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw trace_file_error(path, "unable to open for reading");
+    }
+
+    file_header h;
+    if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) ||
+        std::memcmp(h.magic, trace_file_magic, sizeof(h.magic)) ||
+        h.version!=trace_file_version ||
+        (h.value_size!=4 && h.value_size!=8))
+    {
+        throw trace_file_error(path, "not a trace file");
+    }
+
+    std::map<cell_member_type, trace_file_column> columns;
+    std::vector<float> narrow;
+
+    block_header b;
+    while (in.read(reinterpret_cast<char*>(&b), sizeof(b))) {
+        cell_member_type id{b.gid, b.index};
+        auto& c = columns[id];
+        c.probe_id = id;
+        c.tag = b.tag;
+
+        auto n0 = c.time.size();
+        c.time.resize(n0+b.n);
+        c.value.resize(n0+b.n);
+        in.read(reinterpret_cast<char*>(c.time.data()+n0), b.n*sizeof(double));
+
+        if (h.value_size==4) {
+            narrow.resize(b.n);
+            in.read(reinterpret_cast<char*>(narrow.data()), b.n*sizeof(float));
+            std::copy(narrow.begin(), narrow.end(), c.value.begin()+n0);
+        }
+        else {
+            in.read(reinterpret_cast<char*>(c.value.data()+n0), b.n*sizeof(double));
+        }
+        if (!in) {
+            throw trace_file_error(path, "truncated block");
+        }
+    }
+    if (in.gcount()) {
+        throw trace_file_error(path, "truncated block header");
+    }
+
+    std::vector<trace_file_column> result;
+    for (auto& kv: columns) {
+        result.push_back(std::move(kv.second));
+    }
+    return result;
+}
+
+} // namespace arb
@@ -0,0 +1,57 @@
+#pragma once
+
+// Append trivially copyable values, and vectors of them, to a byte buffer,
+// and read them back in the same order. Used to move the state of cell
+// groups between ranks; the buffers are read by the same build of arbor that
+// wrote them.
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace arb {
+namespace util {
+
+template <typename T>
+void write_bytes(std::vector<char>& buf, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "value must be trivially copyable");
+    auto p = reinterpret_cast<const char*>(&value);
+    buf.insert(buf.end(), p, p+sizeof(T));
+}
+
+// Vectors are written as their size followed by their elements.
+template <typename T, typename A>
+void write_bytes(std::vector<char>& buf, const std::vector<T, A>& values) {
+    static_assert(std::is_trivially_copyable<T>::value, "value must be trivially copyable");
+    write_bytes(buf, std::uint64_t(values.size()));
+    auto p = reinterpret_cast<const char*>(values.data());
+    buf.insert(buf.end(), p, p+values.size()*sizeof(T));
+}
+
+template <typename T>
+void read_bytes(const char*& p, T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "value must be trivially copyable");
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+}
+
+template <typename T, typename A>
+void read_bytes(const char*& p, std::vector<T, A>& values) {
+    static_assert(std::is_trivially_copyable<T>::value, "value must be trivially copyable");
+    std::uint64_t n;
+    read_bytes(p, n);
+    values.resize(n);
+    if (n) std::memcpy(values.data(), p, n*sizeof(T));
+    p += n*sizeof(T);
+}
+
+template <typename T>
+T read_bytes(const char*& p) {
+    T value;
+    read_bytes(p, value);
+    return value;
+}
+
+} // namespace util
+} // namespace arb
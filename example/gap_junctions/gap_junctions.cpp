@@ -43,6 +43,14 @@ struct gap_params {
     double event_weight = 0.05;
     double sim_duration = 100;
     bool print_all = true;
+
+    // Close each cable into a ring of cells coupled by gap junctions.
+    bool ring = false;
+    // Spread the cells of each cable over cell groups and ranks.
+    bool split_components = false;
+    // Interval between exchanges of gap junction voltages between cell groups;
+    // zero for every time step.
+    double exchange_interval = 0;
 };
 
 gap_params read_options(int argc, char** argv);
@@ -124,6 +132,11 @@ public:
         int next_cell = gid + 1;
         int prev_cell = gid - 1;
 
+        if (params_.ring && params_.n_cells_per_cable>2) {
+            if (next_cell == cable_end) next_cell = cable_begin;
+            if (prev_cell < cable_begin) prev_cell = cable_end - 1;
+        }
+
         // Soma is connected to the prev cell's dendrite
         // Dendrite is connected to the next cell's soma
         // Gap junction conductance in μS
@@ -234,10 +247,13 @@ int main(int argc, char** argv) {
         cell_stats stats(recipe);
         std::cout << stats << "\n";
 
-        auto decomp = arb::partition_load_balance(recipe, context);
+        arb::partition_hint_map hints;
+        hints[arb::cell_kind::cable].split_gap_junctions = params.split_components;
+        auto decomp = arb::partition_load_balance(recipe, context, hints);
 
         // Construct the model.
         arb::simulation sim(recipe, decomp, context);
+        sim.set_gap_junction_interval(params.exchange_interval);
 
         // Set up the probe that will measure voltage in the cell.
 
@@ -422,6 +438,9 @@ gap_params read_options(int argc, char** argv) {
     param_from_json(params.event_weight, "event-weight", json);
     param_from_json(params.sim_duration, "sim-duration", json);
     param_from_json(params.print_all, "print-all", json);
+    param_from_json(params.ring, "ring", json);
+    param_from_json(params.split_components, "split-components", json);
+    param_from_json(params.exchange_interval, "exchange-interval", json);
 
     if (!json.empty()) {
         for (auto it=json.begin(); it!=json.end(); ++it) {
@@ -43,6 +43,7 @@ struct ring_params {
     unsigned num_cells = 10;
     double min_delay = 10;
     double duration = 100;
+    double quiescence_tolerance = 0;
     cell_parameters cell;
 };
 
@@ -63,12 +64,13 @@ arb::cable_cell branch_cell(arb::cell_gid_type gid, const cell_parameters& param
 
 class ring_recipe: public arb::recipe {
 public:
-    ring_recipe(unsigned num_cells, cell_parameters params, unsigned min_delay):
+    ring_recipe(unsigned num_cells, cell_parameters params, unsigned min_delay, double quiescence_tolerance):
         num_cells_(num_cells),
         cell_params_(params),
         min_delay_(min_delay)
     {
         gprop_.default_parameters = arb::neuron_parameter_defaults;
+        gprop_.quiescence_tolerance = quiescence_tolerance;
     }
 
     cell_size_type num_cells() const override {
@@ -218,7 +220,7 @@ int main(int argc, char** argv) {
         meters.start(context);
 
         // Create an instance of our recipe.
-        ring_recipe recipe(params.num_cells, params.cell, params.min_delay);
+        ring_recipe recipe(params.num_cells, params.cell, params.min_delay, params.quiescence_tolerance);
         cell_stats stats(recipe);
         std::cout << stats << "\n";
 
@@ -261,6 +263,7 @@ int main(int argc, char** argv) {
         if (root) {
             std::cout << "\n" << ns << " spikes generated at rate of "
                       << params.duration/ns << " ms between spikes\n";
+            std::cout << "cells integrated in " << 100*sim.active_fraction() << "% of epochs\n";
             std::ofstream fid("spikes.gdf");
             if (!fid.good()) {
                 std::cerr << "Warning: unable to open file spikes.gdf for spike output\n";
@@ -338,6 +341,7 @@ ring_params read_options(int argc, char** argv) {
     param_from_json(params.num_cells, "num-cells", json);
     param_from_json(params.duration, "duration", json);
     param_from_json(params.min_delay, "min-delay", json);
+    param_from_json(params.quiescence_tolerance, "quiescence-tolerance", json);
     params.cell = parse_cell_parameters(json);
 
     if (!json.empty()) {
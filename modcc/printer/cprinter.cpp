@@ -27,8 +27,8 @@ constexpr bool with_profiling() {
 void emit_procedure_proto(std::ostream&, ProcedureExpression*, const std::string& qualified = "");
 void emit_simd_procedure_proto(std::ostream&, ProcedureExpression*, const std::string& qualified = "");
 
-void emit_api_body(std::ostream&, APIMethod*);
-void emit_simd_api_body(std::ostream&, APIMethod*, moduleKind);
+void emit_api_body(std::ostream&, APIMethod*, bool range = false);
+void emit_simd_api_body(std::ostream&, APIMethod*, moduleKind, bool range = false);
 
 void emit_index_initialize(std::ostream& out, const std::unordered_set<std::string>& indices,
                            simd_expr_constraint constraint);
@@ -151,6 +151,7 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
         "using backend = ::arb::multicore::backend;\n"
         "using base = ::arb::multicore::mechanism;\n"
         "using value_type = base::value_type;\n"
+        "using state_type = base::state_type;\n"
         "using size_type = base::size_type;\n"
         "using index_type = base::index_type;\n"
         "using ::arb::math::exprelr;\n"
@@ -209,6 +210,11 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
         "void nrn_current() override;\n"
         "void write_ions() override;\n";
 
+    out <<
+        "bool has_range_kernels() const override { return true; }\n"
+        "void nrn_state_range(size_type begin_, size_type end_) override;\n"
+        "void nrn_current_range(size_type begin_, size_type end_) override;\n";
+
     net_receive && out <<
         "void deliver_events(deliverable_event_stream::state events) override;\n"
         "void net_receive(int i_, value_type weight);\n";
@@ -298,13 +304,18 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
         out << "value_type " << scalar->name() <<  " = " << as_c_double(scalar->value()) << ";\n";
     }
     for (const auto& array: vars.arrays) {
-        out << "value_type* " << array->name() << ";\n";
+        out << "state_type* " << array->name() << ";\n";
     }
     for (const auto& dep: ion_deps) {
         out << "ion_state_view " << ion_state_field(dep.name) << ";\n";
         out << "iarray " << ion_state_index(dep.name) << ";\n";
     }
 
+    // Scalar kernels for the instances of a range outside whole SIMD vectors.
+    with_simd && out <<
+        "void nrn_state_scalar(size_type begin_, size_type end_);\n"
+        "void nrn_current_scalar(size_type begin_, size_type end_);\n";
+
     for (auto proc: normal_procedures(module_)) {
         emit_procedure_proto(out, proc);
         out << ";\n";
@@ -368,6 +379,46 @@ std::string emit_cpp_source(const Module& module_, const printer_options& opt) {
     emit_body(write_ions_api);
     out << popindent << "}\n\n";
 
+    // With SIMD, ranges are split into the whole SIMD vectors they contain,
+    // updated with the SIMD kernels, and the instances before and after,
+    // updated with scalar kernels, so that no lane outside the range is
+    // touched.
+    auto emit_range_body = [&](APIMethod *p, const char* scalar_kernel) {
+        if (with_simd) {
+            out <<
+                "index_type simd_begin_ = std::min<index_type>((begin_+simd_width_-1)/simd_width_*simd_width_, end_);\n"
+                "index_type simd_end_ = std::max<index_type>(end_/simd_width_*simd_width_, simd_begin_);\n" <<
+                scalar_kernel << "(begin_, simd_begin_);\n";
+            emit_simd_api_body(out, p, module_.kind(), true);
+            out << scalar_kernel << "(simd_end_, end_);\n";
+        }
+        else {
+            emit_api_body(out, p, true);
+        }
+    };
+
+    out << "void " << class_name << "::nrn_state_range(size_type begin_, size_type end_) {\n" << indent;
+    out << profiler_enter("advance_integrate_state");
+    emit_range_body(state_api, "nrn_state_scalar");
+    out << profiler_leave();
+    out << popindent << "}\n\n";
+
+    out << "void " << class_name << "::nrn_current_range(size_type begin_, size_type end_) {\n" << indent;
+    out << profiler_enter("advance_integrate_current");
+    emit_range_body(current_api, "nrn_current_scalar");
+    out << profiler_leave();
+    out << popindent << "}\n\n";
+
+    if (with_simd) {
+        out << "void " << class_name << "::nrn_state_scalar(size_type begin_, size_type end_) {\n" << indent;
+        emit_api_body(out, state_api, true);
+        out << popindent << "}\n\n";
+
+        out << "void " << class_name << "::nrn_current_scalar(size_type begin_, size_type end_) {\n" << indent;
+        emit_api_body(out, current_api, true);
+        out << popindent << "}\n\n";
+    }
+
     // Mechanism procedures
 
     for (auto proc: normal_procedures(module_)) {
@@ -498,14 +549,23 @@ void emit_state_update(std::ostream& out, Symbol* from, IndexedVariable* externa
     }
 }
 
-void emit_api_body(std::ostream& out, APIMethod* method) {
+// With range, loop over the instances in [begin_, end_) rather than over
+// all instances.
+void emit_api_body(std::ostream& out, APIMethod* method, bool range) {
     auto body = method->body();
     auto indexed_vars = indexed_locals(method->scope());
 
     if (!body->statements().empty()) {
-        out <<
-            "int n_ = width_;\n"
-            "for (int i_ = 0; i_ < n_; ++i_) {\n" << indent;
+        if (range) {
+            out <<
+                "int n_ = end_;\n"
+                "for (int i_ = begin_; i_ < n_; ++i_) {\n" << indent;
+        }
+        else {
+            out <<
+                "int n_ = width_;\n"
+                "for (int i_ = 0; i_ < n_; ++i_) {\n" << indent;
+        }
 
         for (auto& sym: indexed_vars) {
             emit_state_read(out, sym);
@@ -733,20 +793,33 @@ void emit_body_for_loop(std::ostream& out, BlockExpression* body, const std::vec
     }
 }
 
+// With range, loop over the SIMD vectors of the constraint that start in
+// [simd_begin_, simd_end_) rather than over all of them.
 void emit_for_loop_per_constraint(std::ostream& out, BlockExpression* body,
                                   const std::vector<LocalVariable*>& indexed_vars,
                                   bool requires_weight,
                                   const std::unordered_set<std::string>& indices,
                                   const simd_expr_constraint& read_constraint,
                                   const simd_expr_constraint& write_constraint,
-                                  std::string underlying_constraint_name) {
+                                  std::string underlying_constraint_name,
+                                  bool range = false) {
 
     out << "constraint_category_ = index_constraint::"<< underlying_constraint_name << ";\n";
-    out << "for (unsigned i_ = 0; i_ < index_constraints_." << underlying_constraint_name
-        << ".size(); i_++) {\n"
-        << indent;
+    if (range) {
+        std::string part = "index_constraints_."+underlying_constraint_name;
+        out << "for (auto p_ = std::lower_bound(" << part << ".begin(), " << part << ".end(), simd_begin_); "
+            << "p_ != " << part << ".end() && *p_ < simd_end_; ++p_) {\n"
+            << indent;
 
-    out << "index_type index_ = index_constraints_." << underlying_constraint_name << "[i_];\n";
+        out << "index_type index_ = *p_;\n";
+    }
+    else {
+        out << "for (unsigned i_ = 0; i_ < index_constraints_." << underlying_constraint_name
+            << ".size(); i_++) {\n"
+            << indent;
+
+        out << "index_type index_ = index_constraints_." << underlying_constraint_name << "[i_];\n";
+    }
     if (requires_weight) {
         out << "simd_value w_(weight_+index_);\n";
     }
@@ -756,7 +829,9 @@ void emit_for_loop_per_constraint(std::ostream& out, BlockExpression* body,
     out << popindent << "}\n";
 }
 
-void emit_simd_api_body(std::ostream& out, APIMethod* method, moduleKind module_kind) {
+// With range, update the whole SIMD vectors in [simd_begin_, simd_end_)
+// rather than all instances.
+void emit_simd_api_body(std::ostream& out, APIMethod* method, moduleKind module_kind, bool range) {
     auto body = method->body();
     auto indexed_vars = indexed_locals(method->scope());
     bool requires_weight = false;
@@ -789,21 +864,21 @@ void emit_simd_api_body(std::ostream& out, APIMethod* method, moduleKind module_
             std::string underlying_constraint = "contiguous";
 
             emit_for_loop_per_constraint(out, body, indexed_vars, requires_weight, indices, constraint,
-                                         constraint, underlying_constraint);
+                                         constraint, underlying_constraint, range);
 
             //Generate for loop for all independent simd_vectors
             constraint = simd_expr_constraint::other;
             underlying_constraint = "independent";
 
             emit_for_loop_per_constraint(out, body, indexed_vars, requires_weight, indices, constraint,
-                                         constraint, underlying_constraint);
+                                         constraint, underlying_constraint, range);
 
             //Generate for loop for all simd_vectors that have no optimizing constraints
             constraint = simd_expr_constraint::other;
             underlying_constraint = "none";
 
             emit_for_loop_per_constraint(out, body, indexed_vars, requires_weight, indices, constraint,
-                                         constraint, underlying_constraint);
+                                         constraint, underlying_constraint, range);
 
             //Generate for loop for all constant simd_vectors
             simd_expr_constraint read_constraint = simd_expr_constraint::constant;
@@ -811,7 +886,7 @@ void emit_simd_api_body(std::ostream& out, APIMethod* method, moduleKind module_
             underlying_constraint = "constant";
 
             emit_for_loop_per_constraint(out, body, indexed_vars, requires_weight, indices, read_constraint,
-                                         write_constraint, underlying_constraint);
+                                         write_constraint, underlying_constraint, range);
 
         }
         else {
@@ -820,11 +895,15 @@ void emit_simd_api_body(std::ostream& out, APIMethod* method, moduleKind module_
                 emit_simd_state_read(out, sym, simd_expr_constraint::other);
             }
 
-            out <<
-                "unsigned n_ = width_;\n\n"
-                "for (unsigned i_ = 0; i_ < n_; i_ += simd_width_) {\n" << indent <<
-                simdprint(body) << popindent <<
-                "}\n";
+            if (range) {
+                out << "for (index_type i_ = simd_begin_; i_ < simd_end_; i_ += simd_width_) {\n";
+            }
+            else {
+                out <<
+                    "unsigned n_ = width_;\n\n"
+                    "for (unsigned i_ = 0; i_ < n_; i_ += simd_width_) {\n";
+            }
+            out << indent << simdprint(body) << popindent << "}\n";
         }
     }
 }
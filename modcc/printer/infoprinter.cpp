@@ -51,7 +51,8 @@ std::ostream& operator<<(std::ostream& out, const ion_dep_info& wrap) {
         << boolalpha[ion.writes_rev_potential()] << ", "
         << boolalpha[ion.uses_valence()] << ", "
         << boolalpha[ion.verifies_valence()] << ", "
-        << ion.expected_valence << "}}";
+        << ion.expected_valence << ", "
+        << boolalpha[ion.writes_current()] << "}}";
 }
 
 std::string build_info_header(const Module& m, const printer_options& opt) {
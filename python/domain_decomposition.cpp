@@ -71,6 +71,8 @@ void register_domain_decomposition(pybind11::module& m) {
                                         "The size of cell group assigned to GPU.")
         .def_readwrite("prefer_gpu", &arb::partition_hint::prefer_gpu,
                                         "Whether GPU usage is preferred.")
+        .def_readwrite("tune_cpu_group_size", &arb::partition_hint::tune_cpu_group_size,
+                                        "Whether to choose the CPU cell group size by timing trial groups.")
         .def_property_readonly_static("max_size",  [](pybind11::object) { return arb::partition_hint::max_size; },
                                         "Get the maximum size of cell groups.")
         .def("__str__",  &ph_string)
@@ -0,0 +1,115 @@
+// Compare assembly and solution of the Hines matrices of a cell group with
+// the flat, cell by cell, multicore matrix state and with the interleaved
+// state that solves across cells with SIMD operations; and of a single large
+// cell with the flat state and with the branch parallel state over a number
+// of threads.
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "backends/multicore/fvm.hpp"
+#include "matrix.hpp"
+#include "threading/threading.hpp"
+
+using namespace arb;
+
+using backend = multicore::backend;
+using value_type = backend::value_type;
+using index_type = backend::index_type;
+using array = backend::array;
+
+// Random branching cells with between min_size and max_size CVs.
+struct cell_matrices {
+    std::vector<index_type> p, c = {0}, intdom;
+    std::vector<value_type> cap, cond, area;
+    array dt, v, i, g;
+
+    cell_matrices(unsigned ncells, index_type min_size = 50, index_type max_size = 150) {
+        std::mt19937 gen;
+        std::uniform_int_distribution<index_type> size_dist(min_size, max_size);
+        std::uniform_real_distribution<value_type> dist(0.5, 2);
+
+        for (unsigned cell = 0; cell<ncells; ++cell) {
+            index_type first = c.back();
+            index_type n = size_dist(gen);
+            p.push_back(first);
+            cond.push_back(0);
+            for (index_type k = 1; k<n; ++k) {
+                // Mostly unbranched sections.
+                p.push_back(first+(k%8? k-1: std::uniform_int_distribution<index_type>(0, k-1)(gen)));
+                cond.push_back(dist(gen));
+            }
+            c.push_back(first+n);
+            intdom.push_back(cell);
+        }
+
+        auto ncv = p.size();
+        for (unsigned k = 0; k<ncv; ++k) {
+            cap.push_back(dist(gen));
+            area.push_back(dist(gen));
+        }
+        dt = array(ncells, 0.025);
+        v = array(ncv, -65);
+        i = array(ncv, 0.1);
+        g = array(ncv, 0.01);
+    }
+};
+
+template <typename State>
+void run_matrix(benchmark::State& state) {
+    cell_matrices cells(state.range(0));
+    matrix<backend, State> m(cells.p, cells.c, cells.cap, cells.cond, cells.area, cells.intdom);
+
+    while (state.KeepRunning()) {
+        m.assemble(cells.dt, cells.v, cells.i, cells.g);
+        m.solve();
+        benchmark::DoNotOptimize(m.solution().data());
+    }
+}
+
+void flat(benchmark::State& state) {
+    run_matrix<multicore::matrix_state<value_type, index_type>>(state);
+}
+
+void interleaved(benchmark::State& state) {
+    run_matrix<multicore::matrix_state_interleaved<value_type, index_type>>(state);
+}
+
+// One cell of 10^5 CVs, with the levels split into up to as many tasks as
+// there are threads.
+void branch_parallel(benchmark::State& state) {
+    const unsigned nthreads = state.range(0);
+    cell_matrices cells(1, 100000, 100000);
+    matrix<backend> m(cells.p, cells.c, cells.cap, cells.cond, cells.area, cells.intdom);
+    if (nthreads) {
+        m.state_.set_branch_parallel(true);
+        m.state_.set_cell_blocks(nthreads, std::make_shared<threading::task_system>(nthreads));
+    }
+
+    while (state.KeepRunning()) {
+        m.assemble(cells.dt, cells.v, cells.i, cells.g);
+        m.solve();
+        benchmark::DoNotOptimize(m.solution().data());
+    }
+}
+
+void run_custom_arguments(benchmark::internal::Benchmark* b) {
+    for (auto ncells: {1, 4, 16, 64, 256, 1024}) {
+        b->Args({ncells});
+    }
+}
+
+// Zero threads is the flat solver.
+void run_thread_arguments(benchmark::internal::Benchmark* b) {
+    for (auto nthreads: {0, 1, 2, 4, 8, 16}) {
+        b->Args({nthreads});
+    }
+}
+
+BENCHMARK(flat)->Apply(run_custom_arguments);
+BENCHMARK(interleaved)->Apply(run_custom_arguments);
+BENCHMARK(branch_parallel)->Apply(run_thread_arguments);
+
+BENCHMARK_MAIN();
@@ -341,7 +341,8 @@ test_ring(const domain_decomposition& D, communicator& C, F&& f) {
 
     // generate the events
     std::vector<arb::pse_vector> queues(C.num_local_cells());
-    C.make_event_queues(global_spikes, queues);
+    std::vector<arb::resolved_event_lane> resolved(C.num_local_cells());
+    C.make_event_queues(global_spikes, queues, resolved);
 
     // Assert that all the correct events were generated.
     // Iterate over each local gid, and testing whether an event is expected for
@@ -432,7 +433,8 @@ test_all2all(const domain_decomposition& D, communicator& C, F&& f) {
 
     // generate the events
     std::vector<arb::pse_vector> queues(C.num_local_cells());
-    C.make_event_queues(global_spikes, queues);
+    std::vector<arb::resolved_event_lane> resolved(C.num_local_cells());
+    C.make_event_queues(global_spikes, queues, resolved);
     if (queues.size() != D.groups.size()) { // one queue for each cell group
         return ::testing::AssertionFailure()
             << "expect one event queue for each cell group";
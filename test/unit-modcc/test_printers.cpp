@@ -255,4 +255,56 @@ TEST(CPrinter, proc_body_inlined) {
     proc_with_locals.erase(0, proc_with_locals.find(";") + 1);
 
     EXPECT_EQ(strip(expected), proc_with_locals);
-}
\ No newline at end of file
+}
+// Definition of the member function fn in the generated source.
+static std::string function_body(const std::string& source, const std::string& fn) {
+    auto begin = source.find("::"+fn+"(");
+    if (begin==std::string::npos) return "";
+    return source.substr(begin, source.find("\n}\n", begin)-begin);
+}
+
+TEST(CPrinter, range_kernels) {
+    // Range kernels are generated with and without explicit vectorization.
+    // With it, the whole SIMD vectors in a range are updated by the SIMD
+    // kernel, and the instances before and after by the scalar kernel.
+
+    Module m(io::read_all(DATADIR "/mod_files/test1.mod"), "test1.mod");
+    Parser p(m, false);
+    ASSERT_TRUE(p.parse());
+    m.semantic();
+    ASSERT_FALSE(m.has_error());
+
+    printer_options scalar_opt, simd_opt;
+    simd_opt.simd = simd_spec(simd_spec::avx2);
+
+    for (auto opt: {scalar_opt, simd_opt}) {
+        bool with_simd = opt.simd.abi!=simd_spec::none;
+        SCOPED_TRACE(with_simd? "simd": "scalar");
+
+        auto source = emit_cpp_source(m, opt);
+        EXPECT_NE(std::string::npos, strip(source).find("boolhas_range_kernels()constoverride{returntrue;}"));
+
+        for (auto kernel: {"nrn_state", "nrn_current"}) {
+            SCOPED_TRACE(kernel);
+            auto range = strip(function_body(source, std::string(kernel)+"_range"));
+            auto scalar = strip(function_body(source, std::string(kernel)+"_scalar"));
+            ASSERT_FALSE(range.empty());
+
+            if (with_simd) {
+                EXPECT_NE(std::string::npos, range.find(strip(std::string(kernel)+"_scalar(begin_, simd_begin_);")));
+                EXPECT_NE(std::string::npos, range.find(strip(std::string(kernel)+"_scalar(simd_end_, end_);")));
+                for (auto c: {"contiguous", "independent", "none", "constant"}) {
+                    auto part = std::string("index_constraints_.")+c;
+                    EXPECT_NE(std::string::npos, range.find(strip(
+                        "for (auto p_ = std::lower_bound("+part+".begin(), "+part+".end(), simd_begin_); "
+                        "p_ != "+part+".end() && *p_ < simd_end_; ++p_)")));
+                }
+                EXPECT_NE(std::string::npos, scalar.find(strip("for (int i_ = begin_; i_ < n_; ++i_)")));
+            }
+            else {
+                EXPECT_NE(std::string::npos, range.find(strip("for (int i_ = begin_; i_ < n_; ++i_)")));
+                EXPECT_TRUE(scalar.empty());
+            }
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #include "../gtest.h"
 
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 
 #include <arbor/context.hpp>
@@ -110,6 +112,40 @@ namespace {
     private:
         cell_size_type size_ = 15;
     };
+
+    // Gap junctions repeated in tiles of 5 cells, as seen by every rank of
+    // a dry run: cells 2 and 4 of each tile are coupled to cells 1 and 3 of
+    // the next tile, so that each tile's super cells straddle its boundary.
+    class tiled_gap_recipe: public recipe {
+    public:
+        tiled_gap_recipe(cell_size_type s): size_(s) {}
+
+        cell_size_type num_cells() const override {
+            return size_;
+        }
+
+        arb::util::unique_any get_cell_description(cell_gid_type) const override {
+            return {};
+        }
+
+        cell_kind get_cell_kind(cell_gid_type gid) const override {
+            return cell_kind::cable;
+        }
+
+        std::vector<gap_junction_connection> gap_junctions_on(cell_gid_type gid) const override {
+            cell_gid_type peer;
+            switch (gid%5) {
+                case 1: case 3: if (gid<5) return {}; peer = gid-4; break;
+                case 2: case 4: peer = gid+4; break;
+                default: return {};
+            }
+            if (peer>=size_) return {};
+            return {gap_junction_connection({peer, 0}, {gid, 0}, 0.1)};
+        }
+
+    private:
+        cell_size_type size_;
+    };
 }
 
 // test assumes one domain
@@ -352,4 +388,209 @@ TEST(domain_decomposition, compulsory_groups)
 
     EXPECT_EQ(expected_groups2, D2.groups[0].gids);
 
+    // Connected components are split over groups on request.
+    hints[cell_kind::cable].cpu_group_size = 1;
+    hints[cell_kind::cable].split_gap_junctions = true;
+
+    const auto D3 = partition_load_balance(R, ctx, hints);
+    EXPECT_EQ(15u, D3.groups.size());
+    for (const auto& g: D3.groups) {
+        EXPECT_EQ(1u, g.gids.size());
+    }
+}
+
+TEST(domain_decomposition, weighted_groups)
+{
+    proc_allocation resources;
+    resources.num_threads = 1;
+    resources.gpu_id = -1; // disable GPU if available
+    auto ctx = make_context(resources);
+
+    // Cell cost increases with gid: with a group size of 5 there are two
+    // groups, whose costs should differ by no more than the largest cell cost.
+    unsigned num_cells = 10;
+    auto cost = [](cell_gid_type gid) { return gid+1.; };
+
+    partition_hint_map hints;
+    hints[cell_kind::cable].cpu_group_size = 5;
+    hints[cell_kind::cable].prefer_gpu = false;
+
+    const auto D = partition_load_balance(homo_recipe(num_cells, dummy_cell{}), ctx, cost, hints);
+
+    EXPECT_EQ(D.num_global_cells, num_cells);
+    EXPECT_EQ(D.num_local_cells, num_cells);
+    ASSERT_EQ(2u, D.groups.size());
+
+    std::vector<cell_gid_type> all_gids;
+    std::vector<double> group_cost;
+    for (auto& g: D.groups) {
+        EXPECT_EQ(cell_kind::cable, g.kind);
+        EXPECT_EQ(backend_kind::multicore, g.backend);
+
+        double c = 0;
+        for (auto gid: g.gids) {
+            c += cost(gid);
+            all_gids.push_back(gid);
+        }
+        group_cost.push_back(c);
+    }
+
+    std::sort(all_gids.begin(), all_gids.end());
+    EXPECT_EQ(std::vector<cell_gid_type>(make_span(num_cells).begin(), make_span(num_cells).end()), all_gids);
+    EXPECT_LE(std::abs(group_cost[0]-group_cost[1]), cost(num_cells-1));
+
+    for (auto gid: make_span(num_cells)) {
+        EXPECT_EQ(0, D.gid_domain(gid));
+    }
+}
+
+TEST(domain_decomposition, weighted_compulsory_groups)
+{
+    proc_allocation resources;
+    resources.num_threads = 1;
+    resources.gpu_id = -1; // disable GPU if available
+    auto ctx = make_context(resources);
+
+    // Super cells must remain intact and contiguous in their groups.
+    auto R = gap_recipe();
+    partition_hint_map hints;
+    hints[cell_kind::cable].cpu_group_size = 5;
+    hints[cell_kind::cable].prefer_gpu = false;
+
+    const auto D = partition_load_balance(R, ctx, [](cell_gid_type) { return 1.; }, hints);
+    EXPECT_EQ(3u, D.groups.size());
+    EXPECT_EQ(15u, D.num_local_cells);
+
+    std::vector<std::vector<cell_gid_type>> super_cells = {{0, 13}, {2, 7, 11}, {3, 4, 8, 9}};
+    for (auto& sc: super_cells) {
+        unsigned n_found = 0;
+        for (auto& g: D.groups) {
+            auto it = std::search(g.gids.begin(), g.gids.end(), sc.begin(), sc.end());
+            n_found += it!=g.gids.end();
+        }
+        EXPECT_EQ(1u, n_found);
+    }
+}
+
+TEST(domain_decomposition, cell_cost_estimator)
+{
+    std::vector<cable_cell> cells = {make_cell_soma_only(), make_cell_ball_and_stick(), make_cell_ball_and_3stick()};
+    for (auto& c: cells) {
+        c.default_parameters.discretization = cv_policy_fixed_per_branch(10);
+    }
+    cable1d_recipe R(cells);
+
+    auto cost = make_cell_cost_estimator(R);
+    EXPECT_GT(cost(0), 0.);
+    EXPECT_GT(cost(1), cost(0));
+    EXPECT_GT(cost(2), cost(1));
+
+    // Explicit weights per mechanism are used in preference to the default.
+    cable_cell_cost_model model;
+    model.mechanism_weight["hh"] = 100;
+    auto hh_cost = make_cell_cost_estimator(R, model);
+    EXPECT_GT(hh_cost(0), cost(0));
+}
+
+TEST(domain_decomposition, gid_domain_ranges)
+{
+    proc_allocation resources;
+    resources.num_threads = 1;
+    resources.gpu_id = -1; // disable GPU if available
+
+    // Dry run over 3 ranks with 4 cells each: every rank is assigned a
+    // contiguous range of gids.
+    auto ctx = make_context(resources, dry_run_info(3, 4));
+
+    unsigned num_cells = 12;
+    const auto D = partition_load_balance(homo_recipe(num_cells, dummy_cell{}), ctx);
+
+    EXPECT_EQ(3, D.num_domains);
+    EXPECT_EQ(4u, D.num_local_cells);
+    for (auto gid: make_span(num_cells)) {
+        EXPECT_EQ(int(gid/4), D.gid_domain(gid));
+    }
+    EXPECT_EQ(-1, D.gid_domain(num_cells));
+    EXPECT_EQ(-1, D.gid_domain(1000));
+}
+
+TEST(domain_decomposition, gid_domain_super_cells)
+{
+    proc_allocation resources;
+    resources.num_threads = 1;
+    resources.gpu_id = -1; // disable GPU if available
+
+    // Dry run over 3 ranks with 5 cells each. Rank 0 keeps the super cells
+    // {2, 6} and {4, 8}, which start in its range; in the dry run, rank 1
+    // likewise keeps {7, 11} and {9, 13}.
+    auto ctx = make_context(resources, dry_run_info(3, 5));
+
+    unsigned num_cells = 15;
+    const auto D = partition_load_balance(tiled_gap_recipe(num_cells), ctx);
+
+    EXPECT_EQ(3, D.num_domains);
+    EXPECT_EQ(0, D.domain_id);
+    EXPECT_EQ(7u, D.num_local_cells);
+
+    std::vector<int> expected = {0, 0, 0, 0, 0, 1, 0, 1, 0, 1, 2, 1, 2, 1, 2};
+    std::vector<int> domains;
+    for (auto gid: make_span(num_cells)) {
+        domains.push_back(D.gid_domain(gid));
+    }
+    EXPECT_EQ(expected, domains);
+    EXPECT_EQ(-1, D.gid_domain(num_cells));
+    EXPECT_EQ(-1, D.gid_domain(1000));
+
+    // The gids mapped to the local domain are exactly those of the groups.
+    std::vector<cell_gid_type> group_gids;
+    for (auto& g: D.groups) {
+        for (auto gid: g.gids) {
+            EXPECT_EQ(D.domain_id, D.gid_domain(gid));
+            group_gids.push_back(gid);
+        }
+    }
+    std::sort(group_gids.begin(), group_gids.end());
+
+    std::vector<cell_gid_type> local_gids;
+    for (auto gid: make_span(num_cells)) {
+        if (D.gid_domain(gid)==D.domain_id) local_gids.push_back(gid);
+    }
+    EXPECT_EQ(local_gids, group_gids);
+}
+
+TEST(domain_decomposition, cpu_group_size_tuning)
+{
+    proc_allocation resources;
+    resources.gpu_id = -1; // disable GPU if available
+    auto ctx = make_context(resources);
+
+    unsigned num_cells = 6;
+    cable1d_recipe R(std::vector<cable_cell>(num_cells, make_cell_ball_and_stick()));
+
+    std::vector<cell_gid_type> sample = {0, 1, 2, 3, 4, 5};
+    auto tuning = tune_cpu_group_size(R, ctx, cell_kind::cable, sample, 2);
+
+    std::vector<std::size_t> trial_sizes;
+    for (auto& t: tuning.trials) {
+        trial_sizes.push_back(t.group_size);
+        EXPECT_GE(t.throughput, 0.);
+    }
+    EXPECT_EQ((std::vector<std::size_t>{1, 2, 4, 6}), trial_sizes);
+    EXPECT_EQ(cell_kind::cable, tuning.kind);
+    EXPECT_NE(trial_sizes.end(), std::find(trial_sizes.begin(), trial_sizes.end(), tuning.group_size));
+
+    // The tuned size replaces the hinted size in the load balancer.
+    partition_hint_map hints;
+    hints[cell_kind::cable].prefer_gpu = false;
+    hints[cell_kind::cable].tune_cpu_group_size = true;
+
+    std::size_t tuned_size = 0;
+    hints[cell_kind::cable].tuning_report = [&](const group_size_tuning& t) { tuned_size = t.group_size; };
+
+    const auto D = partition_load_balance(R, ctx, hints);
+    ASSERT_NE(0u, tuned_size);
+    EXPECT_EQ((num_cells+tuned_size-1)/tuned_size, D.groups.size());
+    for (auto& g: D.groups) {
+        EXPECT_LE(g.gids.size(), tuned_size);
+    }
 }
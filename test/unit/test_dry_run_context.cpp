@@ -56,6 +56,14 @@ TEST(dry_run_context, sum)
     EXPECT_EQ(unsigned(42 * num_ranks), ctx->sum(42u));
 }
 
+TEST(dry_run_context, gather_all)
+{
+    distributed_context_handle ctx = arb::make_dry_run_context(num_ranks, num_cells_per_rank);
+
+    EXPECT_EQ(std::vector<int>(num_ranks, 42), ctx->gather_all(42));
+    EXPECT_EQ(std::vector<double>(num_ranks, 42.), ctx->gather_all(42.));
+}
+
 TEST(dry_run_context, gather_spikes)
 {
     distributed_context_handle ctx = arb::make_dry_run_context(4, 4);
@@ -117,3 +125,47 @@ TEST(dry_run_context, gather_gids)
     EXPECT_EQ(part[3], gids.size()*3);
     EXPECT_EQ(part[4], gids.size()*4);
 }
+
+TEST(dry_run_context, gather_gj_sites)
+{
+    distributed_context_handle ctx = arb::make_dry_run_context(2, 4);
+    std::vector<arb::cell_member_type> sites = {{0u, 0u}, {3u, 1u}};
+
+    auto s = ctx->gather_gj_sites(sites);
+    auto& part = s.partition();
+
+    ASSERT_EQ(4u, s.values().size());
+    EXPECT_EQ((arb::cell_member_type{4u, 0u}), s.values()[2]);
+    EXPECT_EQ((arb::cell_member_type{7u, 1u}), s.values()[3]);
+    EXPECT_EQ(3u, part.size());
+    EXPECT_EQ(part[1], sites.size());
+    EXPECT_EQ(part[2], sites.size()*2);
+}
+
+TEST(dry_run_context, gather_gj_voltages)
+{
+    distributed_context_handle ctx = arb::make_dry_run_context(2, 4);
+    std::vector<arb::fvm_value_type> v = {-65., -60.};
+
+    auto s = ctx->gather_gj_voltages(v);
+    auto& part = s.partition();
+
+    EXPECT_EQ((std::vector<arb::fvm_value_type>{-65., -60., -65., -60.}), s.values());
+    EXPECT_EQ(3u, part.size());
+    EXPECT_EQ(part[1], v.size());
+    EXPECT_EQ(part[2], v.size()*2);
+}
+
+TEST(dry_run_context, gather_bytes)
+{
+    distributed_context_handle ctx = arb::make_dry_run_context(3, 4);
+    std::vector<char> bytes = {'a', 'r', 'b'};
+
+    auto s = ctx->gather_bytes(bytes);
+    auto& part = s.partition();
+
+    EXPECT_EQ(s.values(), (std::vector<char>{'a', 'r', 'b', 'a', 'r', 'b', 'a', 'r', 'b'}));
+    EXPECT_EQ(part.size(), 4u);
+    EXPECT_EQ(part[1], bytes.size());
+    EXPECT_EQ(part[3], bytes.size()*3);
+}
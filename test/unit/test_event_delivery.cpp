@@ -8,6 +8,7 @@
 
 #include <arbor/common_types.hpp>
 #include <arbor/domain_decomposition.hpp>
+#include <arbor/load_balance.hpp>
 #include <arbor/simulation.hpp>
 #include <arbor/cable_cell.hpp>
 #include <arbor/spike.hpp>
@@ -123,3 +124,42 @@ TEST(mc_event_delivery, gj_reordered) {
     gid_vector spike_gids = run_test_sim(R, {{0, 1, 2, 3, 4}});
     EXPECT_EQ((gid_vector{0, 1, 2, 3, 4}), spike_gids);
 }
+
+// Events from connections are delivered with the target handles resolved by
+// the communicator if enabled; spikes should propagate along a chain of cells
+// in order either way.
+
+struct test_recipe_chain: public test_recipe {
+    explicit test_recipe_chain(int n): test_recipe(n) {}
+
+    std::vector<cell_connection> connections_on(cell_gid_type i) const override {
+        if (!i) return {};
+        return {cell_connection({i-1, 0u}, {i, 0u}, 1.f, 1.0)};
+    }
+};
+
+TEST(mc_event_delivery, chain) {
+    test_recipe_chain R(5);
+    arb::context ctx = make_context(proc_allocation{});
+    auto D = partition_load_balance(R, ctx);
+
+    for (bool resolved: {false, true}) {
+        SCOPED_TRACE(resolved);
+
+        std::vector<spike> spikes;
+        simulation sim(R, D, ctx);
+        sim.set_resolved_targets(resolved);
+        sim.set_global_spike_callback(
+                [&spikes](const std::vector<spike>& ss) {
+                    spikes.insert(spikes.end(), ss.begin(), ss.end());
+                });
+
+        sim.inject_events({{{0u, 0u}, 0.f, 1.f}});
+        sim.run(10, 0.01);
+
+        std::vector<cell_gid_type> spike_gids;
+        util::sort_by(spikes, [](auto s) { return s.time; });
+        util::assign(spike_gids, util::transform_view(spikes, [](auto s) { return s.source.gid; }));
+        EXPECT_EQ((gid_vector{0, 1, 2, 3, 4}), spike_gids);
+    }
+}
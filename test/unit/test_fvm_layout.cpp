@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -6,6 +7,7 @@
 #include <arbor/math.hpp>
 #include <arbor/cable_cell.hpp>
 
+#include "algorithms.hpp"
 #include "fvm_layout.hpp"
 #include "util/maputil.hpp"
 #include "util/rangeutil.hpp"
@@ -993,3 +995,83 @@ TEST(fvm_layout, revpot) {
     ASSERT_EQ(1u, M.mechanisms.count(write_eb_ec.name()));
     EXPECT_EQ((std::vector<fvm_index_type>(1, soma1_index)), M.mechanisms.at(write_eb_ec.name()).cv);
 }
+
+TEST(fvm_layout, renumber_cvs) {
+    // Soma with a branch (1) with a long (3) and a short (4) child branch,
+    // and a short branch (2); depth-first numbering visits smaller subtrees
+    // first.
+    soma_cell_builder builder(6);
+    builder.add_branch(0, 200, 0.5, 0.5, 4, "dend");
+    builder.add_branch(0, 100, 0.5, 0.5, 2, "dend");
+    builder.add_branch(1, 100, 0.5, 0.5, 5, "axon");
+    builder.add_branch(1, 100, 0.5, 0.5, 2, "axon");
+    auto cell = builder.make_cell();
+    cell.paint("soma", "hh");
+    cell.paint("dend", "pas");
+    cell.paint("axon", "hh");
+    cell.place(mlocation{2, 0.5}, "expsyn");
+    cell.place(mlocation{3, 0.7}, "expsyn");
+
+    std::vector<cable_cell> cells = {make_cell_ball_and_stick(), cell};
+
+    cable_cell_global_properties gprop;
+    gprop.default_parameters = neuron_parameter_defaults;
+
+    fvm_discretization D = fvm_discretize(cells, gprop.default_parameters);
+    fvm_discretization R = D;
+    fvm_renumber_cvs(R);
+
+    ASSERT_EQ(D.ncv, R.ncv);
+    EXPECT_EQ(D.cell_cv_bounds, R.cell_cv_bounds);
+    EXPECT_EQ(D.cv_to_cell, R.cv_to_cell);
+
+    // Parents precede children, and more CVs follow their parent directly.
+    auto n_sequential = [](const fvm_discretization& D) {
+        unsigned n = 0;
+        for (auto i: make_span(D.ncv)) {
+            n += D.parent_cv[i]+1==(fvm_index_type)i;
+        }
+        return n;
+    };
+    for (auto i: make_span(R.ncv)) {
+        EXPECT_LE(R.parent_cv[i], (fvm_index_type)i);
+    }
+    EXPECT_EQ(n_sequential(D)+1, n_sequential(R));
+    EXPECT_LT(R.segments[4].proximal_cv, R.segments[3].proximal_cv);
+    EXPECT_LT(R.segments[6].proximal_cv, R.segments[5].proximal_cv);
+
+    // Locations map to CVs with the same properties.
+    for (auto ci: make_span(D.ncell)) {
+        for (msize_t b: make_span(cells[ci].num_branches())) {
+            for (double pos: {0., 0.3, 0.5, 1.}) {
+                auto d = D.branch_location_cv(ci, mlocation{b, pos});
+                auto r = R.branch_location_cv(ci, mlocation{b, pos});
+                EXPECT_EQ(D.cv_area[d], R.cv_area[r]);
+                EXPECT_EQ(D.cv_capacitance[d], R.cv_capacitance[r]);
+                EXPECT_EQ(D.face_conductance[d], R.face_conductance[r]);
+                EXPECT_EQ(D.diam_um[d], R.diam_um[r]);
+                EXPECT_EQ(D.cv_area[D.parent_cv[d]], R.cv_area[R.parent_cv[r]]);
+            }
+        }
+    }
+
+    // Mechanism and ion CVs remain ordered, and cover the same CVs.
+    fvm_mechanism_data MD = fvm_build_mechanism_data(gprop, cells, D);
+    fvm_mechanism_data MR = fvm_build_mechanism_data(gprop, cells, R);
+
+    for (auto& m: MD.mechanisms) {
+        auto& md = m.second;
+        auto& mr = MR.mechanisms.at(m.first);
+        ASSERT_EQ(md.cv.size(), mr.cv.size());
+        EXPECT_TRUE(std::is_sorted(mr.cv.begin(), mr.cv.end()));
+        if (md.kind==mechanismKind::density) {
+            EXPECT_FLOAT_EQ(algorithms::sum(md.norm_area), algorithms::sum(mr.norm_area));
+        }
+    }
+    for (auto& i: MD.ions) {
+        auto& ir = MR.ions.at(i.first);
+        ASSERT_EQ(i.second.cv.size(), ir.cv.size());
+        EXPECT_TRUE(std::is_sorted(ir.cv.begin(), ir.cv.end()));
+        EXPECT_FLOAT_EQ(algorithms::sum(i.second.init_iconc), algorithms::sum(ir.init_iconc));
+    }
+}
@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -14,6 +19,7 @@
 #include <arbor/sampling.hpp>
 #include <arbor/simulation.hpp>
 #include <arbor/schedule.hpp>
+#include <arbor/version.hpp>
 
 #include "algorithms.hpp"
 #include "backends/multicore/fvm.hpp"
@@ -46,6 +52,11 @@ ACCESS_BIND(matrix fvm_cell::*, private_matrix_ptr, &fvm_cell::matrix_)
 
 ACCESS_BIND(std::vector<arb::mechanism_ptr> fvm_cell::*, private_mechanisms_ptr, &fvm_cell::mechanisms_)
 
+ACCESS_BIND(backend::step_tiles fvm_cell::*, private_step_tiles_ptr, &fvm_cell::step_tiles_)
+
+ACCESS_BIND(std::vector<arb::mechanism*> fvm_cell::*, private_step_revpot_ptr, &fvm_cell::step_revpot_mechanisms_)
+ACCESS_BIND(std::vector<arb::mechanism*> fvm_cell::*, private_concentration_writers_ptr, &fvm_cell::concentration_writers_)
+
 arb::mechanism* find_mechanism(fvm_cell& fvcell, const std::string& name) {
     for (auto& mech: fvcell.*private_mechanisms_ptr) {
         if (mech->internal_name()==name) {
@@ -63,7 +74,7 @@ arb::mechanism* find_mechanism(fvm_cell& fvcell, int index) {
 // Access to mechanism-internal data:
 
 using mechanism_global_table = std::vector<std::pair<const char*, arb::fvm_value_type*>>;
-using mechanism_field_table = std::vector<std::pair<const char*, arb::fvm_value_type**>>;
+using mechanism_field_table = std::vector<std::pair<const char*, arb::fvm_state_type**>>;
 using mechanism_ion_index_table = std::vector<std::pair<const char*, backend::iarray*>>;
 
 ACCESS_BIND(\
@@ -364,19 +375,19 @@ TEST(fvm_lowered, stimulus) {
     memory::fill(T, 1.);
     stim->nrn_current();
     constexpr double unit_factor = 1e-3; // scale A/m²·µm² to nA
-    EXPECT_DOUBLE_EQ(-0.1, J[soma_cv]*A[soma_cv]*unit_factor);
+    EXPECT_TRUE(testing::almost_eq<fvm_state_type>(-0.1, J[soma_cv]*A[soma_cv]*unit_factor));
 
     // Test that 0.1 nA is again injected at t=1.5, for a total of 0.2 nA.
     memory::fill(T, 1.);
     stim->nrn_current();
-    EXPECT_DOUBLE_EQ(-0.2, J[soma_cv]*A[soma_cv]*unit_factor);
+    EXPECT_TRUE(testing::almost_eq<fvm_state_type>(-0.2, J[soma_cv]*A[soma_cv]*unit_factor));
 
     // Test that at t=10, no more current is injected at soma, and that
     // that 0.3 nA is injected at dendrite tip.
     memory::fill(T, 10.);
     stim->nrn_current();
-    EXPECT_DOUBLE_EQ(-0.2, J[soma_cv]*A[soma_cv]*unit_factor);
-    EXPECT_DOUBLE_EQ(-0.3, J[tip_cv]*A[tip_cv]*unit_factor);
+    EXPECT_TRUE(testing::almost_eq<fvm_state_type>(-0.2, J[soma_cv]*A[soma_cv]*unit_factor));
+    EXPECT_TRUE(testing::almost_eq<fvm_state_type>(-0.3, J[tip_cv]*A[tip_cv]*unit_factor));
 }
 
 // Test derived mechanism behaviour.
@@ -591,7 +602,9 @@ TEST(fvm_lowered, ionic_currents) {
     const double time = 12; // [ms]
     (void)fvcell.integrate(time, 0.1, {}, {});
     double expected_Xi = -time*coeff*jca;
-    EXPECT_NEAR(expected_Xi, ion.Xi_[0], 1e-6);
+    // Allow for rounding of the concentration to the state type at each step.
+    double tol = std::max(1e-6, time/0.1*std::numeric_limits<fvm_state_type>::epsilon()*std::abs(expected_Xi));
+    EXPECT_NEAR(expected_Xi, ion.Xi_[0], tol);
 }
 
 // Test correct scaling of an ionic current updated via a point mechanism
@@ -981,6 +994,39 @@ TEST(fvm_lowered, cell_group_gj) {
 
 }
 
+// The SIMD gap junction current kernel sorts and pads the junctions; the
+// result must match a scalar loop over the junctions in recipe order.
+TEST(fvm_lowered, gj_current) {
+    const unsigned ncv = 7;
+    std::vector<fvm_gap_junction> gj = {
+        {{3, 0}, 0.5}, {{0, 3}, 0.5}, {{3, 6}, 1.5}, {{6, 3}, 1.5},
+        {{1, 2}, 2.0}, {{2, 1}, 2.0}, {{3, 5}, 0.25}, {{5, 3}, 0.25},
+        {{4, 0}, 1.0}, {{0, 4}, 1.0}, {{3, 2}, 3.0}
+    };
+
+    shared_state state(1,
+        std::vector<fvm_index_type>(ncv, 0),
+        gj,
+        std::vector<fvm_value_type>(ncv, -65),
+        std::vector<fvm_value_type>(ncv, 308),
+        std::vector<fvm_value_type>(ncv, 1.),
+        1);
+
+    std::vector<fvm_value_type> v = {-65, -60, -70, -55, -80, -62, -40};
+    std::copy(v.begin(), v.end(), state.voltage.begin());
+    std::fill(state.current_density.begin(), state.current_density.end(), 1.);
+
+    std::vector<fvm_value_type> expected(ncv, 1.);
+    for (auto g: gj) {
+        expected[g.loc.first] -= g.weight*(v[g.loc.second]-v[g.loc.first]);
+    }
+
+    state.add_gj_current();
+    for (unsigned i = 0; i<ncv; ++i) {
+        EXPECT_NEAR(expected[i], state.current_density[i], 1e-12);
+    }
+}
+
 TEST(fvm_lowered, integration_domains) {
     {
         execution_context context;
@@ -1023,3 +1069,617 @@ TEST(fvm_lowered, integration_domains) {
     }
 }
 
+
+// Helpers for tests that compare integration options: the cells are lowered
+// into one cell group, with the cable cell global properties modified by a
+// mutator, and integrated to a final time.
+
+using gprop_mutator = std::function<void(cable_cell_global_properties&)>;
+
+struct lowered_recipe: cable1d_recipe {
+    lowered_recipe(const std::vector<cable_cell>& cells, const gprop_mutator& set_gprop):
+        cable1d_recipe(cells)
+    {
+        if (set_gprop) set_gprop(cell_gprop_);
+    }
+};
+
+struct lowered_cells {
+    std::unique_ptr<fvm_cell> cell;
+    std::vector<target_handle> targets;
+
+    shared_state& state() const { return *(cell.get()->*private_state_ptr); }
+};
+
+lowered_cells make_lowered(const recipe& rec, const execution_context& context = execution_context()) {
+    lowered_cells lowered;
+    std::vector<fvm_index_type> cell_to_intdom;
+    probe_association_map<probe_handle> probe_map;
+
+    std::vector<cell_gid_type> gids = util::assign_from(util::make_span(rec.num_cells()));
+    lowered.cell = std::make_unique<fvm_cell>(context);
+    lowered.cell->initialize(gids, rec, cell_to_intdom, lowered.targets, probe_map);
+    return lowered;
+}
+
+lowered_cells make_lowered(
+    const std::vector<cable_cell>& cells,
+    const gprop_mutator& set_gprop,
+    const execution_context& context = execution_context())
+{
+    return make_lowered(lowered_recipe(cells, set_gprop), context);
+}
+
+struct lowered_run {
+    std::vector<threshold_crossing> crossings;
+    std::vector<fvm_value_type> sample_time;
+    std::vector<fvm_value_type> sample_value;
+    std::vector<fvm_value_type> voltage;
+    bool integrated;
+};
+
+lowered_run integrate_lowered(
+    const lowered_cells& lowered,
+    fvm_value_type tfinal,
+    fvm_value_type dt,
+    const std::vector<deliverable_event>& events = {},
+    const std::vector<sample_event>& samples = {})
+{
+    auto result = lowered.cell->integrate(tfinal, dt, events, samples);
+    auto& v = lowered.state().voltage;
+
+    lowered_run run;
+    util::assign(run.crossings, result.crossings);
+    run.sample_time.assign(result.sample_time.begin(), result.sample_time.begin()+samples.size());
+    run.sample_value.assign(result.sample_value.begin(), result.sample_value.begin()+samples.size());
+    run.voltage.assign(v.begin(), v.end());
+    run.integrated = result.integrated;
+    return run;
+}
+
+lowered_run run_lowered(
+    const std::vector<cable_cell>& cells,
+    const gprop_mutator& set_gprop,
+    fvm_value_type tfinal,
+    fvm_value_type dt = 0.025,
+    const execution_context& context = execution_context())
+{
+    return integrate_lowered(make_lowered(cells, set_gprop, context), tfinal, dt);
+}
+
+void expect_same_crossings(
+    const std::vector<threshold_crossing>& expected,
+    const std::vector<threshold_crossing>& crossings,
+    double tolerance = 0)
+{
+    ASSERT_EQ(expected.size(), crossings.size());
+    for (auto i: util::count_along(expected)) {
+        EXPECT_EQ(expected[i].index, crossings[i].index);
+        if (tolerance) {
+            EXPECT_NEAR(expected[i].time, crossings[i].time, tolerance);
+        }
+        else {
+            EXPECT_EQ(expected[i].time, crossings[i].time);
+        }
+    }
+}
+
+// Splitting the cells of a group into blocks or tiles gives identical
+// results, except with explicit vectorization: the mechanism instances at
+// the ends of a block are then updated with scalar code, which rounds
+// differently from the SIMD code.
+void expect_same_split(const lowered_run& expected, const lowered_run& split) {
+#ifdef ARB_VECTORIZE_ENABLED
+    const double tolerance = 1e-6;
+    auto expect_near = [&](const std::vector<fvm_value_type>& a, const std::vector<fvm_value_type>& b) {
+        ASSERT_EQ(a.size(), b.size());
+        for (auto i: util::count_along(a)) {
+            EXPECT_NEAR(a[i], b[i], tolerance);
+        }
+    };
+
+    expect_same_crossings(expected.crossings, split.crossings, tolerance);
+    expect_near(expected.voltage, split.voltage);
+    expect_near(expected.sample_value, split.sample_value);
+#else
+    expect_same_crossings(expected.crossings, split.crossings);
+    EXPECT_EQ(expected.voltage, split.voltage);
+    EXPECT_EQ(expected.sample_value, split.sample_value);
+#endif
+    EXPECT_EQ(expected.sample_time, split.sample_time);
+}
+
+TEST(fvm_lowered, cell_blocks) {
+    // Splitting the matrix, mechanism updates and threshold tests of a cell
+    // group into blocks of cells run in parallel must not change the result.
+
+    std::vector<cable_cell> cells;
+    for (unsigned i = 0; i<5; ++i) {
+        cells.push_back(make_cell_ball_and_stick(i%2==0));
+        cells.back().place(mlocation{0, 0.5}, threshold_detector{-10});
+    }
+    cells.push_back(make_cell_ball_and_3stick());
+    cells.back().place(mlocation{0, 0.5}, threshold_detector{-10});
+
+    proc_allocation resources;
+    resources.num_threads = 4;
+    execution_context context(resources);
+
+    auto run = [&](unsigned n_blocks) {
+        return run_lowered(cells, [=](auto& p) { p.cell_group_blocks = n_blocks; }, 30, 0.025, context);
+    };
+
+    auto expected = run(1);
+    EXPECT_FALSE(expected.crossings.empty());
+
+    for (unsigned n_blocks: {2u, 3u, 16u}) {
+        expect_same_split(expected, run(n_blocks));
+    }
+}
+
+TEST(fvm_lowered, adaptive_dt) {
+    // Adaptive steps should reproduce the spikes of fixed steps, grow
+    // in a quiescent cell, and end at sample times.
+
+    std::vector<cable_cell> cells = {make_cell_ball_and_stick(true), make_cell_ball_and_stick(false)};
+    for (auto& c: cells) {
+        c.place(mlocation{0, 0.5}, threshold_detector{-10});
+    }
+
+    auto adaptive = [](double tolerance) {
+        return [=](auto& p) {
+            p.adaptive_dt_tolerance = tolerance;
+            p.adaptive_dt_max = 0.5;
+        };
+    };
+
+    auto fixed = make_lowered(cells, adaptive(0));
+    auto expected = integrate_lowered(fixed, 30, 0.025).crossings;
+
+    // Sample the voltage of the last CV, in the second cell.
+    auto stepped = make_lowered(cells, adaptive(0.01));
+    auto& state = stepped.state();
+    const fvm_value_type* v = state.voltage.data()+state.voltage.size()-1;
+    auto result = integrate_lowered(stepped, 30, 0.025, {},
+        {{1.0, 1, {v, 0}}, {7.3, 1, {v, 1}}, {29.9, 1, {v, 2}}});
+
+    EXPECT_FALSE(expected.empty());
+    expect_same_crossings(expected, result.crossings, 0.1);
+
+    EXPECT_EQ(time_type(1.0), result.sample_time[0]);
+    EXPECT_EQ(time_type(7.3), result.sample_time[1]);
+    EXPECT_EQ(time_type(29.9), result.sample_time[2]);
+
+    // The unstimulated cell takes steps of the maximum size.
+    EXPECT_EQ(0.5, state.dt_next[1]);
+    EXPECT_EQ(0., fixed.state().dt_next[1]);
+}
+
+TEST(fvm_lowered, quiescence) {
+    // A cell at rest should skip integration until its current clamp is
+    // active, reproducing the spikes and samples of a cell that does not.
+
+    auto cell = make_cell_ball_and_stick(false);
+    cell.place(mlocation{1, 1}, i_clamp{60, 20, 0.3});
+    cell.place(mlocation{0, 0.5}, threshold_detector{-10});
+    std::vector<cable_cell> cells = {cell};
+
+    const double dt = 0.025;
+    const double t_epoch = 5;
+
+    struct run_result {
+        std::vector<fvm_value_type> crossing_times;
+        std::vector<fvm_value_type> sample_times;
+        std::vector<fvm_value_type> sample_values;
+        std::vector<bool> integrated;
+    };
+
+    auto run = [&](double tolerance) {
+        auto lowered = make_lowered(cells, [=](auto& p) { p.quiescence_tolerance = tolerance; });
+        const fvm_value_type* soma_v = lowered.state().voltage.data();
+
+        run_result r;
+        for (double t = 0; t<100; t += t_epoch) {
+            auto result = integrate_lowered(lowered, t+t_epoch, dt, {},
+                {{time_type(t+1.3), 0, {soma_v, 0}}, {time_type(t+3.7), 0, {soma_v, 1}}});
+            for (auto& c: result.crossings) r.crossing_times.push_back(c.time);
+            util::append(r.sample_times, result.sample_time);
+            util::append(r.sample_values, result.sample_value);
+            r.integrated.push_back(result.integrated);
+        }
+        return r;
+    };
+
+    auto expected = run(0);
+    auto quiescent = run(1e-3);
+
+    EXPECT_FALSE(expected.crossing_times.empty());
+    ASSERT_EQ(expected.crossing_times.size(), quiescent.crossing_times.size());
+    for (auto i: util::count_along(expected.crossing_times)) {
+        EXPECT_NEAR(expected.crossing_times[i], quiescent.crossing_times[i], 1e-3);
+    }
+
+    // Skipped epochs take samples at the sample time rather than at the
+    // start of the step.
+    ASSERT_EQ(expected.sample_times.size(), quiescent.sample_times.size());
+    for (auto i: util::count_along(expected.sample_values)) {
+        EXPECT_NEAR(expected.sample_times[i], quiescent.sample_times[i], dt);
+        EXPECT_NEAR(expected.sample_values[i], quiescent.sample_values[i], 0.01);
+    }
+
+    // Epochs are skipped before the clamp is active, and integrated while
+    // it is active.
+    EXPECT_TRUE(util::all_of(expected.integrated, [](bool b) { return b; }));
+    for (unsigned i = 3; i<12; ++i) {
+        EXPECT_FALSE(quiescent.integrated[i]);
+    }
+    for (unsigned i = 12; i<16; ++i) {
+        EXPECT_TRUE(quiescent.integrated[i]);
+    }
+}
+
+TEST(fvm_lowered, quiescence_slow_synapse) {
+    // A large, leaky soma holds its voltage close to the equilibrium set by a
+    // slowly decaying synaptic conductance: the voltage changes by less than
+    // the tolerance per epoch long before the conductance does. Freezing the
+    // cell on the voltage alone would leave it about 0.4 mV from rest.
+
+    soma_cell_builder builder(800);
+    auto cell = builder.make_cell();
+    cell.paint("soma", mechanism_desc("pas").set("g", 0.01));
+    cell.place(mlocation{0, 0.5}, mechanism_desc("expsyn").set("tau", 200));
+    std::vector<cable_cell> cells = {cell};
+
+    const double dt = 0.025;
+    const double t_epoch = 5;
+
+    auto run = [&](double tolerance, std::vector<bool>& integrated) {
+        auto lowered = make_lowered(cells, [=](auto& p) { p.quiescence_tolerance = tolerance; });
+        const fvm_value_type* soma_v = lowered.state().voltage.data();
+
+        std::vector<fvm_value_type> trace;
+        for (double t = 0; t<2000; t += t_epoch) {
+            std::vector<deliverable_event> events;
+            if (t==0) events.push_back(deliverable_event(1, lowered.targets[0], 2000));
+
+            auto result = integrate_lowered(lowered, t+t_epoch, dt, events, {{time_type(t+2.5), 0, {soma_v, 0}}});
+            util::append(trace, result.sample_value);
+            integrated.push_back(result.integrated);
+        }
+        return trace;
+    };
+
+    std::vector<bool> expected_integrated, quiescent_integrated;
+    auto expected = run(0, expected_integrated);
+    auto quiescent = run(0.01, quiescent_integrated);
+
+    ASSERT_EQ(expected.size(), quiescent.size());
+    EXPECT_GT(expected[1]-expected.back(), 40);
+    for (auto i: util::count_along(expected)) {
+        EXPECT_NEAR(expected[i], quiescent[i], 0.05);
+    }
+
+    // The cell is frozen once the conductance has decayed.
+    EXPECT_FALSE(quiescent_integrated.back());
+}
+
+TEST(fvm_lowered, renumber_cvs) {
+    // Renumbering CVs should not change spikes or samples beyond rounding.
+
+    struct renumber_recipe: cable1d_recipe {
+        renumber_recipe(const std::vector<cable_cell>& cells, bool renumber): cable1d_recipe(cells) {
+            cell_gprop_.renumber_cvs = renumber;
+        }
+    };
+
+    soma_cell_builder builder(6);
+    builder.add_branch(0, 200, 0.5, 0.5, 4, "dend");
+    builder.add_branch(0, 100, 0.5, 0.5, 2, "dend");
+    builder.add_branch(1, 100, 0.5, 0.5, 5, "dend");
+    builder.add_branch(1, 100, 0.5, 0.5, 2, "dend");
+    auto cell = builder.make_cell();
+    cell.paint("soma", "hh");
+    cell.paint("dend", "pas");
+    cell.place(mlocation{3, 0.7}, i_clamp{5, 80, 0.6});
+    cell.place(mlocation{2, 1}, i_clamp{20, 10, -0.2});
+    cell.place(mlocation{0, 0.5}, threshold_detector{-10});
+    std::vector<cable_cell> cells = {cell, make_cell_ball_and_stick()};
+
+    auto run = [&](bool renumber) {
+        renumber_recipe rec(cells, renumber);
+        for (cell_gid_type gid: {0, 1}) {
+            rec.add_probe(gid, 0, cell_probe_address{{1, 0.8}, cell_probe_address::membrane_voltage});
+        }
+
+        auto ctx = make_context();
+        auto decomp = partition_load_balance(rec, ctx);
+        simulation sim(rec, decomp, ctx);
+
+        std::vector<double> samples;
+        sim.add_sampler(all_probes, regular_schedule(1.0),
+            [&](cell_member_type, probe_tag, std::size_t n, const sample_record* records) {
+                for (std::size_t i = 0; i<n; ++i) {
+                    samples.push_back(*util::any_cast<const double*>(records[i].data));
+                }
+            });
+
+        std::vector<spike> spikes;
+        sim.set_global_spike_callback(
+            [&](const std::vector<spike>& s) { spikes.insert(spikes.end(), s.begin(), s.end()); });
+        sim.run(50, 0.025);
+        util::sort_by(spikes, [](const spike& s) { return s.time; });
+        return std::make_pair(spikes, samples);
+    };
+
+    auto expected = run(false);
+    auto renumbered = run(true);
+
+    EXPECT_FALSE(expected.first.empty());
+    ASSERT_EQ(expected.first.size(), renumbered.first.size());
+    for (auto i: util::count_along(expected.first)) {
+        EXPECT_EQ(expected.first[i].source, renumbered.first[i].source);
+        EXPECT_NEAR(expected.first[i].time, renumbered.first[i].time, 1e-4);
+    }
+
+    ASSERT_EQ(expected.second.size(), renumbered.second.size());
+    for (auto i: util::count_along(expected.second)) {
+        EXPECT_NEAR(expected.second[i], renumbered.second[i], 1e-6);
+    }
+}
+
+TEST(fvm_lowered, implicit_gap_junctions) {
+    // Two cells with a gap junction too strong for explicit coupling at
+    // dt = 0.025 ms should, with implicit coupling, reproduce the spikes of
+    // explicit coupling with a small time step.
+
+    struct gj_recipe: lowered_recipe {
+        using lowered_recipe::lowered_recipe;
+
+        std::vector<gap_junction_connection> gap_junctions_on(cell_gid_type gid) const override {
+            return {gap_junction_connection({gid, 0}, {1-gid, 0}, 5.)};
+        }
+    };
+
+    std::vector<cable_cell> cells = {make_cell_soma_only(false), make_cell_soma_only(false)};
+    cells[0].place(mlocation{0, 0.5}, i_clamp{5, 80, 0.3});
+    for (auto& c: cells) {
+        c.place(mlocation{0, 0.5}, gap_junction_site{});
+        c.place(mlocation{0, 0.5}, threshold_detector{-10});
+    }
+
+    auto run = [&](double dt, bool implicit, unsigned iterations) {
+        gj_recipe rec(cells, [=](auto& p) {
+            p.implicit_gap_junctions = implicit;
+            p.gap_junction_iterations = iterations;
+        });
+        return integrate_lowered(make_lowered(rec), 100, dt);
+    };
+
+    auto expected = run(0.001, false, 0).crossings;
+    EXPECT_GT(expected.size(), 4u);
+
+    // Explicit coupling is unstable.
+    auto explicit_v = run(0.025, false, 0).voltage;
+    EXPECT_FALSE(util::all_of(explicit_v, [](double v) { return std::abs(v)<200; }));
+
+    // Two junction CVs: converged after three iterations.
+    for (unsigned iterations: {3u, 10u}) {
+        SCOPED_TRACE(iterations);
+        // Phase error of the larger step accumulates over the train.
+        expect_same_crossings(expected, run(0.025, true, iterations).crossings, 0.5);
+    }
+}
+
+TEST(fvm_lowered, step_tiles) {
+    // Integrating the cells tile by tile performs the same operations on
+    // each CV in the same order. Voltage samples, taken before the tiles of
+    // a step, do not stop the tiling.
+
+    std::vector<cable_cell> cells;
+    for (unsigned i = 0; i<4; ++i) {
+        auto c = i%2? make_cell_ball_and_3stick(false): make_cell_ball_and_stick(false);
+        c.place(mlocation{1, 1}, i_clamp{2, 30, 0.2+0.1*i});
+        c.place(mlocation{1, 0.5}, "expsyn");
+        c.place(mlocation{0, 0.5}, threshold_detector{-10});
+        cells.push_back(std::move(c));
+    }
+
+    auto run = [&](std::size_t tile_bytes, std::size_t expected_tiles) {
+        auto lowered = make_lowered(cells, [=](auto& p) { p.step_tile_bytes = tile_bytes; });
+        EXPECT_EQ(expected_tiles, (lowered.cell.get()->*private_step_tiles_ptr).size());
+
+        std::vector<deliverable_event> events;
+        for (auto i: util::count_along(lowered.targets)) {
+            events.push_back(deliverable_event(10+2*i, lowered.targets[i], 0.05));
+        }
+        util::sort_by(events, [](const deliverable_event& ev) { return event_index(ev); });
+
+        // Sample the last CV of each cell every 2.5 ms. (The CV to intdom
+        // map is padded to the SIMD width.)
+        auto& state = lowered.state();
+        std::vector<sample_event> samples;
+        for (fvm_size_type cv = 0; cv<state.n_cv; ++cv) {
+            auto intdom = state.cv_to_intdom[cv];
+            if (cv+1<state.n_cv && state.cv_to_intdom[cv+1]==intdom) continue;
+
+            for (unsigned k = 1; k<16; ++k) {
+                samples.push_back({2.5*k, cell_size_type(intdom), {state.voltage.data()+cv, sample_size_type(samples.size())}});
+            }
+        }
+
+        return integrate_lowered(lowered, 40, 0.025, events, samples);
+    };
+
+    auto expected = run(0, 0);
+    EXPECT_GT(expected.crossings.size(), 4u);
+    EXPECT_EQ(60u, expected.sample_value.size());
+    EXPECT_NEAR(37.5, expected.sample_time.back(), 0.025);
+
+    // One tile per cell.
+    expect_same_split(expected, run(1, 4));
+}
+
+// Spike times with Crank-Nicolson steps should converge to those of a fine
+// step reference much faster than with implicit Euler steps: with the
+// mechanism states staggered by half a step, the error is second order in dt
+// with Hodgkin-Huxley channels active. The steps of the convergence test are
+// powers of two, so that the clamp onset falls exactly on a step boundary.
+
+TEST(fvm_lowered, crank_nicolson) {
+    std::vector<cable_cell> cells = {make_cell_ball_and_stick(false)};
+    cells[0].place(mlocation{1, 1}, i_clamp{2, 100, 0.3});
+    cells[0].place(mlocation{0, 0.5}, threshold_detector{-10});
+
+    auto spike_times = [&](double dt, integration_scheme s) {
+        std::vector<double> times;
+        for (auto& c: run_lowered(cells, [=](auto& p) { p.integrator = s; }, 50, dt).crossings) {
+            times.push_back(c.time);
+        }
+        return times;
+    };
+
+    auto max_error = [](const std::vector<double>& a, const std::vector<double>& b) {
+        EXPECT_EQ(a.size(), b.size());
+        double e = 0;
+        for (unsigned i = 0; i<std::min(a.size(), b.size()); ++i) {
+            e = std::max(e, std::abs(a[i]-b[i]));
+        }
+        return e;
+    };
+
+    auto ref = spike_times(1./4096, integration_scheme::crank_nicolson);
+    ASSERT_LT(1u, ref.size());
+    EXPECT_LT(max_error(ref, spike_times(1./4096, integration_scheme::implicit_euler)), 0.01);
+
+    double be_error = max_error(ref, spike_times(0.025, integration_scheme::implicit_euler));
+    double cn_error = max_error(ref, spike_times(0.1, integration_scheme::crank_nicolson));
+    EXPECT_LT(cn_error, 0.1);
+    EXPECT_LT(cn_error, be_error);
+
+    double last_error = max_error(ref, spike_times(1./8, integration_scheme::crank_nicolson));
+    for (double dt: {1./16, 1./32, 1./64}) {
+        SCOPED_TRACE(dt);
+        double error = max_error(ref, spike_times(dt, integration_scheme::crank_nicolson));
+        EXPECT_GT(last_error/error, 3.);
+        last_error = error;
+    }
+}
+
+// Spike times of a Hodgkin-Huxley ball and stick cell, as recorded with double
+// precision mechanism state. In a build with ARB_MIXED_PRECISION, this checks
+// the single precision mechanism state against the double precision build.
+
+TEST(fvm_lowered, state_precision) {
+    std::vector<cable_cell> cells = {make_cell_ball_and_stick(false)};
+    cells[0].place(mlocation{1, 1}, i_clamp{2, 100, 0.3});
+    cells[0].place(mlocation{0, 0.5}, threshold_detector{-10});
+
+    std::vector<double> times;
+    for (auto& c: run_lowered(cells, {}, 50).crossings) {
+        times.push_back(c.time);
+    }
+
+    std::vector<double> expected = {3.574737, 16.252748, 28.577093, 40.877577};
+    ASSERT_EQ(expected.size(), times.size());
+    for (auto i: util::count_along(times)) {
+        EXPECT_NEAR(expected[i], times[i], 1e-3);
+    }
+}
+
+// Only mechanisms and ion state with changing inputs should be updated in each
+// step: here the calcium current and concentration are written, while sodium
+// is only read.
+
+TEST(fvm_lowered, step_phases) {
+    mechanism_desc ica("fixed_ica_current");
+    ica["ica_density"] = 1.5;
+    mechanism_desc cai("linear_ca_conc");
+    cai["coeff"] = 0.5;
+
+    soma_cell_builder b(6);
+    auto c = b.make_cell();
+    c.paint("soma", ica);
+    c.paint("soma", cai);
+    c.paint("soma", "read_eX/x=ca");
+    c.paint("soma", "read_eX/x=na");
+
+    struct revpot_recipe: cable1d_recipe {
+        revpot_recipe(cable_cell c): cable1d_recipe(std::move(c)) {
+            catalogue() = make_unit_test_catalogue();
+            cell_gprop_.default_parameters.reversal_potential_method["ca"] = "write_eX/ca";
+            cell_gprop_.default_parameters.reversal_potential_method["na"] = "write_eX/na";
+        }
+    };
+    revpot_recipe rec(std::move(c));
+
+    auto lowered = make_lowered(rec);
+    auto& fvcell = *lowered.cell;
+    auto& state = lowered.state();
+    auto& ca = state.ion_data.at("ca");
+    auto& na = state.ion_data.at("na");
+
+    EXPECT_TRUE(ca.write_current);
+    EXPECT_TRUE(ca.write_concentration);
+    EXPECT_FALSE(na.write_current);
+    EXPECT_FALSE(na.write_concentration);
+
+    // Ion dependencies that do not say otherwise write the current.
+    EXPECT_TRUE(ion_dependency{}.write_current);
+
+    auto& step_revpot = fvcell.*private_step_revpot_ptr;
+    ASSERT_EQ(1u, step_revpot.size());
+    EXPECT_EQ("write_eX", step_revpot[0]->internal_name());
+
+    auto& writers = fvcell.*private_concentration_writers_ptr;
+    ASSERT_EQ(1u, writers.size());
+    EXPECT_EQ(find_mechanism(fvcell, "linear_ca_conc"), writers[0]);
+
+    // The sodium reversal potential is set on reset and not recomputed; the
+    // calcium reversal potential follows the concentration.
+
+    double ena = na.eX_[0];
+    EXPECT_EQ(100+na.Xi_[0], ena);
+
+    (void)fvcell.integrate(1, 0.1, {}, {});
+    EXPECT_EQ(ena, na.eX_[0]);
+    EXPECT_NE(100+ca.init_Xi_[0], ca.eX_[0]);
+}
+
+TEST(fvm_lowered, zz_experiment) {
+    auto report = [](const char* name, std::vector<cable_cell> cells, double tfinal) {
+        for (double tol: {0., 0.01, 0.1}) {
+            auto lowered = make_lowered(cells, [=](auto& p) {
+                p.adaptive_dt_tolerance = tol;
+                p.adaptive_dt_max = 0.5;
+            });
+            auto r = integrate_lowered(lowered, tfinal, 0.025);
+            std::cout << name << " tol " << tol << ":";
+            for (auto& c: r.crossings) std::cout << " " << c.time;
+            std::cout << "\n";
+        }
+    };
+
+    for (double gka: {0.02, 0.05, 0.1}) {
+        for (double amp: {0.05, 0.1, 0.2}) {
+            soma_cell_builder builder(10);
+            auto cell = builder.make_cell();
+            cell.paint("soma", "hh");
+            cell.paint("soma", mechanism_desc("kamt").set("gbar", gka));
+            cell.place(mlocation{0, 0.5}, i_clamp{5, 300, amp});
+            cell.place(mlocation{0, 0.5}, threshold_detector{-10});
+            std::cout << "A gka " << gka << " amp " << amp << "\n";
+            report("A", {cell}, 300);
+        }
+    }
+
+    for (double amp: {-0.02, -0.05, -0.1}) {
+        soma_cell_builder builder(10);
+        auto cell = builder.make_cell();
+        cell.paint("soma", "test_kinlva");
+        cell.paint("soma", mechanism_desc("hh").set("gnabar", 0.06).set("gkbar", 0.012).set("gl", 0));
+        cell.place(mlocation{0, 0.5}, i_clamp{5, 100, amp});
+        cell.place(mlocation{0, 0.5}, threshold_detector{-10});
+        std::cout << "B amp " << amp << "\n";
+        report("B", {cell}, 300);
+    }
+}
@@ -57,6 +57,14 @@ TEST(local_context, gather)
     EXPECT_EQ(std::vector<std::string>{"42"}, ctx.gather(std::string("42"), 0));
 }
 
+TEST(local_context, gather_all)
+{
+    arb::local_context ctx;
+
+    EXPECT_EQ(std::vector<int>{42}, ctx.gather_all(42));
+    EXPECT_EQ(std::vector<double>{42}, ctx.gather_all(42.));
+}
+
 TEST(local_context, gather_spikes)
 {
     arb::local_context ctx;
@@ -93,3 +101,17 @@ TEST(local_context, gather_gids)
     EXPECT_EQ(part[0], 0u);
     EXPECT_EQ(part[1], gids.size());
 }
+
+TEST(local_context, gather_bytes)
+{
+    arb::local_context ctx;
+    std::vector<char> bytes = {'a', 'r', 'b'};
+
+    auto s = ctx.gather_bytes(bytes);
+
+    auto& part = s.partition();
+    EXPECT_EQ(s.values(), bytes);
+    EXPECT_EQ(part.size(), 2u);
+    EXPECT_EQ(part[0], 0u);
+    EXPECT_EQ(part[1], bytes.size());
+}
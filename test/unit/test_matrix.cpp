@@ -1,4 +1,7 @@
+#include <algorithm>
 #include <numeric>
+#include <random>
+#include <tuple>
 #include <vector>
 
 #include "../gtest.h"
@@ -7,6 +10,7 @@
 
 #include "matrix.hpp"
 #include "backends/multicore/fvm.hpp"
+#include "threading/threading.hpp"
 #include "util/rangeutil.hpp"
 #include "util/span.hpp"
 
@@ -114,6 +118,33 @@ TEST(matrix, zero_diagonal)
     EXPECT_TRUE(testing::seq_almost_eq<double>(expected, x));
 }
 
+TEST(matrix, solve_cell_blocks)
+{
+    // Same system as zero_diagonal, solved with the cells split into blocks
+    // that are run in parallel.
+
+    using util::assign;
+
+    std::vector<index_type> p = {0, 0, 1, 3, 3, 5, 5};
+    std::vector<index_type> c = {0, 3, 5, 7};
+    std::vector<index_type> i = {0, 1, 2};
+    std::vector<value_type> expected = {4, 5, 6, 7, 8, 9, 10};
+
+    auto threads = std::make_shared<threading::task_system>(2);
+    for (unsigned n_blocks: {1u, 2u, 3u, 8u}) {
+        matrix_type m(p, c, vvec(7), vvec(7), vvec(7), i);
+        m.state_.set_cell_blocks(n_blocks, threads);
+
+        auto& A = m.state_;
+        assign(A.d,   vvec({2,  3,  2, 0,  0,  4,  5}));
+        assign(A.u,   vvec({0, -1, -1, 0, -1,  0, -2}));
+        assign(A.rhs, vvec({3,  5,  7, 7,  8, 16, 32}));
+
+        m.solve();
+        EXPECT_TRUE(testing::seq_almost_eq<double>(expected, m.solution()));
+    }
+}
+
 TEST(matrix, zero_diagonal_assembled)
 {
     // Use assemble method to construct same zero-diagonal
@@ -182,3 +213,321 @@ TEST(matrix, zero_diagonal_assembled)
     EXPECT_TRUE(testing::seq_almost_eq<double>(expected, x));
 }
 
+
+TEST(matrix, interleaved)
+{
+    // Interleaved assembly and solution should match the flat matrix state
+    // for branching cells of assorted sizes, including cells with zero dt.
+
+    using util::assign;
+    using array = matrix_type::array;
+    using interleaved_type = matrix<multicore::backend, multicore::matrix_state_interleaved<value_type, index_type>>;
+
+    auto gen = std::mt19937();
+    std::uniform_real_distribution<value_type> dist(0.5, 2);
+
+    std::vector<index_type> p, c = {0}, s;
+    for (index_type cell: util::make_span(13)) {
+        index_type first = c.back();
+        index_type n = 1+(cell*7)%17;
+        p.push_back(first);
+        for (index_type i = 1; i<n; ++i) {
+            p.push_back(first+std::uniform_int_distribution<index_type>(0, i-1)(gen));
+        }
+        c.push_back(first+n);
+        s.push_back(cell%5);
+    }
+    const auto ncv = p.size();
+
+    vvec Cm(ncv), g(ncv), area(ncv);
+    array v(ncv), i(ncv), mg(ncv);
+    for (auto k: util::make_span(ncv)) {
+        Cm[k] = dist(gen);
+        g[k] = dist(gen);
+        area[k] = dist(gen);
+        v[k] = -60*dist(gen);
+        i[k] = dist(gen)-1;
+        mg[k] = dist(gen);
+    }
+    // No face conductance at the root of a cell.
+    for (auto k: util::make_span(c.size()-1)) {
+        g[c[k]] = 0;
+    }
+    array dt = {0.025, 0, 0.01, 0.025, 0};
+
+    // Contractions into fused multiply-adds can differ between the scalar
+    // and SIMD solvers.
+    auto near = [](const vvec& a, const array& b) {
+        for (auto k: util::make_span(a.size())) {
+            if (std::abs(a[k]-b[k])>1e-12*std::abs(a[k])) return false;
+        }
+        return a.size()==b.size();
+    };
+
+    matrix_type flat(p, c, Cm, g, area, s);
+    flat.assemble(dt, v, i, mg);
+    flat.solve();
+    vvec expected;
+    assign(expected, flat.solution());
+
+    interleaved_type m(p, c, Cm, g, area, s);
+    m.assemble(dt, v, i, mg);
+    m.solve();
+    EXPECT_TRUE(near(expected, m.solution()));
+
+    for (auto k: util::make_span(ncv)) {
+        if (dt[s[std::upper_bound(c.begin(), c.end(), k)-c.begin()-1]]==0) {
+            EXPECT_EQ(v[k], m.solution()[k]);
+        }
+    }
+
+    // Interleaving through the flat matrix state, with blocks solved in
+    // parallel.
+    auto threads = std::make_shared<threading::task_system>(2);
+    for (unsigned n_blocks: {1u, 2u, 8u}) {
+        matrix_type mi(p, c, Cm, g, area, s);
+        mi.state_.set_interleaved(true);
+        mi.state_.set_cell_blocks(n_blocks, threads);
+        mi.assemble(dt, v, i, mg);
+        mi.solve();
+        EXPECT_TRUE(near(expected, mi.solution()));
+    }
+}
+
+TEST(matrix, branch_parallel)
+{
+    // Branch by branch solution should match the flat matrix state for a
+    // large branching cell and small cells, including cells with zero dt,
+    // with the levels solved serially and in parallel.
+
+    using util::assign;
+    using array = matrix_type::array;
+    using fine_type = matrix<multicore::backend, multicore::matrix_state_fine<value_type, index_type>>;
+
+    auto gen = std::mt19937();
+    std::uniform_real_distribution<value_type> dist(0.5, 2);
+
+    std::vector<index_type> p, c = {0}, s;
+    for (index_type cell: util::make_span(6)) {
+        index_type first = c.back();
+        index_type n = cell? 1+(cell*7)%17: 20000;
+        p.push_back(first);
+        for (index_type i = 1; i<n; ++i) {
+            // Unbranched runs with branch points, some not following their
+            // parent directly.
+            p.push_back(first+(i%5? i-1: std::uniform_int_distribution<index_type>(0, i-1)(gen)));
+        }
+        c.push_back(first+n);
+        s.push_back(cell%3);
+    }
+    const auto ncv = p.size();
+
+    vvec Cm(ncv), g(ncv), area(ncv);
+    array v(ncv), i(ncv), mg(ncv);
+    for (auto k: util::make_span(ncv)) {
+        Cm[k] = dist(gen);
+        g[k] = dist(gen);
+        area[k] = dist(gen);
+        v[k] = -60*dist(gen);
+        i[k] = dist(gen)-1;
+        mg[k] = dist(gen);
+    }
+    array dt = {0.025, 0, 0.01};
+
+    // Contributions to branch points are summed in a different order.
+    auto near = [](const vvec& a, const array& b) {
+        for (auto k: util::make_span(a.size())) {
+            if (std::abs(a[k]-b[k])>1e-12*std::abs(a[k])) return false;
+        }
+        return a.size()==b.size();
+    };
+
+    matrix_type flat(p, c, Cm, g, area, s);
+    flat.assemble(dt, v, i, mg);
+    flat.solve();
+    vvec expected;
+    assign(expected, flat.solution());
+
+    fine_type m(p, c, Cm, g, area, s);
+    EXPECT_GT(m.state_.level_divs.size(), 3u);
+    m.assemble(dt, v, i, mg);
+    m.solve();
+    EXPECT_TRUE(near(expected, m.solution()));
+
+    for (auto k: util::make_span(ncv)) {
+        if (dt[s[std::upper_bound(c.begin(), c.end(), k)-c.begin()-1]]==0) {
+            EXPECT_EQ(v[k], m.solution()[k]);
+        }
+    }
+
+    // Through the flat matrix state, with levels split into parallel tasks.
+    auto threads = std::make_shared<threading::task_system>(4);
+    for (unsigned n_blocks: {1u, 3u, 16u}) {
+        matrix_type mb(p, c, Cm, g, area, s);
+        mb.state_.set_branch_parallel(true);
+        mb.state_.set_interleaved(true);
+        mb.state_.set_cell_blocks(n_blocks, threads);
+        mb.assemble(dt, v, i, mg);
+        mb.solve();
+        EXPECT_TRUE(near(expected, mb.solution()));
+    }
+}
+
+TEST(matrix, implicit_gap_junctions)
+{
+    // The solution with implicit gap junctions should satisfy the equations
+    // of the cells coupled by the junction conductances, with the voltage
+    // of cells with zero dt held fixed.
+
+    using array = matrix_type::array;
+
+    auto gen = std::mt19937();
+    std::uniform_real_distribution<value_type> dist(0.5, 2);
+
+    std::vector<index_type> p, c = {0}, s = {0, 1, 2, 0};
+    for (index_type cell: util::make_span(4)) {
+        index_type first = c.back();
+        index_type n = 5+3*cell;
+        p.push_back(first);
+        for (index_type i = 1; i<n; ++i) {
+            p.push_back(first+std::uniform_int_distribution<index_type>(0, i-1)(gen));
+        }
+        c.push_back(first+n);
+    }
+    const index_type ncv = p.size();
+
+    vvec Cm(ncv), g(ncv), area(ncv);
+    array v(ncv), i(ncv), mg(ncv);
+    for (auto k: util::make_span(ncv)) {
+        Cm[k] = dist(gen);
+        g[k] = dist(gen);
+        area[k] = dist(gen);
+        v[k] = -60*dist(gen);
+        i[k] = dist(gen)-1;
+        mg[k] = dist(gen);
+    }
+    for (auto k: util::make_span(c.size()-1)) {
+        g[c[k]] = 0;
+    }
+    array dt = {0.025, 0.025, 0};
+
+    // Strong junctions [μS] between cells 0, 1 and 3, and to cell 2, which
+    // is not integrated.
+    std::vector<std::tuple<index_type, index_type, value_type>> junctions = {
+        {2, c[1]+4, 50.}, {c[1], c[3]+1, 20.}, {c[3]+6, 3, 80.}, {c[1]+1, c[2]+2, 10.}
+    };
+    std::vector<fvm_gap_junction> gj;
+    for (auto& j: junctions) {
+        auto a = std::get<0>(j), b = std::get<1>(j);
+        auto ggap = std::get<2>(j);
+        gj.push_back(fvm_gap_junction({a, b}, ggap*1e3/area[a]));
+        gj.push_back(fvm_gap_junction({b, a}, ggap*1e3/area[b]));
+    }
+
+    matrix_type m(p, c, Cm, g, area, s);
+    m.state_.set_gap_junctions(gj, 0, ncv);
+    m.assemble(dt, v, i, mg);
+    m.solve();
+    auto& x = m.solution();
+
+    // Residual of each equation.
+    auto cell_of = [&](index_type k) { return std::upper_bound(c.begin(), c.end(), k)-c.begin()-1; };
+    vvec res(ncv, 0);
+    for (auto k: util::make_span(ncv)) {
+        auto dtk = dt[s[cell_of(k)]];
+        if (dtk==0) continue;
+        auto gk = 1e-3/dtk*Cm[k] + 1e-3*area[k]*mg[k];
+        res[k] += gk*(x[k]-v[k]) + 1e-3*area[k]*i[k];
+        if (k!=p[k]) {
+            res[k] += g[k]*(x[k]-x[p[k]]);
+            res[p[k]] += g[k]*(x[p[k]]-x[k]);
+        }
+    }
+    for (auto& j: junctions) {
+        auto a = std::get<0>(j), b = std::get<1>(j);
+        auto ggap = std::get<2>(j);
+        if (dt[s[cell_of(a)]]) res[a] += ggap*(x[a]-x[b]);
+        if (dt[s[cell_of(b)]]) res[b] += ggap*(x[b]-x[a]);
+    }
+    for (auto k: util::make_span(ncv)) {
+        EXPECT_NEAR(0, res[k], 1e-9);
+    }
+
+    for (auto k: util::make_span(c[2], c[3])) {
+        EXPECT_EQ(v[k], x[k]);
+    }
+
+    // Without iterations, the cells are coupled only through the junction
+    // conductance at their own CVs.
+    matrix_type m0(p, c, Cm, g, area, s);
+    m0.state_.set_gap_junctions(gj, 0, 0);
+    m0.assemble(dt, v, i, mg);
+    m0.solve();
+    EXPECT_GT(std::abs(m0.solution()[2]-x[2]), 1e-3);
+}
+
+TEST(matrix, implicit_gap_junctions_out_of_step)
+{
+    // Two pairs of coupled cells in separate integration domains: when one
+    // domain has zero dt in a step, the voltage of its cells should be held
+    // fixed, even with iteration state left over from the previous step.
+
+    using array = matrix_type::array;
+
+    auto gen = std::mt19937();
+    std::uniform_real_distribution<value_type> dist(0.5, 2);
+
+    std::vector<index_type> p, c = {0}, s = {0, 0, 1, 1};
+    for (index_type cell: util::make_span(4)) {
+        index_type first = c.back();
+        index_type n = 4+2*cell;
+        p.push_back(first);
+        for (index_type i = 1; i<n; ++i) {
+            p.push_back(first+std::uniform_int_distribution<index_type>(0, i-1)(gen));
+        }
+        c.push_back(first+n);
+    }
+    const index_type ncv = p.size();
+
+    vvec Cm(ncv), g(ncv), area(ncv);
+    array v(ncv), i(ncv), mg(ncv);
+    for (auto k: util::make_span(ncv)) {
+        Cm[k] = dist(gen);
+        g[k] = dist(gen);
+        area[k] = dist(gen);
+        v[k] = -60*dist(gen);
+        i[k] = dist(gen)-1;
+        mg[k] = dist(gen);
+    }
+    for (auto k: util::make_span(c.size()-1)) {
+        g[c[k]] = 0;
+    }
+
+    std::vector<std::tuple<index_type, index_type, value_type>> junctions = {
+        {c[0]+2, c[1]+3, 50.}, {c[2]+1, c[3]+4, 80.}
+    };
+    std::vector<fvm_gap_junction> gj;
+    for (auto& j: junctions) {
+        auto a = std::get<0>(j), b = std::get<1>(j);
+        auto ggap = std::get<2>(j);
+        gj.push_back(fvm_gap_junction({a, b}, ggap*1e3/area[a]));
+        gj.push_back(fvm_gap_junction({b, a}, ggap*1e3/area[b]));
+    }
+
+    // Stop short of convergence, so that the last search direction of each
+    // step is far from zero.
+    matrix_type m(p, c, Cm, g, area, s);
+    m.state_.set_gap_junctions(gj, 0, 2);
+
+    m.assemble(array{0.025, 0.025}, v, i, mg);
+    m.solve();
+    array x1 = m.solution();
+
+    m.assemble(array{0.025, 0}, x1, i, mg);
+    m.solve();
+    auto& x2 = m.solution();
+
+    for (auto k: util::make_span(c[2], c[4])) {
+        EXPECT_EQ(x1[k], x2[k]);
+    }
+}
@@ -54,14 +54,14 @@ void run_celsius_test() {
     celsius_test->initialize();
     std::vector<fvm_value_type> expected_c_values(ncv, 0.);
 
-    EXPECT_EQ(expected_c_values, mechanism_field(celsius_test.get(), "c"));
+    EXPECT_TRUE(testing::seq_almost_eq<fvm_state_type>(expected_c_values, mechanism_field(celsius_test.get(), "c")));
 
     // expect temperature_C value in state 'c' after state update:
 
     celsius_test->nrn_state();
     expected_c_values.assign(ncv, temperature_C);
 
-    EXPECT_EQ(expected_c_values, mechanism_field(celsius_test.get(), "c"));
+    EXPECT_TRUE(testing::seq_almost_eq<fvm_state_type>(expected_c_values, mechanism_field(celsius_test.get(), "c")));
 }
 
 template <typename backend>
@@ -104,14 +104,14 @@ void run_diam_test() {
     celsius_test->initialize();
     std::vector<fvm_value_type> expected_d_values(ncv, 0.);
 
-    EXPECT_EQ(expected_d_values, mechanism_field(celsius_test.get(), "d"));
+    EXPECT_TRUE(testing::seq_almost_eq<fvm_state_type>(expected_d_values, mechanism_field(celsius_test.get(), "d")));
 
     // expect original diam values in state 'd' after state update:
 
     celsius_test->nrn_state();
     expected_d_values = diam;
 
-    EXPECT_EQ(expected_d_values, mechanism_field(celsius_test.get(), "d"));
+    EXPECT_TRUE(testing::seq_almost_eq<fvm_state_type>(expected_d_values, mechanism_field(celsius_test.get(), "d")));
 }
 
 TEST(mech_temperature, celsius) {
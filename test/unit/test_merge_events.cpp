@@ -273,3 +273,38 @@ TEST(merge_events, tourney_poisson)
     EXPECT_TRUE(std::is_sorted(lf.begin(), lf.end()));
     EXPECT_EQ(lf, expected);
 }
+
+// Test that a tournament tree can be reused for successive merges.
+TEST(merge_events, tourney_reset)
+{
+    pse_vector evs1 = {{{0, 0}, 1, 0}, {{0, 0}, 3, 0}};
+    pse_vector evs2 = {{{0, 1}, 2, 0}};
+    pse_vector evs3 = {{{0, 2}, 0.5, 0}, {{0, 2}, 1.5, 0}, {{0, 2}, 4, 0}};
+
+    auto drain = [](impl::basic_tourney_tree<spike_event>& tree) {
+        pse_vector out;
+        while (!tree.empty()) {
+            out.push_back(tree.head());
+            tree.pop();
+        }
+        return out;
+    };
+
+    impl::basic_tourney_tree<spike_event> tree(impl::terminal_pse);
+
+    std::vector<event_span> spans = {util::range_pointer_view(evs1), util::range_pointer_view(evs2)};
+    tree.reset(spans);
+    pse_vector expected = evs1;
+    util::append(expected, evs2);
+    util::sort(expected);
+    EXPECT_EQ(expected, drain(tree));
+
+    // Merge a different number of lanes, including an empty one.
+    pse_vector empty;
+    spans = {util::range_pointer_view(evs3), util::range_pointer_view(empty), util::range_pointer_view(evs2)};
+    tree.reset(spans);
+    expected = evs3;
+    util::append(expected, evs2);
+    util::sort(expected);
+    EXPECT_EQ(expected, drain(tree));
+}
@@ -86,3 +86,49 @@ TEST(probe, fvm_lowered_cell) {
     EXPECT_EQ(voltage[0], *p0);
 }
 
+
+TEST(probe, fvm_lowered_cell_snapshot) {
+    execution_context context;
+
+    std::vector<cable_cell> cells = {make_cell_ball_and_stick(false), make_cell_ball_and_stick(false)};
+    cells[1].place(mlocation{1, 1}, i_clamp(0, 100, 0.3));
+
+    cable1d_recipe rec(cells);
+    rec.add_probe(1, 10, cell_probe_address{mlocation{0, 0}, cell_probe_address::membrane_voltage_cell});
+    rec.add_probe(1, 20, cell_probe_address{mlocation{0, 0}, cell_probe_address::membrane_current_cell});
+
+    std::vector<target_handle> targets;
+    std::vector<fvm_index_type> cell_to_intdom;
+    probe_association_map<probe_handle> probe_map;
+
+    fvm_cell lcell(context);
+    lcell.initialize({0, 1}, rec, cell_to_intdom, targets, probe_map);
+
+    auto& state = *(lcell.*fvm_state_ptr).get();
+    auto ncv = state.voltage.size()/2;
+
+    // Whole-cell probes cover the CVs of the second cell.
+    auto pv = probe_map.at({1, 0});
+    auto pi = probe_map.at({1, 1});
+    EXPECT_EQ(ncv, pv.width);
+    EXPECT_EQ(ncv, pi.width);
+    EXPECT_EQ(state.voltage.data()+ncv, pv.handle);
+    EXPECT_EQ(state.current_density.data()+ncv, pi.handle);
+
+    // A sample event copies the whole range at the sample offset; at time
+    // zero, the voltage is the resting potential everywhere.
+    auto resting = state.voltage[0];
+    sample_size_type width = ncv;
+    std::vector<sample_event> samples = {
+        sample_event{0, 1, {pv.handle, 0, sample_op::assign, width}},
+        sample_event{0, 1, {pi.handle, width, sample_op::assign, width}}
+    };
+    auto result = lcell.integrate(0.01, 0.0025, {}, samples);
+
+    ASSERT_LE(2*ncv, result.sample_value.size());
+    EXPECT_EQ(0., result.sample_time[0]);
+    EXPECT_EQ(0., result.sample_time[ncv]);
+    for (unsigned i = 0; i<ncv; ++i) {
+        EXPECT_EQ(resting, result.sample_value[i]);
+    }
+}
@@ -0,0 +1,677 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arbor/context.hpp>
+#include <arbor/domain_decomposition.hpp>
+#include <arbor/event_generator.hpp>
+#include <arbor/load_balance.hpp>
+#include <arbor/sampling.hpp>
+#include <arbor/schedule.hpp>
+#include <arbor/simulation.hpp>
+
+#include "distributed_context.hpp"
+#include "execution_context.hpp"
+#include "util/rangeutil.hpp"
+#include "util/span.hpp"
+
+#include "../common_cells.hpp"
+#include "../simple_recipes.hpp"
+
+using namespace arb;
+
+namespace {
+    // Ball-and-stick cells with a spike detector on the soma; cell i is
+    // stimulated only if i is even, so that group costs differ.
+    cable1d_recipe make_recipe(unsigned n) {
+        std::vector<cable_cell> cells;
+        for (unsigned i = 0; i<n; ++i) {
+            auto c = make_cell_ball_and_stick(i%2==0);
+            c.place(mlocation{0, 0.5}, threshold_detector{-10});
+            cells.push_back(std::move(c));
+        }
+        return cable1d_recipe(cells);
+    }
+
+    // Ring of ball-and-stick cells in which each cell excites the next;
+    // cell 0 is stimulated, and all cells receive generated events.
+    class ring_recipe: public cable1d_recipe {
+    public:
+        ring_recipe(unsigned n): cable1d_recipe(make_cells(n)), n_(n) {}
+
+        std::vector<cell_connection> connections_on(cell_gid_type gid) const override {
+            return {cell_connection({(gid+n_-1)%n_, 0}, {gid, 0}, 0.05, 2)};
+        }
+
+        std::vector<event_generator> event_generators(cell_gid_type gid) const override {
+            return {regular_generator({gid, 0}, 0.02, 1+0.25*gid, 1.5)};
+        }
+
+    private:
+        unsigned n_;
+
+        static std::vector<cable_cell> make_cells(unsigned n) {
+            std::vector<cable_cell> cells;
+            for (unsigned i = 0; i<n; ++i) {
+                auto c = make_cell_ball_and_stick(i==0);
+                c.place(mlocation{0, 0.5}, threshold_detector{-10});
+                c.place(mlocation{1, 0.5}, "expsyn");
+                cells.push_back(std::move(c));
+            }
+            return cells;
+        }
+    };
+
+    // Ranks that run on threads of this process, for testing collective
+    // operations without MPI.
+    struct thread_ranks {
+        explicit thread_ranks(int n): size(n), slots(n) {}
+
+        int size;
+        std::mutex mutex;
+        std::condition_variable cv;
+        int arrived = 0;
+        unsigned generation = 0;
+        std::vector<std::vector<char>> slots;
+
+        void barrier() {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto g = generation;
+            if (++arrived==size) {
+                arrived = 0;
+                ++generation;
+                cv.notify_all();
+            }
+            else {
+                cv.wait(lock, [&] { return g!=generation; });
+            }
+        }
+    };
+
+    struct thread_rank_context {
+        std::shared_ptr<thread_ranks> ranks;
+        int rank;
+
+        template <typename T>
+        gathered_vector<T> gather_all_with_partition(const std::vector<T>& local) const {
+            using count_type = typename gathered_vector<T>::count_type;
+
+            auto p = reinterpret_cast<const char*>(local.data());
+            ranks->slots[rank].assign(p, p+local.size()*sizeof(T));
+            ranks->barrier();
+
+            std::vector<T> values;
+            std::vector<count_type> partition = {0};
+            for (auto& s: ranks->slots) {
+                auto n = values.size();
+                values.resize(n+s.size()/sizeof(T));
+                if (!s.empty()) std::memcpy(values.data()+n, s.data(), s.size());
+                partition.push_back(values.size());
+            }
+            ranks->barrier();
+
+            return gathered_vector<T>(std::move(values), std::move(partition));
+        }
+
+        gathered_vector<spike> gather_spikes(const std::vector<spike>& v) const {
+            return gather_all_with_partition(v);
+        }
+        gathered_vector<cell_gid_type> gather_gids(const std::vector<cell_gid_type>& v) const {
+            return gather_all_with_partition(v);
+        }
+        gathered_vector<cell_member_type> gather_gj_sites(const std::vector<cell_member_type>& v) const {
+            return gather_all_with_partition(v);
+        }
+        gathered_vector<fvm_value_type> gather_gj_voltages(const std::vector<fvm_value_type>& v) const {
+            return gather_all_with_partition(v);
+        }
+        gathered_vector<char> gather_bytes(const std::vector<char>& v) const {
+            return gather_all_with_partition(v);
+        }
+
+        template <typename T>
+        std::vector<T> gather_all(T value) const {
+            return gather_all_with_partition(std::vector<T>{value}).values();
+        }
+        template <typename T>
+        std::vector<T> gather(T value, int) const {
+            return gather_all(value);
+        }
+        std::vector<std::string> gather(std::string value, int) const {
+            auto g = gather_all_with_partition(std::vector<char>(value.begin(), value.end()));
+            std::vector<std::string> strings;
+            for (auto r: util::make_span(ranks->size)) {
+                strings.emplace_back(g.values().begin()+g.partition()[r], g.values().begin()+g.partition()[r+1]);
+            }
+            return strings;
+        }
+
+        template <typename T>
+        T min(T value) const { return util::minmax_value(gather_all(value)).first; }
+        template <typename T>
+        T max(T value) const { return util::max_value(gather_all(value)); }
+        template <typename T>
+        T sum(T value) const {
+            auto all = gather_all(value);
+            return std::accumulate(all.begin(), all.end(), T{});
+        }
+
+        int id() const { return rank; }
+        int size() const { return ranks->size; }
+        void barrier() const { ranks->barrier(); }
+        std::string name() const { return "threads"; }
+    };
+}
+
+TEST(simulation, rebalance) {
+    auto context = make_context();
+    auto rec = make_recipe(4);
+    auto decomp = partition_load_balance(rec, context);
+    simulation sim(rec, decomp, context);
+
+    auto times = sim.group_advance_times();
+    ASSERT_EQ(decomp.groups.size(), times.size());
+    for (auto t: times) {
+        EXPECT_EQ(0., t);
+    }
+
+    sim.run(20, 0.025);
+    auto n_spikes = sim.num_spikes();
+    EXPECT_LT(0u, n_spikes);
+
+    times = sim.group_advance_times();
+    EXPECT_TRUE(std::all_of(times.begin(), times.end(), [](double t) { return t>0; }));
+
+    // Rebalancing changes only the dispatch order: the timings restart,
+    // and a rerun gives the same results.
+    sim.rebalance(rec);
+    times = sim.group_advance_times();
+    EXPECT_TRUE(std::all_of(times.begin(), times.end(), [](double t) { return t==0; }));
+
+    sim.reset();
+    sim.run(20, 0.025);
+    EXPECT_EQ(n_spikes, sim.num_spikes());
+}
+
+TEST(simulation, rebalance_dispatch_order) {
+    // The second cell has many more CVs than the first, so that its group
+    // is dispatched first after rebalancing. With a single thread, the
+    // samplers are called in dispatch order.
+    soma_cell_builder builder(12.6157/2.0);
+    builder.add_branch(0, 200, 0.5, 0.5, 400, "dend");
+    auto big = builder.make_cell();
+    big.paint("soma", "hh");
+    big.paint("dend", "pas");
+
+    cable1d_recipe rec(std::vector<cable_cell>{make_cell_soma_only(), big});
+    for (cell_gid_type gid: {0u, 1u}) {
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_voltage});
+    }
+
+    domain_decomposition decomp;
+    decomp.gid_domain = [](cell_gid_type) { return 0; };
+    decomp.num_domains = 1;
+    decomp.domain_id = 0;
+    decomp.num_local_cells = 2;
+    decomp.num_global_cells = 2;
+    decomp.groups.push_back({cell_kind::cable, {0}, backend_kind::multicore});
+    decomp.groups.push_back({cell_kind::cable, {1}, backend_kind::multicore});
+
+    auto context = make_context();
+    simulation sim(rec, decomp, context);
+
+    std::vector<cell_gid_type> order;
+    sim.add_sampler(all_probes, regular_schedule(1),
+        [&](cell_member_type pid, probe_tag, std::size_t, const sample_record*) { order.push_back(pid.gid); });
+
+    sim.run(1, 0.025);
+    EXPECT_EQ((std::vector<cell_gid_type>{0, 1}), order);
+
+    auto times = sim.group_advance_times();
+    ASSERT_GT(times[1], times[0]);
+
+    sim.rebalance(rec);
+    order.clear();
+    sim.run(2, 0.025);
+    EXPECT_EQ((std::vector<cell_gid_type>{1, 0}), order);
+}
+
+TEST(simulation, rebalance_migrates_groups) {
+    // All cells start on the first of two ranks, run on threads, so that
+    // rebalancing moves groups to the second rank between the runs. The
+    // moved groups continue with their state, pending events, event
+    // generators and sampler windows: the spikes and samples are those of a
+    // simulation on a single rank.
+    const unsigned n = 4;
+    ring_recipe rec(n);
+    for (cell_gid_type gid = 0; gid<n; ++gid) {
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_voltage});
+    }
+
+    using trace = std::vector<std::pair<double, double>>;
+    struct result {
+        std::vector<std::pair<cell_member_type, time_type>> spikes;
+        std::map<cell_member_type, trace> samples, reduced;
+        std::vector<std::size_t> groups_before, groups_after;
+    };
+
+    auto simulate = [&](int n_rank, int rank, const context& ctx, result& out, std::mutex& mutex) {
+        domain_decomposition decomp;
+        decomp.gid_domain = [](cell_gid_type) { return 0; };
+        decomp.num_domains = n_rank;
+        decomp.domain_id = rank;
+        decomp.num_global_cells = n;
+        if (rank==0) {
+            for (cell_gid_type gid = 0; gid<n; ++gid) {
+                decomp.groups.push_back({cell_kind::cable, {gid}, backend_kind::multicore});
+            }
+        }
+        decomp.num_local_cells = decomp.groups.size();
+
+        simulation sim(rec, decomp, ctx);
+        sim.add_sampler(all_probes, regular_schedule(0.5),
+            [&](cell_member_type pid, probe_tag, std::size_t n, const sample_record* recs) {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (std::size_t i = 0; i<n; ++i) {
+                    out.samples[pid].push_back({recs[i].time, *util::any_cast<const double*>(recs[i].data)});
+                }
+            });
+        sim.add_sampler(all_probes, regular_schedule(0.5),
+            [&](cell_member_type pid, probe_tag, std::size_t n, const double* t, const double* v) {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (std::size_t i = 0; i<n; ++i) {
+                    out.reduced[pid].push_back({t[i], v[i]});
+                }
+            },
+            sample_reduction{sample_reduction_kind::mean, 3});
+        if (rank==0) {
+            sim.set_global_spike_callback(
+                [&](const std::vector<spike>& spikes) {
+                    for (auto& s: spikes) out.spikes.push_back({s.source, s.time});
+                });
+        }
+
+        sim.run(7.25, 0.025);
+
+        // Injected events are pending for the cells, moved or not.
+        pse_vector events;
+        for (cell_gid_type gid = 0; gid<n; ++gid) {
+            events.push_back({{gid, 0}, 8.5, 0.05});
+        }
+        sim.inject_events(events);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            out.groups_before.push_back(sim.group_advance_times().size());
+        }
+        sim.rebalance(rec);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            out.groups_after.push_back(sim.group_advance_times().size());
+        }
+        sim.run(20, 0.025);
+    };
+
+    std::mutex mutex;
+    result expected, distributed;
+    simulate(1, 0, make_context(), expected, mutex);
+
+    auto ranks = std::make_shared<thread_ranks>(2);
+    std::vector<std::thread> threads;
+    for (int r = 0; r<2; ++r) {
+        threads.emplace_back([&, r] {
+            auto ctx = make_context();
+            ctx->distributed = std::make_shared<distributed_context>(thread_rank_context{ranks, r});
+            simulate(2, r, ctx, distributed, mutex);
+        });
+    }
+    for (auto& t: threads) t.join();
+
+    // Rank 0 held all the groups, and now shares them with rank 1.
+    util::sort(distributed.groups_before);
+    util::sort(distributed.groups_after);
+    EXPECT_EQ((std::vector<std::size_t>{0, n}), distributed.groups_before);
+    ASSERT_EQ(2u, distributed.groups_after.size());
+    EXPECT_LT(0u, distributed.groups_after[0]);
+    EXPECT_EQ(n, distributed.groups_after[0]+distributed.groups_after[1]);
+
+    EXPECT_LT(0u, expected.spikes.size());
+    util::sort(expected.spikes);
+    util::sort(distributed.spikes);
+    EXPECT_EQ(expected.spikes, distributed.spikes);
+
+    EXPECT_EQ(n, expected.samples.size());
+    EXPECT_EQ(expected.samples, distributed.samples);
+    EXPECT_EQ(expected.reduced, distributed.reduced);
+}
+
+TEST(simulation, bulk_sampler) {
+    auto context = make_context();
+    auto rec = make_recipe(3);
+    for (cell_gid_type gid: {0u, 1u, 2u}) {
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_voltage});
+    }
+    auto decomp = partition_load_balance(rec, context);
+    simulation sim(rec, decomp, context);
+
+    // Record the same probes with a sampler and a bulk sampler.
+    using trace = std::vector<std::pair<time_type, double>>;
+    std::map<cell_member_type, trace> records, bulk;
+
+    sampler_function sampler = [&](cell_member_type pid, probe_tag, std::size_t n, const sample_record* recs) {
+        for (std::size_t i = 0; i<n; ++i) {
+            records[pid].push_back({recs[i].time, *util::any_cast<const double*>(recs[i].data)});
+        }
+    };
+    bulk_sampler_function bulk_sampler = [&](cell_member_type pid, probe_tag, std::size_t n, const double* t, const double* v) {
+        for (std::size_t i = 0; i<n; ++i) {
+            bulk[pid].push_back({time_type(t[i]), v[i]});
+        }
+    };
+
+    sim.add_sampler(all_probes, regular_schedule(0.5), sampler);
+    sim.add_sampler(all_probes, regular_schedule(0.5), bulk_sampler);
+    sim.run(10, 0.025);
+
+    EXPECT_EQ(3u, bulk.size());
+    EXPECT_EQ(20u, (bulk[cell_member_type{1, 0}].size()));
+    EXPECT_EQ(records, bulk);
+}
+
+TEST(simulation, reduced_bulk_sampler) {
+    auto context = make_context();
+    auto rec = make_recipe(2);
+    for (cell_gid_type gid: {0u, 1u}) {
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_voltage});
+    }
+    auto decomp = partition_load_balance(rec, context);
+    simulation sim(rec, decomp, context);
+
+    using trace = std::vector<std::pair<double, double>>;
+    auto recorder = [](std::map<cell_member_type, trace>& traces) {
+        return [&traces](cell_member_type pid, probe_tag, std::size_t n, const double* t, const double* v) {
+            for (std::size_t i = 0; i<n; ++i) {
+                traces[pid].push_back({t[i], v[i]});
+            }
+        };
+    };
+
+    const unsigned window = 4;
+    const sample_reduction_kind kinds[] = {
+        sample_reduction_kind::mean,
+        sample_reduction_kind::min,
+        sample_reduction_kind::max,
+        sample_reduction_kind::decimate
+    };
+
+    std::map<cell_member_type, trace> all;
+    std::map<cell_member_type, trace> reduced[4];
+
+    sim.add_sampler(all_probes, regular_schedule(0.5), recorder(all));
+    for (unsigned i = 0; i<4; ++i) {
+        sim.add_sampler(all_probes, regular_schedule(0.5), recorder(reduced[i]), sample_reduction{kinds[i], window});
+    }
+
+    // Windows of four samples span the epoch boundaries of the runs.
+    sim.run(3.25, 0.025);
+    sim.run(7, 0.025);
+    sim.run(10.25, 0.025);
+
+    for (auto& kv: all) {
+        const trace& samples = kv.second;
+        ASSERT_EQ(21u, samples.size());
+
+        for (unsigned i = 0; i<4; ++i) {
+            const trace& r = reduced[i][kv.first];
+            ASSERT_EQ(i==3? 6u: 5u, r.size());
+
+            for (unsigned w = 0; w<r.size(); ++w) {
+                auto first = samples.begin()+w*window;
+                double expected = first->second;
+                for (auto s = first+1; s!=first+window && i!=3; ++s) {
+                    switch (kinds[i]) {
+                    case sample_reduction_kind::mean: expected += s->second; break;
+                    case sample_reduction_kind::min:  expected = std::min(expected, s->second); break;
+                    case sample_reduction_kind::max:  expected = std::max(expected, s->second); break;
+                    default: break;
+                    }
+                }
+                if (kinds[i]==sample_reduction_kind::mean) expected /= window;
+
+                EXPECT_EQ(first->first, r[w].first);
+                EXPECT_NEAR(expected, r[w].second, 1e-9*std::abs(expected));
+            }
+        }
+    }
+}
+
+TEST(simulation, whole_cell_probe) {
+    auto context = make_context();
+    auto rec = make_recipe(2);
+    for (cell_gid_type gid: {0u, 1u}) {
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_voltage});
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0}, cell_probe_address::membrane_voltage_cell});
+    }
+
+    partition_hint_map hints;
+    hints[cell_kind::cable].cpu_group_size = 2;
+    auto decomp = partition_load_balance(rec, context, hints);
+    simulation sim(rec, decomp, context);
+
+    std::map<cell_member_type, std::vector<std::vector<double>>> traces;
+    sampler_function sampler = [&](cell_member_type pid, probe_tag, std::size_t n, const sample_record* recs) {
+        for (std::size_t i = 0; i<n; ++i) {
+            if (pid.index==0) {
+                traces[pid].push_back({*util::any_cast<const double*>(recs[i].data)});
+            }
+            else {
+                auto range = *util::any_cast<const cable_sample_range*>(recs[i].data);
+                traces[pid].push_back(std::vector<double>(range.first, range.second));
+            }
+        }
+    };
+
+    sim.add_sampler(all_probes, regular_schedule(0.5), sampler);
+    sim.run(10, 0.025);
+
+    // The soma is the first CV of each cell.
+    for (cell_gid_type gid: {0u, 1u}) {
+        auto& soma = traces[{gid, 0}];
+        auto& cell = traces[{gid, 1}];
+        ASSERT_EQ(20u, soma.size());
+        ASSERT_EQ(20u, cell.size());
+        for (unsigned i = 0; i<20; ++i) {
+            EXPECT_LT(1u, cell[i].size());
+            EXPECT_EQ(soma[i][0], cell[i][0]);
+        }
+    }
+}
+
+TEST(simulation, async_callbacks) {
+    auto context = make_context();
+    auto rec = make_recipe(4);
+    for (cell_gid_type gid: {0u, 1u, 2u, 3u}) {
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_voltage});
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0}, cell_probe_address::membrane_voltage_cell});
+    }
+    auto decomp = partition_load_balance(rec, context);
+
+    struct output {
+        std::map<cell_member_type, std::vector<std::vector<double>>> samples;
+        std::map<cell_member_type, std::vector<double>> bulk;
+        std::vector<spike> spikes;
+    };
+
+    auto run = [&](std::size_t max_pending) {
+        output out;
+        simulation sim(rec, decomp, context);
+        sim.set_async_callbacks(max_pending);
+
+        sim.add_sampler(all_probes, regular_schedule(0.5),
+            [&](cell_member_type pid, probe_tag, std::size_t n, const sample_record* recs) {
+                for (std::size_t i = 0; i<n; ++i) {
+                    std::vector<double> v = {recs[i].time};
+                    if (auto p = util::any_cast<const double*>(recs[i].data)) {
+                        v.push_back(*p);
+                    }
+                    else {
+                        auto range = *util::any_cast<const cable_sample_range*>(recs[i].data);
+                        v.insert(v.end(), range.first, range.second);
+                    }
+                    out.samples[pid].push_back(v);
+                }
+            });
+        sim.add_sampler(all_probes, regular_schedule(0.5),
+            [&](cell_member_type pid, probe_tag, std::size_t n, const double* t, const double* v) {
+                out.bulk[pid].insert(out.bulk[pid].end(), t, t+n);
+                out.bulk[pid].insert(out.bulk[pid].end(), v, v+n);
+            });
+        sim.set_global_spike_callback(
+            [&](const std::vector<spike>& spikes) {
+                out.spikes.insert(out.spikes.end(), spikes.begin(), spikes.end());
+            });
+
+        sim.run(10, 0.025);
+        sim.run(20, 0.025);
+        return out;
+    };
+
+    // Callbacks run in order for each sampler, with the same data.
+    auto sync = run(0);
+    auto async = run(2);
+
+    EXPECT_FALSE(sync.spikes.empty());
+    EXPECT_EQ(8u, sync.samples.size());
+    EXPECT_EQ(sync.samples, async.samples);
+    EXPECT_EQ(sync.bulk, async.bulk);
+    EXPECT_EQ(sync.spikes.size(), async.spikes.size());
+
+    // Exceptions are passed on from run.
+    simulation sim(rec, decomp, context);
+    sim.set_async_callbacks(1);
+    sim.set_global_spike_callback([](const std::vector<spike>&) { throw std::runtime_error("callback"); });
+    EXPECT_THROW(sim.run(10, 0.025), std::runtime_error);
+}
+
+TEST(simulation, split_gap_junctions) {
+    // A chain of cells coupled by gap junctions, driven by a stimulus on the
+    // first cell, should give the same spikes whether the chain is kept in
+    // one cell group or split into a group per cell, with the voltages of
+    // the junctions exchanged every step or every few steps.
+
+    struct chain_recipe: cable1d_recipe {
+        explicit chain_recipe(const std::vector<cable_cell>& cells): cable1d_recipe(cells) {}
+
+        std::vector<gap_junction_connection> gap_junctions_on(cell_gid_type gid) const override {
+            std::vector<gap_junction_connection> conns;
+            if (gid>0) conns.push_back(gap_junction_connection({gid-1, 0}, {gid, 0}, 0.05));
+            if (gid+1<num_cells()) conns.push_back(gap_junction_connection({gid+1, 0}, {gid, 0}, 0.05));
+            return conns;
+        }
+    };
+
+    std::vector<cable_cell> cells;
+    for (unsigned i = 0; i<4; ++i) {
+        auto c = make_cell_soma_only(false);
+        c.place(mlocation{0, 0.5}, gap_junction_site{});
+        c.place(mlocation{0, 0.5}, threshold_detector{-10});
+        if (!i) c.place(mlocation{0, 0.5}, i_clamp{5, 30, 0.2});
+        cells.push_back(std::move(c));
+    }
+    chain_recipe rec(cells);
+
+    auto context = make_context();
+    partition_hint split;
+    split.split_gap_junctions = true;
+
+    auto run = [&](const domain_decomposition& decomp, time_type interval) {
+        std::vector<spike> spikes;
+        simulation sim(rec, decomp, context);
+        sim.set_gap_junction_interval(interval);
+        sim.set_global_spike_callback(
+            [&](const std::vector<spike>& s) { spikes.insert(spikes.end(), s.begin(), s.end()); });
+        sim.run(40, 0.025);
+        util::sort_by(spikes, [](const spike& s) { return s.source; });
+        return spikes;
+    };
+
+    auto whole = partition_load_balance(rec, context);
+    ASSERT_EQ(1u, whole.groups.size());
+    auto expected = run(whole, 0);
+    for (cell_gid_type gid: {0u, 1u, 2u, 3u}) {
+        EXPECT_TRUE(std::any_of(expected.begin(), expected.end(), [&](const spike& s) { return s.source.gid==gid; }));
+    }
+
+    auto decomp = partition_load_balance(rec, context, {{cell_kind::cable, split}});
+    ASSERT_EQ(4u, decomp.groups.size());
+
+    // Exchanging voltages every step reproduces the explicit coupling within
+    // the single group; a longer interval lags the propagation along the chain.
+    std::pair<time_type, double> cases[] = {{0, 1e-3}, {0.1, 1.}};
+    for (auto c: cases) {
+        SCOPED_TRACE(c.first);
+        auto spikes = run(decomp, c.first);
+        ASSERT_EQ(expected.size(), spikes.size());
+        for (auto i: util::count_along(expected)) {
+            EXPECT_EQ(expected[i].source, spikes[i].source);
+            EXPECT_NEAR(expected[i].time, spikes[i].time, c.second);
+        }
+    }
+}
+
+TEST(simulation, whole_cell_probe_soma_only) {
+    // A soma-only cell has a single CV, but its whole-cell probe still
+    // samples ranges.
+    auto context = make_context();
+    cable1d_recipe rec(std::vector<cable_cell>{make_cell_soma_only()});
+    rec.add_probe(0, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_voltage});
+    rec.add_probe(0, 0, cell_probe_address{{0, 0}, cell_probe_address::membrane_voltage_cell});
+
+    auto decomp = partition_load_balance(rec, context);
+    simulation sim(rec, decomp, context);
+
+    std::vector<double> soma;
+    std::vector<std::vector<double>> cell;
+    sampler_function sampler = [&](cell_member_type pid, probe_tag, std::size_t n, const sample_record* recs) {
+        for (std::size_t i = 0; i<n; ++i) {
+            if (pid.index==0) {
+                soma.push_back(*util::any_cast<const double*>(recs[i].data));
+            }
+            else {
+                auto range = *util::any_cast<const cable_sample_range*>(recs[i].data);
+                cell.push_back(std::vector<double>(range.first, range.second));
+            }
+        }
+    };
+
+    sim.add_sampler(all_probes, regular_schedule(0.5), sampler);
+    sim.run(10, 0.025);
+
+    ASSERT_EQ(20u, soma.size());
+    ASSERT_EQ(20u, cell.size());
+    for (unsigned i = 0; i<20; ++i) {
+        ASSERT_EQ(1u, cell[i].size());
+        EXPECT_EQ(soma[i], cell[i][0]);
+    }
+
+    // Bulk samplers take only scalar probes.
+    std::set<cell_member_type> bulk_probes;
+    bulk_sampler_function bulk_sampler = [&](cell_member_type pid, probe_tag, std::size_t, const double*, const double*) {
+        bulk_probes.insert(pid);
+    };
+    sim.add_sampler(all_probes, regular_schedule(0.5), bulk_sampler);
+    sim.reset();
+    sim.run(10, 0.025);
+    ASSERT_EQ(1u, bulk_probes.size());
+    EXPECT_EQ(cell_member_type({0, 0}), *bulk_probes.begin());
+}
@@ -0,0 +1,120 @@
+#include "../gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <arbor/arbexcept.hpp>
+#include <arbor/context.hpp>
+#include <arbor/load_balance.hpp>
+#include <arbor/schedule.hpp>
+#include <arbor/simulation.hpp>
+#include <arbor/spike.hpp>
+#include <arbor/spike_file.hpp>
+#include <arbor/spike_source_cell.hpp>
+
+#include "../simple_recipes.hpp"
+
+using namespace arb;
+
+namespace {
+    // Remove the named file on scope exit.
+    struct scratch_file {
+        std::string path;
+        explicit scratch_file(std::string path): path(std::move(path)) {}
+        ~scratch_file() { std::remove(path.c_str()); }
+    };
+
+    bool time_less(const spike& a, const spike& b) { return a.time<b.time; }
+}
+
+TEST(spike_file, write_read) {
+    scratch_file file("spike_file_test.bin");
+
+    // Two exports, each unsorted within an interval of time.
+    std::vector<spike> first = {{{3, 0}, 1.5}, {{1, 2}, 0.25}, {{7, 1}, 1.0}};
+    std::vector<spike> second = {{{2, 0}, 3.0}, {{3, 0}, 2.5}};
+
+    {
+        spike_file_sink sink(file.path, 2);
+        sink(first);
+        sink(std::vector<spike>{});
+        sink(second);
+        sink.flush();
+
+        auto spikes = read_spike_file(file.path);
+        std::vector<spike> expected = first;
+        std::stable_sort(expected.begin(), expected.end(), time_less);
+        auto sorted_second = second;
+        std::stable_sort(sorted_second.begin(), sorted_second.end(), time_less);
+        expected.insert(expected.end(), sorted_second.begin(), sorted_second.end());
+        EXPECT_EQ(expected, spikes);
+
+        // Spikes after a flush are written when the sink is destroyed.
+        sink(std::vector<spike>{{{4, 0}, 4.0}});
+    }
+    EXPECT_EQ(6u, read_spike_file(file.path).size());
+}
+
+TEST(spike_file, merge) {
+    scratch_file a("spike_file_test_a.bin");
+    scratch_file b("spike_file_test_b.bin");
+    scratch_file merged("spike_file_test_merged.bin");
+
+    std::vector<spike> all;
+    {
+        spike_file_sink sink_a(a.path, 3), sink_b(b.path, 3);
+        for (unsigned i = 0; i<100; ++i) {
+            spike s_a({0, i}, 0.5*i), s_b({1, i}, 0.3*i);
+            sink_a(std::vector<spike>{s_a});
+            sink_b(std::vector<spike>{s_b});
+            all.push_back(s_a);
+            all.push_back(s_b);
+        }
+    }
+
+    merge_spike_files({a.path, b.path}, merged.path);
+    auto spikes = read_spike_file(merged.path);
+
+    std::stable_sort(all.begin(), all.end(), time_less);
+    ASSERT_EQ(all.size(), spikes.size());
+    EXPECT_TRUE(std::is_sorted(spikes.begin(), spikes.end(), time_less));
+    for (unsigned i = 0; i<all.size(); ++i) {
+        EXPECT_EQ(all[i].time, spikes[i].time);
+    }
+}
+
+TEST(spike_file, simulation) {
+    scratch_file file("spike_file_test_sim.bin");
+
+    auto context = make_context();
+    auto rec = homogeneous_recipe<cell_kind::spike_source, spike_source_cell>(
+        4, spike_source_cell{explicit_schedule({0.5, 1.5, 2.5, 12.5})});
+    simulation sim(rec, partition_load_balance(rec, context), context);
+
+    std::vector<spike> recorded;
+    spike_file_sink sink(file.path);
+    sim.set_local_spike_callback(
+        [&](const std::vector<spike>& spikes) {
+            recorded.insert(recorded.end(), spikes.begin(), spikes.end());
+            sink(spikes);
+        });
+    sim.run(20, 0.025);
+    sink.flush();
+
+    auto spikes = read_spike_file(file.path);
+    EXPECT_EQ(16u, spikes.size());
+    EXPECT_TRUE(std::is_sorted(spikes.begin(), spikes.end(), time_less));
+    std::stable_sort(recorded.begin(), recorded.end(), time_less);
+    EXPECT_EQ(recorded, spikes);
+}
+
+TEST(spike_file, errors) {
+    scratch_file file("spike_file_test_bad.bin");
+    std::ofstream(file.path) << "not a spike file";
+
+    EXPECT_THROW(read_spike_file(file.path), spike_file_error);
+    EXPECT_THROW(read_spike_file("spike_file_test_missing.bin"), spike_file_error);
+}
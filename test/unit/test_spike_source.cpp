@@ -44,14 +44,14 @@ TEST(spike_source, matches_time_seq)
 
         // epoch ending at 10ms
         epoch ep(0, 10);
-        group.advance(ep, 1, {});
+        group.advance(ep, 1, {}, {});
         EXPECT_EQ(spike_times(group.spikes()), as_vector(seq.events(0, 10)));
 
         group.clear_spikes();
 
         // advance to 20 ms and repeat
         ep.advance(20);
-        group.advance(ep, 1, {});
+        group.advance(ep, 1, {}, {});
         EXPECT_EQ(spike_times(group.spikes()), as_vector(seq.events(10, 20)));
     };
 
@@ -71,13 +71,13 @@ TEST(spike_source, reset)
 
         // Advance for 10 ms and store generated spikes in spikes1.
         epoch ep(0, 10);
-        group.advance(ep, 1, {});
+        group.advance(ep, 1, {}, {});
         auto spikes1 = group.spikes();
 
         // Reset the model, then advance again to 10 ms, and store the
         // generated spikes in spikes2.
         group.reset();
-        group.advance(ep, 1, {});
+        group.advance(ep, 1, {}, {});
         auto spikes2 = group.spikes();
 
         // Check that the same spikes were generated in each case.
@@ -101,7 +101,7 @@ TEST(spike_source, exhaust)
 
         // epoch ending at 10ms
         epoch ep(0, 10);
-        group.advance(ep, 1, {});
+        group.advance(ep, 1, {}, {});
         EXPECT_EQ(spike_times(group.spikes()), as_vector(seq.events(0, 10)));
 
         // Check that the last spike was before the end of the epoch.
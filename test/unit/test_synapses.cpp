@@ -171,7 +171,7 @@ TEST(synapses, syn_basic_state) {
     EXPECT_TRUE(factor>1.);
     fvec expected = {2.71f*factor, 0, 0.07f*factor, 0};
 
-    EXPECT_TRUE(testing::seq_almost_eq<fvm_value_type>(expected, mechanism_field(exp2syn, "A")));
-    EXPECT_TRUE(testing::seq_almost_eq<fvm_value_type>(expected, mechanism_field(exp2syn, "B")));
+    EXPECT_TRUE(testing::seq_almost_eq<fvm_state_type>(expected, mechanism_field(exp2syn, "A")));
+    EXPECT_TRUE(testing::seq_almost_eq<fvm_state_type>(expected, mechanism_field(exp2syn, "B")));
 }
 
@@ -0,0 +1,111 @@
+#include "../gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <arbor/arbexcept.hpp>
+#include <arbor/context.hpp>
+#include <arbor/load_balance.hpp>
+#include <arbor/simulation.hpp>
+#include <arbor/trace_file.hpp>
+
+#include "../common_cells.hpp"
+#include "../simple_recipes.hpp"
+
+using namespace arb;
+
+namespace {
+    // Remove the named file on scope exit.
+    struct scratch_file {
+        std::string path;
+        explicit scratch_file(std::string path): path(std::move(path)) {}
+        ~scratch_file() { std::remove(path.c_str()); }
+    };
+}
+
+TEST(trace_file, round_trip) {
+    scratch_file f64("trace_file_test_f64.bin");
+    scratch_file f32("trace_file_test_f32.bin");
+
+    std::vector<double> t, v;
+    for (unsigned i = 0; i<25; ++i) {
+        t.push_back(0.5*i);
+        v.push_back(-65+0.1*i);
+    }
+
+    {
+        // Blocks of 4 samples, with calls that end part way through a block.
+        trace_file_sink sink64(f64.path, trace_value_type::float64, 4);
+        trace_file_sink sink32(f32.path, trace_value_type::float32, 4);
+        for (auto sink: {sink64, sink32}) {
+            sink({3, 1}, 7, 10, t.data(), v.data());
+            sink({0, 0}, 2, 25, t.data(), v.data());
+            sink({3, 1}, 7, 15, t.data()+10, v.data()+10);
+        }
+        sink64.flush();
+        // sink32 is flushed on destruction.
+    }
+
+    auto c64 = read_trace_file(f64.path);
+    auto c32 = read_trace_file(f32.path);
+    ASSERT_EQ(2u, c64.size());
+    ASSERT_EQ(2u, c32.size());
+
+    EXPECT_EQ((cell_member_type{0, 0}), c64[0].probe_id);
+    EXPECT_EQ((cell_member_type{3, 1}), c64[1].probe_id);
+    EXPECT_EQ(2, c64[0].tag);
+    EXPECT_EQ(7, c64[1].tag);
+
+    for (auto& c: c64) {
+        EXPECT_EQ(t, c.time);
+        EXPECT_EQ(v, c.value);
+    }
+    for (auto& c: c32) {
+        EXPECT_EQ(t, c.time);
+        ASSERT_EQ(v.size(), c.value.size());
+        for (unsigned i = 0; i<v.size(); ++i) {
+            EXPECT_EQ(float(v[i]), c.value[i]);
+        }
+    }
+}
+
+TEST(trace_file, simulation) {
+    scratch_file file("trace_file_test_sim.bin");
+
+    auto context = make_context();
+    std::vector<cable_cell> cells = {make_cell_ball_and_stick(), make_cell_ball_and_stick()};
+    cable1d_recipe rec(cells);
+    for (cell_gid_type gid: {0u, 1u}) {
+        rec.add_probe(gid, 0, cell_probe_address{{0, 0.5}, cell_probe_address::membrane_voltage});
+    }
+    simulation sim(rec, partition_load_balance(rec, context), context);
+
+    std::map<cell_member_type, std::vector<double>> expected;
+    sim.add_sampler(all_probes, regular_schedule(0.1),
+        [&](cell_member_type pid, probe_tag, std::size_t n, const double*, const double* v) {
+            expected[pid].insert(expected[pid].end(), v, v+n);
+        });
+
+    trace_file_sink sink(file.path, trace_value_type::float64, 16);
+    sim.add_sampler(all_probes, regular_schedule(0.1), sink);
+    sim.run(10, 0.025);
+    sink.flush();
+
+    auto columns = read_trace_file(file.path);
+    ASSERT_EQ(2u, columns.size());
+    for (auto& c: columns) {
+        EXPECT_EQ(100u, c.time.size());
+        EXPECT_EQ(expected[c.probe_id], c.value);
+    }
+}
+
+TEST(trace_file, errors) {
+    scratch_file file("trace_file_test_bad.bin");
+    std::ofstream(file.path) << "not a trace file";
+
+    EXPECT_THROW(read_trace_file(file.path), trace_file_error);
+    EXPECT_THROW(read_trace_file("trace_file_test_missing.bin"), trace_file_error);
+}